@@ -0,0 +1,40 @@
+#include "common/file_util.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <common/log.h>
+#include <common/strutil.h>
+
+namespace chainer_compiler {
+
+void MakePrivateDirs(const std::string& dir) {
+    for (size_t pos = dir.find('/', 1); pos != std::string::npos; pos = dir.find('/', pos + 1)) {
+        const std::string parent = dir.substr(0, pos);
+        if (mkdir(parent.c_str(), 0700) != 0) {
+            CHECK_EQ(EEXIST, errno) << "Failed to create " << parent << ": " << strerror(errno);
+        }
+    }
+    if (mkdir(dir.c_str(), 0700) != 0) {
+        CHECK_EQ(EEXIST, errno) << "Failed to create " << dir << ": " << strerror(errno);
+    }
+}
+
+void CheckPrivateFile(const std::string& path) {
+    struct stat st;
+    CHECK_EQ(0, stat(path.c_str(), &st)) << "Failed to stat " << path << ": " << strerror(errno);
+    CHECK_EQ(geteuid(), st.st_uid) << path << " is not owned by the current user";
+    CHECK_EQ(0, st.st_mode & (S_IWGRP | S_IWOTH)) << path << " is writable by other users";
+}
+
+std::string GetTemporaryFilename(const std::string& filename) {
+    static std::atomic<int> next_id{0};
+    return StrCat(filename, ".tmp", getpid(), '_', next_id++);
+}
+
+}  // namespace chainer_compiler
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+namespace chainer_compiler {
+
+// Creates `dir` and its missing parents with mode 0700.
+void MakePrivateDirs(const std::string& dir);
+
+// Checks `path` is owned by the current user and is not writable by
+// others. Caches whose files are loaded and run must pass this.
+void CheckPrivateFile(const std::string& path);
+
+// Returns a name next to `filename` which is unique among threads and
+// processes. Files are written to it and renamed to `filename` so
+// concurrent readers never see a partial file.
+std::string GetTemporaryFilename(const std::string& filename);
+
+}  // namespace chainer_compiler
@@ -0,0 +1,37 @@
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <common/file_util.h>
+
+namespace chainer_compiler {
+namespace {
+
+TEST(FileUtilTest, MakePrivateDirs) {
+    const std::string root = "/tmp/file_util_test";
+    const std::string dir = root + "/a/b";
+    MakePrivateDirs(dir);
+    // Existing directories are fine.
+    MakePrivateDirs(dir);
+    struct stat st;
+    ASSERT_EQ(0, stat(dir.c_str(), &st));
+    EXPECT_TRUE(S_ISDIR(st.st_mode));
+    EXPECT_EQ(0700, st.st_mode & 0777);
+    CheckPrivateFile(dir);
+    rmdir(dir.c_str());
+    rmdir((root + "/a").c_str());
+    rmdir(root.c_str());
+}
+
+TEST(FileUtilTest, GetTemporaryFilename) {
+    const std::string filename = "/tmp/file_util_test.dat";
+    const std::string tmp = GetTemporaryFilename(filename);
+    EXPECT_EQ(0, tmp.find(filename + ".tmp"));
+    EXPECT_NE(tmp, GetTemporaryFilename(filename));
+}
+
+}  // namespace
+}  // namespace chainer_compiler
@@ -0,0 +1,20 @@
+#include "common/hash.h"
+
+#include <cstdio>
+
+namespace chainer_compiler {
+
+std::string Fingerprint(const std::string& data) {
+    typedef unsigned __int128 uint128;
+    const uint128 kPrime = (static_cast<uint128>(1) << 88) + 0x13b;
+    uint128 hash = (static_cast<uint128>(0x6c62272e07bb0142ULL) << 64) + 0x62b821756295c58dULL;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= kPrime;
+    }
+    char buf[33];
+    snprintf(buf, sizeof(buf), "%016llx%016llx", static_cast<unsigned long long>(hash >> 64), static_cast<unsigned long long>(hash));
+    return buf;
+}
+
+}  // namespace chainer_compiler
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+namespace chainer_compiler {
+
+// Returns the 128-bit FNV-1a hash of `data` as 32 hex digits. Used
+// as names of files in caches.
+std::string Fingerprint(const std::string& data);
+
+}  // namespace chainer_compiler
@@ -0,0 +1,15 @@
+#include <gtest/gtest.h>
+
+#include <common/hash.h>
+
+namespace chainer_compiler {
+namespace {
+
+TEST(HashTest, Fingerprint) {
+    EXPECT_EQ("6c62272e07bb014262b821756295c58d", Fingerprint(""));
+    EXPECT_EQ("d228cb696f1a8caf78912b704e4a8964", Fingerprint("a"));
+    EXPECT_NE(Fingerprint("ab"), Fingerprint("ba"));
+}
+
+}  // namespace
+}  // namespace chainer_compiler
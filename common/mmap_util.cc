@@ -0,0 +1,50 @@
+#include "common/mmap_util.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include <common/log.h>
+
+namespace chainer_compiler {
+
+MappedFile MapFile(const std::string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    CHECK_LE(0, fd) << "Failed to open " << filename << ": " << strerror(errno);
+    struct stat st;
+    CHECK_EQ(0, fstat(fd, &st)) << "Failed to stat " << filename << ": " << strerror(errno);
+    const size_t size = st.st_size;
+    if (size == 0) {
+        close(fd);
+        return MappedFile{nullptr, 0};
+    }
+
+    // Keyed by the identity of the file, its size and its mtime in
+    // nanoseconds so a modified file is mapped again.
+    typedef std::tuple<dev_t, ino_t, off_t, time_t, long> Key;
+    static std::mutex mu;
+    static std::map<Key, std::weak_ptr<void>> mapped_files;
+    const Key key(st.st_dev, st.st_ino, st.st_size, st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+    std::lock_guard<std::mutex> lock(mu);
+    std::weak_ptr<void>& cached = mapped_files[key];
+    if (std::shared_ptr<void> data = cached.lock()) {
+        close(fd);
+        return MappedFile{data, size};
+    }
+
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    CHECK_NE(MAP_FAILED, addr) << "Failed to mmap " << filename << ": " << strerror(errno);
+    close(fd);
+    std::shared_ptr<void> data(addr, [size](void* p) { munmap(p, size); });
+    cached = data;
+    return MappedFile{data, size};
+}
+
+}  // namespace chainer_compiler
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace chainer_compiler {
+
+struct MappedFile {
+    // Null for an empty file.
+    std::shared_ptr<void> data;
+    size_t size;
+};
+
+// Maps `filename` to read-only memory. Pages are read when they are
+// accessed for the first time. While a mapping is alive, it is shared
+// by all callers which map the same file, so users which need to
+// modify the data must copy it.
+MappedFile MapFile(const std::string& filename);
+
+}  // namespace chainer_compiler
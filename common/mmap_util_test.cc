@@ -0,0 +1,37 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <common/mmap_util.h>
+
+namespace chainer_compiler {
+namespace {
+
+TEST(MmapUtilTest, MapFile) {
+    const std::string filename = "/tmp/mmap_util_test.dat";
+    {
+        std::ofstream ofs(filename, std::ios::binary);
+        ofs << "foobar";
+    }
+
+    MappedFile mapped = MapFile(filename);
+    ASSERT_EQ(6, mapped.size);
+    EXPECT_EQ("foobar", std::string(static_cast<const char*>(mapped.data.get()), mapped.size));
+    // Shared while alive.
+    EXPECT_EQ(mapped.data.get(), MapFile(filename).data.get());
+    std::remove(filename.c_str());
+}
+
+TEST(MmapUtilTest, EmptyFile) {
+    const std::string filename = "/tmp/mmap_util_test_empty.dat";
+    { std::ofstream ofs(filename); }
+    MappedFile mapped = MapFile(filename);
+    EXPECT_EQ(0, mapped.size);
+    EXPECT_FALSE(mapped.data);
+    std::remove(filename.c_str());
+}
+
+}  // namespace
+}  // namespace chainer_compiler
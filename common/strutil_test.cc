@@ -21,5 +21,11 @@ TEST(StrUtilTest, StrCat) {
     EXPECT_EQ("99", StrCat(99));
 }
 
+TEST(StrUtilTest, Dirname) {
+    EXPECT_EQ("foo/bar", Dirname("foo/bar/baz.onnx"));
+    EXPECT_EQ("/", Dirname("/baz.onnx"));
+    EXPECT_EQ(".", Dirname("baz.onnx"));
+}
+
 }  // namespace
 }  // namespace chainer_compiler
@@ -0,0 +1,220 @@
+#include "compiler/algebraic_simplifier.h"
+
+#include <map>
+#include <queue>
+#include <set>
+#include <vector>
+
+#include <common/log.h>
+#include <compiler/graph.h>
+#include <compiler/graph_builder.h>
+#include <compiler/log.h>
+#include <compiler/node.h>
+#include <compiler/tensor.h>
+#include <compiler/type.h>
+#include <compiler/value.h>
+
+namespace chainer_compiler {
+namespace {
+
+// A rewrite rule returns the value which computes the output of
+// `node` after the rewrite, or nullptr if the rule is not applicable.
+// `node` will be removed when the rule is applied.
+typedef Value* (*RewriteFn)(Graph*, Node*);
+
+// Lets users of the output of `node` use `value` instead.
+Value* ReplaceOutput(Graph* graph, Node* node, Value* value) {
+    Value* output = node->output(0);
+    if (output->IsTemp()) {
+        output->ReplaceAllUsesWith(value);
+    } else {
+        // Outputs of the graph must be kept.
+        GraphBuilder gb(graph, "AlgebraicSimplifier", output);
+        gb.Op(Node::kIdentity, {value}, output);
+    }
+    return value;
+}
+
+bool HasSameType(const Value* a, const Value* b) {
+    const Type& ta = a->type();
+    const Type& tb = b->type();
+    if (ta.kind() != Type::Kind::kTensor || tb.kind() != Type::Kind::kTensor) return false;
+    if (ta.dtype() == Dtype::kUnknown || ta.dtype() != tb.dtype()) return false;
+    return ta.HasKnownShape() && tb.HasKnownShape() && ta.dims() == tb.dims();
+}
+
+template <typename T>
+bool IsFilledWith(const Tensor& tensor, double expected) {
+    for (int64_t i = 0; i < tensor.NumElements(); ++i) {
+        if (tensor.Get<T>(i) != static_cast<T>(expected)) return false;
+    }
+    return true;
+}
+
+bool IsConstantFilledWith(const Value* value, double expected) {
+    const Node* producer = value->producer();
+    if (!producer || producer->op_type() != Node::kConstant) return false;
+    const Tensor& tensor = *producer->tensor_value();
+    switch (tensor.dtype()) {
+        case Dtype::kInt32:
+            return IsFilledWith<int32_t>(tensor, expected);
+        case Dtype::kInt64:
+            return IsFilledWith<int64_t>(tensor, expected);
+        case Dtype::kFloat32:
+            return IsFilledWith<float>(tensor, expected);
+        case Dtype::kFloat64:
+            return IsFilledWith<double>(tensor, expected);
+        default:
+            return false;
+    }
+}
+
+// Returns the producer of `value` if it is `op_type`.
+Node* GetProducer(const Value* value, Node::OpType op_type) {
+    Node* producer = value->producer();
+    if (!producer || producer->detached() || producer->op_type() != op_type) return nullptr;
+    return producer;
+}
+
+// x op c => x where c is the identity element of op. The output
+// must not be broadcasted by c.
+Value* RemoveIdentityElement(Graph* graph, Node* node, double identity, bool commutative) {
+    for (int i = 0; i < 2; ++i) {
+        Value* x = node->input(i);
+        Value* c = node->input(1 - i);
+        if (i == 1 && !commutative) break;
+        if (IsConstantFilledWith(c, identity) && HasSameType(x, node->output(0))) return ReplaceOutput(graph, node, x);
+    }
+    return nullptr;
+}
+
+Value* SimplifyAdd(Graph* graph, Node* node) {
+    return RemoveIdentityElement(graph, node, 0, true);
+}
+
+Value* SimplifySub(Graph* graph, Node* node) {
+    return RemoveIdentityElement(graph, node, 0, false);
+}
+
+Value* SimplifyMul(Graph* graph, Node* node) {
+    return RemoveIdentityElement(graph, node, 1, true);
+}
+
+Value* SimplifyDiv(Graph* graph, Node* node) {
+    return RemoveIdentityElement(graph, node, 1, false);
+}
+
+// Neg(Neg(x)) => x and Not(Not(x)) => x.
+Value* SimplifyInvolution(Graph* graph, Node* node) {
+    Node* inner = GetProducer(node->input(0), node->op_type());
+    if (!inner) return nullptr;
+    return ReplaceOutput(graph, node, inner->input(0));
+}
+
+Value* SimplifyIdentity(Graph* graph, Node* node) {
+    if (!node->output(0)->IsTemp()) return nullptr;
+    return ReplaceOutput(graph, node, node->input(0));
+}
+
+Value* SimplifyCast(Graph* graph, Node* node) {
+    Value* input = node->input(0);
+    if (input->type().kind() != Type::Kind::kTensor || input->type().dtype() != node->to()) return nullptr;
+    return ReplaceOutput(graph, node, input);
+}
+
+std::vector<int64_t> GetPermutation(const Node& node) {
+    if (!node.perm().empty()) return node.perm();
+    // The default permutation reverses axes.
+    const Type& type = node.input(0)->type();
+    if (type.kind() != Type::Kind::kTensor || !type.HasKnownShape()) return {};
+    std::vector<int64_t> perm;
+    for (int64_t i = type.ndim() - 1; i >= 0; --i) perm.push_back(i);
+    return perm;
+}
+
+// Transpose(Transpose(x)) => Transpose(x) or x.
+Value* SimplifyTranspose(Graph* graph, Node* node) {
+    Node* inner = GetProducer(node->input(0), Node::kTranspose);
+    if (!inner) return nullptr;
+    const std::vector<int64_t> outer_perm = GetPermutation(*node);
+    const std::vector<int64_t> inner_perm = GetPermutation(*inner);
+    if (outer_perm.empty() || outer_perm.size() != inner_perm.size()) return nullptr;
+
+    std::vector<int64_t> perm;
+    bool is_identity = true;
+    for (size_t i = 0; i < outer_perm.size(); ++i) {
+        perm.push_back(inner_perm[outer_perm[i]]);
+        if (perm.back() != static_cast<int64_t>(i)) is_identity = false;
+    }
+    if (is_identity) return ReplaceOutput(graph, node, inner->input(0));
+    GraphBuilder gb(graph, "AlgebraicSimplifier", node->output(0));
+    return gb.Op(Node::kTranspose, {inner->input(0)}, node->output(0));
+}
+
+// Reshape(Reshape(x)) => Reshape(x), and Reshape(x) => x if the shape
+// does not change.
+Value* SimplifyReshape(Graph* graph, Node* node) {
+    if (HasSameType(node->input(0), node->output(0))) return ReplaceOutput(graph, node, node->input(0));
+
+    Node* inner = GetProducer(node->input(0), Node::kReshape);
+    if (!inner) return nullptr;
+    // Zeros in the shape copy dimensions of the input.
+    Node* shape = GetProducer(node->input(1), Node::kConstant);
+    if (!shape || shape->tensor_value()->dtype() != Dtype::kInt64) return nullptr;
+    const Tensor& shape_tensor = *shape->tensor_value();
+    for (int64_t i = 0; i < shape_tensor.NumElements(); ++i) {
+        if (shape_tensor.Get<int64_t>(i) == 0) return nullptr;
+    }
+    GraphBuilder gb(graph, "AlgebraicSimplifier", node->output(0));
+    return gb.Op(Node::kReshape, {inner->input(0), node->input(1)}, node->output(0));
+}
+
+// Squeeze(Unsqueeze(x, axes), axes) => x.
+Value* SimplifySqueeze(Graph* graph, Node* node) {
+    Node* inner = GetProducer(node->input(0), Node::kUnsqueeze);
+    if (!inner || node->axes().empty() || node->axes() != inner->axes()) return nullptr;
+    return ReplaceOutput(graph, node, inner->input(0));
+}
+
+}  // namespace
+
+void SimplifyAlgebraically(Graph* graph) {
+    std::map<Node::OpType, RewriteFn> rules;
+    CHECK(rules.emplace(Node::kAdd, SimplifyAdd).second);
+    CHECK(rules.emplace(Node::kSub, SimplifySub).second);
+    CHECK(rules.emplace(Node::kMul, SimplifyMul).second);
+    CHECK(rules.emplace(Node::kDiv, SimplifyDiv).second);
+    CHECK(rules.emplace(Node::kNeg, SimplifyInvolution).second);
+    CHECK(rules.emplace(Node::kNot, SimplifyInvolution).second);
+    CHECK(rules.emplace(Node::kIdentity, SimplifyIdentity).second);
+    CHECK(rules.emplace(Node::kCast, SimplifyCast).second);
+    CHECK(rules.emplace(Node::kTranspose, SimplifyTranspose).second);
+    CHECK(rules.emplace(Node::kReshape, SimplifyReshape).second);
+    CHECK(rules.emplace(Node::kSqueeze, SimplifySqueeze).second);
+
+    // Each node is visited again only when its input is rewritten.
+    std::queue<Node*> q;
+    std::set<Node*> queued;
+    auto push = [&q, &queued](Node* node) {
+        if (queued.insert(node).second) q.push(node);
+    };
+    for (Node* node : graph->GetTopologicallySortedNodes()) push(node);
+
+    while (!q.empty()) {
+        Node* node = q.front();
+        q.pop();
+        queued.erase(node);
+        if (node->detached()) continue;
+        auto found = rules.find(node->op_type());
+        if (found == rules.end()) continue;
+        Value* value = found->second(graph, node);
+        if (!value) continue;
+
+        CLOG() << "Algebraic simplification: " << node->ToString() << std::endl;
+        graph->DetachNode(node);
+        if (value->producer()) push(value->producer());
+        for (Node* user : value->users()) push(user);
+    }
+}
+
+}  // namespace chainer_compiler
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace chainer_compiler {
+
+class Graph;
+
+// Removes redundant computations such as x*1, Neg(Neg(x)), and
+// Transpose(Transpose(x)) by peephole rewrites.
+void SimplifyAlgebraically(Graph* graph);
+
+}  // namespace chainer_compiler
@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include <compiler/algebraic_simplifier.h>
+#include <compiler/graph.h>
+#include <compiler/graph_builder.h>
+#include <compiler/node.h>
+#include <compiler/value.h>
+
+namespace chainer_compiler {
+namespace {
+
+TEST(AlgebraicSimplifierTest, Identities) {
+    const Type type(Dtype::kFloat32, {2, 3});
+    Graph graph("test");
+    Value* input = graph.AddInputValue("input", type);
+    Value* output = graph.AddOutputValue("output", type);
+    GraphBuilder gb(&graph, "test", output);
+    Value* one = gb.Const(Type(Dtype::kFloat32, {}), {1.0});
+    Value* zero = gb.Const(Type(Dtype::kFloat32, {}), {0.0});
+    Value* v = gb.Op(Node::kMul, {one, input}, gb.Temp(type));
+    v = gb.Op(Node::kSub, {v, zero}, gb.Temp(type));
+    v = gb.Op(Node::kNeg, {gb.Op(Node::kNeg, {v})});
+    v = gb.Op(Node::kIdentity, {v});
+    v = gb.Op(Node::kCast, {v});
+    v->producer()->set_to(Dtype::kFloat32);
+    gb.Op(Node::kRelu, {v}, output);
+
+    SimplifyAlgebraically(&graph);
+    graph.DeleteDetached();
+    const Node& relu = *output->producer();
+    EXPECT_EQ(Node::kRelu, relu.op_type());
+    EXPECT_EQ(input, relu.input(0));
+    graph.CheckSanity("simplified");
+}
+
+TEST(AlgebraicSimplifierTest, Broadcast) {
+    Graph graph("test");
+    Value* input = graph.AddInputValue("input", Type(Dtype::kFloat32, {3}));
+    Value* output = graph.AddOutputValue("output", Type(Dtype::kFloat32, {2, 3}));
+    GraphBuilder gb(&graph, "test", output);
+    Value* zeros = gb.Const(Type(Dtype::kFloat32, {2, 1}), {0.0, 0.0});
+    gb.Op(Node::kAdd, {input, zeros}, output);
+
+    SimplifyAlgebraically(&graph);
+    EXPECT_EQ(Node::kAdd, output->producer()->op_type());
+}
+
+TEST(AlgebraicSimplifierTest, Transpose) {
+    const Type type(Dtype::kFloat32, {2, 3, 4});
+    Graph graph("test");
+    Value* input = graph.AddInputValue("input", type);
+    Value* output = graph.AddOutputValue("output", Type(Dtype::kFloat32, {4, 2, 3}));
+    Value* output2 = graph.AddOutputValue("output2", type);
+    GraphBuilder gb(&graph, "test", output);
+    Value* t0 = gb.Op(Node::kTranspose, {input});
+    t0->producer()->set_perm({1, 2, 0});
+    Value* t1 = gb.Op(Node::kTranspose, {t0});
+    t1->producer()->set_perm({2, 1, 0});
+    gb.Op(Node::kTranspose, {t1}, output)->producer()->set_perm({1, 0, 2});
+    // The default permutation reverses axes.
+    gb.Op(Node::kTranspose, {gb.Op(Node::kTranspose, {input}, gb.Temp(Type(Dtype::kFloat32, {4, 3, 2})))}, output2);
+
+    SimplifyAlgebraically(&graph);
+    graph.DeleteDetached();
+    const Node& transpose = *output->producer();
+    ASSERT_EQ(Node::kTranspose, transpose.op_type());
+    EXPECT_EQ(input, transpose.input(0));
+    EXPECT_EQ(std::vector<int64_t>({2, 0, 1}), transpose.perm());
+    const Node& identity = *output2->producer();
+    ASSERT_EQ(Node::kIdentity, identity.op_type());
+    EXPECT_EQ(input, identity.input(0));
+    graph.CheckSanity("simplified");
+}
+
+}  // namespace
+}  // namespace chainer_compiler
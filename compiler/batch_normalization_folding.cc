@@ -0,0 +1,168 @@
+#include "compiler/batch_normalization_folding.h"
+
+#include <math.h>
+
+#include <common/log.h>
+#include <compiler/graph.h>
+#include <compiler/graph_builder.h>
+#include <compiler/log.h>
+#include <compiler/node.h>
+#include <compiler/tensor.h>
+#include <compiler/type.h>
+#include <compiler/value.h>
+
+namespace chainer_compiler {
+namespace {
+
+// Returns the value of an initializer or a Constant op.
+const Tensor* GetConstantTensor(const Value* value) {
+    if (value->IsNull()) return nullptr;
+    if (value->initializer()) return value->initializer();
+    const Node* producer = value->producer();
+    if (producer && producer->op_type() == Node::kConstant) return producer->tensor_value().get();
+    return nullptr;
+}
+
+const Tensor* GetFloatTensor(const Value* value, int64_t num_elements) {
+    const Tensor* tensor = GetConstantTensor(value);
+    if (!tensor || tensor->dtype() != Dtype::kFloat32 || tensor->NumElements() != num_elements) return nullptr;
+    return tensor;
+}
+
+// A BatchNormalization and its preceding op which can be folded.
+struct FoldingTarget {
+    Node* bn;
+    Node* layer;
+    const Tensor* weight;
+    // nullptr if the layer has no bias.
+    const Tensor* bias;
+    const Tensor* bn_scale;
+    const Tensor* bn_bias;
+    const Tensor* bn_mean;
+    const Tensor* bn_var;
+    int64_t num_channels;
+};
+
+bool MatchFoldingTarget(Node* bn, FoldingTarget* target) {
+    if (bn->op_type() != Node::kBatchNormalization || bn->detached() || bn->outputs().size() != 1) return false;
+    Value* x = bn->input(0);
+    Node* layer = x->producer();
+    if (!layer || layer->detached() || x->users().size() != 1 || x->IsOutput()) return false;
+    target->bn = bn;
+    target->layer = layer;
+
+    // Weights are not modified in place as they may be shared.
+    target->weight = GetConstantTensor(layer->input(1));
+    if (!target->weight || target->weight->dtype() != Dtype::kFloat32) return false;
+    const std::vector<int64_t> dims = target->weight->dims();
+    const Value* bias = layer->inputs().size() >= 3 ? layer->input(2) : nullptr;
+    int64_t num_bias_elements = -1;
+    if (layer->op_type() == Node::kConv) {
+        if (dims.empty()) return false;
+        target->num_channels = dims[0];
+        num_bias_elements = target->num_channels;
+    } else if (layer->op_type() == Node::kGemm) {
+        if (dims.size() != 2) return false;
+        target->num_channels = layer->trans_b() ? dims[0] : dims[1];
+        // Only biases broadcasted along the batch axis are supported,
+        // i.e., scalars or biases of shape [n] or [1, n].
+        const Tensor* c = bias ? GetConstantTensor(bias) : nullptr;
+        if (!c) return false;
+        const std::vector<int64_t> n = {target->num_channels};
+        const std::vector<int64_t> one_n = {1, target->num_channels};
+        if (c->NumElements() != 1 && c->dims() != n && c->dims() != one_n) return false;
+        num_bias_elements = c->NumElements();
+    } else {
+        return false;
+    }
+
+    target->bias = nullptr;
+    if (bias && !bias->IsNull()) {
+        target->bias = GetFloatTensor(bias, num_bias_elements);
+        if (!target->bias) return false;
+    }
+    const int64_t n = target->num_channels;
+    target->bn_scale = GetFloatTensor(bn->input(1), n);
+    target->bn_bias = GetFloatTensor(bn->input(2), n);
+    target->bn_mean = GetFloatTensor(bn->input(3), n);
+    target->bn_var = GetFloatTensor(bn->input(4), n);
+    return target->bn_scale && target->bn_bias && target->bn_mean && target->bn_var;
+}
+
+void Fold(Graph* graph, const FoldingTarget& target) {
+    Node* bn = target.bn;
+    Node* layer = target.layer;
+    CLOG() << "Fold " << bn->ToString() << " into " << layer->ToString() << std::endl;
+    const int64_t n = target.num_channels;
+    const bool is_gemm = layer->op_type() == Node::kGemm;
+
+    // y = (layer(x) - mean) * scale / sqrt(var + eps) + bias
+    std::vector<float> factors(n);
+    std::vector<float> biases(n);
+    for (int64_t c = 0; c < n; ++c) {
+        factors[c] = target.bn_scale->Get<float>(c) / sqrtf(target.bn_var->Get<float>(c) + bn->epsilon());
+        float layer_bias = 0;
+        if (target.bias) {
+            layer_bias = target.bias->Get<float>(target.bias->NumElements() == 1 ? 0 : c);
+            if (is_gemm) layer_bias *= layer->beta();
+        }
+        biases[c] = (layer_bias - target.bn_mean->Get<float>(c)) * factors[c] + target.bn_bias->Get<float>(c);
+    }
+
+    // Output channels are the first axis of Conv weights, and the
+    // second axis of Gemm weights unless they are transposed.
+    const std::vector<int64_t> dims = target.weight->dims();
+    const int64_t size = target.weight->NumElements();
+    const int64_t inner = (is_gemm && !layer->trans_b()) ? 1 : size / n;
+    std::vector<float> weights(size);
+    for (int64_t i = 0; i < size; ++i) {
+        weights[i] = target.weight->Get<float>(i) * factors[(i / inner) % n];
+    }
+
+    GraphBuilder gb(graph, "FoldBatchNormalization", bn->output(0));
+    Value* weight = gb.Const(Type(Dtype::kFloat32, dims), weights);
+    Value* bias = gb.Const(Type(Dtype::kFloat32, {n}), biases);
+    Value* old_weight = layer->input(1);
+    old_weight->DetachUser(layer);
+    weight->AddUser(layer);
+    layer->ReplaceInput(old_weight, weight);
+    if (layer->inputs().size() >= 3) {
+        Value* old_bias = layer->input(2);
+        old_bias->DetachUser(layer);
+        bias->AddUser(layer);
+        layer->ReplaceInput(old_bias, bias);
+    } else {
+        CHECK(!is_gemm);
+        layer->AddInput(bias);
+    }
+    if (is_gemm) layer->set_beta(1.0);
+
+    gb.Op(Node::kIdentity, {bn->input(0)}, bn->output(0));
+    graph->DetachNode(bn);
+}
+
+}  // namespace
+
+void FoldBatchNormalizations(Graph* graph) {
+    for (Node* node : graph->GetLiveNodes()) {
+        FoldingTarget target;
+        if (MatchFoldingTarget(node, &target)) Fold(graph, target);
+    }
+}
+
+std::vector<Value*> GetInitializersToFoldBatchNormalizations(const Graph& graph) {
+    std::vector<Value*> values;
+    for (Node* node : graph.GetLiveNodes()) {
+        FoldingTarget target;
+        if (!MatchFoldingTarget(node, &target)) continue;
+        for (const Node* n : {target.layer, target.bn}) {
+            // The first inputs are not parameters.
+            for (size_t i = 1; i < n->inputs().size(); ++i) {
+                if (n->input(i)->initializer()) values.push_back(n->input(i));
+            }
+        }
+    }
+    return values;
+}
+
+}  // namespace chainer_compiler
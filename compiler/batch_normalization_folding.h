@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vector>
+
+namespace chainer_compiler {
+
+class Graph;
+class Value;
+
+// Folds BatchNormalization ops for inference into their preceding
+// Conv or Gemm ops when all their parameters are constant. Weights
+// and biases of the preceding ops are replaced by Constant ops with
+// the folded values. This must be run before Simplify splits grouped
+// Conv ops.
+void FoldBatchNormalizations(Graph* graph);
+
+// Returns initializers whose values will be embedded to the program
+// by `FoldBatchNormalizations`.
+std::vector<Value*> GetInitializersToFoldBatchNormalizations(const Graph& graph);
+
+}  // namespace chainer_compiler
@@ -0,0 +1,92 @@
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <compiler/batch_normalization_folding.h>
+#include <compiler/graph.h>
+#include <compiler/node.h>
+#include <compiler/tensor.h>
+#include <compiler/value.h>
+
+namespace chainer_compiler {
+namespace {
+
+TEST(BatchNormalizationFoldingTest, Conv) {
+    Graph graph("test");
+    Value* x = graph.AddInputValue("x", Type(Dtype::kFloat32, {1, 1, 2, 2}));
+    Value* w = graph.AddConstValue("w", Type(Dtype::kFloat32, {2, 1, 1, 1}), {2.0, 3.0});
+    Value* b = graph.AddConstValue("b", Type(Dtype::kFloat32, {2}), {1.0, -1.0});
+    Value* scale = graph.AddConstValue("scale", Type(Dtype::kFloat32, {2}), {1.0, 2.0});
+    Value* bias = graph.AddConstValue("bias", Type(Dtype::kFloat32, {2}), {0.5, 1.0});
+    Value* mean = graph.AddConstValue("mean", Type(Dtype::kFloat32, {2}), {1.0, 0.0});
+    Value* var = graph.AddConstValue("var", Type(Dtype::kFloat32, {2}), {3.0, 0.0});
+    Value* y = graph.AddOutputValue("y", Type(Dtype::kFloat32, {1, 2, 2, 2}));
+    Value* h = graph.AddValue("h");
+    Node* conv = graph.AddNode(Node::kConv, {x, w, b}, {h});
+    graph.AddNode(Node::kBatchNormalization, {h, scale, bias, mean, var}, {y})->set_epsilon(1.0);
+
+    EXPECT_EQ(6, GetInitializersToFoldBatchNormalizations(graph).size());
+    FoldBatchNormalizations(&graph);
+    graph.DeleteDetached();
+
+    ASSERT_EQ(Node::kIdentity, y->producer()->op_type());
+    EXPECT_EQ(h, y->producer()->input(0));
+    ASSERT_EQ(3, conv->inputs().size());
+    const Tensor& folded_w = *conv->input(1)->producer()->tensor_value();
+    const Tensor& folded_b = *conv->input(2)->producer()->tensor_value();
+    // factor = scale / sqrt(var + eps) = {0.5, 2}
+    EXPECT_FLOAT_EQ(1.0, folded_w.Get<float>(0));
+    EXPECT_FLOAT_EQ(6.0, folded_w.Get<float>(1));
+    EXPECT_FLOAT_EQ(0.5, folded_b.Get<float>(0));
+    EXPECT_FLOAT_EQ(-1.0, folded_b.Get<float>(1));
+    // The original weights are kept.
+    EXPECT_EQ(2.0, w->initializer()->Get<float>(0));
+    graph.CheckSanity("folded");
+}
+
+TEST(BatchNormalizationFoldingTest, GemmBiasShape) {
+    for (const std::vector<int64_t>& c_dims : std::vector<std::vector<int64_t>>{{2}, {1, 2}, {2, 1}}) {
+        Graph graph("test");
+        Value* x = graph.AddInputValue("x", Type(Dtype::kFloat32, {2, 1}));
+        Value* w = graph.AddConstValue("w", Type(Dtype::kFloat32, {1, 2}), {2.0, 3.0});
+        Value* c = graph.AddConstValue("c", Type(Dtype::kFloat32, c_dims), {1.0, -1.0});
+        Value* scale = graph.AddConstValue("scale", Type(Dtype::kFloat32, {2}), {1.0, 2.0});
+        Value* bias = graph.AddConstValue("bias", Type(Dtype::kFloat32, {2}), {0.5, 1.0});
+        Value* mean = graph.AddConstValue("mean", Type(Dtype::kFloat32, {2}), {1.0, 0.0});
+        Value* var = graph.AddConstValue("var", Type(Dtype::kFloat32, {2}), {3.0, 0.0});
+        Value* y = graph.AddOutputValue("y", Type(Dtype::kFloat32, {2, 2}));
+        Value* h = graph.AddValue("h");
+        graph.AddNode(Node::kGemm, {x, w, c}, {h});
+        graph.AddNode(Node::kBatchNormalization, {h, scale, bias, mean, var}, {y});
+
+        // A bias of shape [2, 1] is broadcasted along the output
+        // channels, so it cannot be folded.
+        const bool foldable = c_dims.back() == 2;
+        EXPECT_EQ(foldable, !GetInitializersToFoldBatchNormalizations(graph).empty()) << c_dims.size();
+        FoldBatchNormalizations(&graph);
+        EXPECT_EQ(foldable ? Node::kIdentity : Node::kBatchNormalization, y->producer()->op_type()) << c_dims.size();
+    }
+}
+
+TEST(BatchNormalizationFoldingTest, Training) {
+    Graph graph("test");
+    Value* x = graph.AddInputValue("x", Type(Dtype::kFloat32, {1, 1, 2, 2}));
+    Value* w = graph.AddConstValue("w", Type(Dtype::kFloat32, {1, 1, 1, 1}), {2.0});
+    Value* scale = graph.AddConstValue("scale", Type(Dtype::kFloat32, {1}), {1.0});
+    Value* bias = graph.AddConstValue("bias", Type(Dtype::kFloat32, {1}), {0.0});
+    Value* mean = graph.AddConstValue("mean", Type(Dtype::kFloat32, {1}), {0.0});
+    Value* var = graph.AddConstValue("var", Type(Dtype::kFloat32, {1}), {1.0});
+    Value* y = graph.AddOutputValue("y", Type(Dtype::kFloat32, {1, 1, 2, 2}));
+    Value* h = graph.AddValue("h");
+    graph.AddNode(Node::kConv, {x, w}, {h});
+    // The backward context is used by gradients.
+    Value* context = graph.AddValue("context", Type(Type::Kind::kOpaque));
+    graph.AddNode(Node::kBatchNormalization, {h, scale, bias, mean, var}, {y, context});
+
+    EXPECT_TRUE(GetInitializersToFoldBatchNormalizations(graph).empty());
+    FoldBatchNormalizations(&graph);
+    EXPECT_EQ(Node::kBatchNormalization, y->producer()->op_type());
+}
+
+}  // namespace
+}  // namespace chainer_compiler
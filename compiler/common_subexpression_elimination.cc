@@ -0,0 +1,109 @@
+#include "compiler/common_subexpression_elimination.h"
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <compiler/onnx.h>
+
+#include <common/log.h>
+#include <common/strutil.h>
+#include <compiler/flags.h>
+#include <compiler/graph.h>
+#include <compiler/log.h>
+#include <compiler/node.h>
+#include <compiler/tensor.h>
+#include <compiler/value.h>
+
+namespace chainer_compiler {
+
+namespace {
+
+// Constants larger than this are not compared.
+const int64_t kMaxConstantBytes = 64 * 1024;
+
+bool HasSideEffects(const Node& node) {
+    switch (node.op_type()) {
+        case Node::kDropout:
+        case Node::kChainerPrint:
+        case Node::kChainerSequenceCreate:
+        case Node::kChainerNullConstant:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool IsSmallConstant(const Node& node) {
+    if (node.op_type() == Node::kConstant) {
+        const Tensor& tensor = *node.tensor_value();
+        return tensor.ElementSize() * tensor.NumElements() <= kMaxConstantBytes;
+    }
+    if (node.op_type() == Node::kChainerSequenceConstants) {
+        int64_t nbytes = 0;
+        for (const auto& tensor : node.tensor_values()) nbytes += tensor->ElementSize() * tensor->NumElements();
+        return nbytes <= kMaxConstantBytes;
+    }
+    return false;
+}
+
+// Returns a string which identifies the computation of `node`, or an
+// empty string if `node` must not be merged with others.
+std::string GetKey(const Node& node) {
+    if (HasSideEffects(node) || !node.GetSubGraphs().empty() || node.outputs().empty()) return "";
+    if (node.inputs().empty() && !IsSmallConstant(node)) return "";
+
+    std::string key = StrCat(static_cast<int>(node.op_type()), ' ', node.domain(), '(');
+    for (Value* input : node.inputs()) {
+        key += StrCat(static_cast<const void*>(input), ',');
+    }
+    key += ")->";
+    for (Value* output : node.outputs()) {
+        // Outputs of the graph cannot be replaced by other values.
+        if (output->IsOutput()) return "";
+        key += output->IsNull() ? '_' : 'o';
+    }
+
+    onnx::NodeProto xnode;
+    node.FillONNXAttributes(&xnode);
+    for (onnx::AttributeProto& xattr : *xnode.mutable_attribute()) {
+        // Names of tensors do not affect the computation.
+        if (xattr.has_t()) xattr.mutable_t()->clear_name();
+        for (onnx::TensorProto& xtensor : *xattr.mutable_tensors()) xtensor.clear_name();
+        std::string data;
+        CHECK(xattr.SerializeToString(&data));
+        key += StrCat(data.size(), ':', data);
+    }
+    return key;
+}
+
+}  // namespace
+
+void EliminateCommonSubexpressions(Graph* graph) {
+    std::map<std::string, Node*> computed;
+    int num_removed = 0;
+    // Inputs of each node are already replaced by their
+    // representatives when the node is visited.
+    for (Node* node : graph->GetTopologicallySortedNodes()) {
+        const std::string key = GetKey(*node);
+        if (key.empty()) continue;
+        auto p = computed.emplace(key, node);
+        if (p.second) continue;
+
+        Node* representative = p.first->second;
+        CLOG() << "CSE: " << node->ToString() << " => " << representative->ToString() << std::endl;
+        for (size_t i = 0; i < node->outputs().size(); ++i) {
+            if (!node->output(i)->IsNull()) node->output(i)->ReplaceAllUsesWith(representative->output(i));
+        }
+        graph->DetachNode(node);
+        ++num_removed;
+    }
+
+    if (g_dump_cse) {
+        std::cerr << "Common subexpression elimination in " << graph->name() << ": " << num_removed << " of "
+                  << num_removed + graph->GetLiveNodes().size() << " nodes removed" << std::endl;
+    }
+}
+
+}  // namespace chainer_compiler
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace chainer_compiler {
+
+class Graph;
+
+// Merges nodes which compute the same values from the same inputs.
+// Subgraphs are not visited.
+void EliminateCommonSubexpressions(Graph* graph);
+
+}  // namespace chainer_compiler
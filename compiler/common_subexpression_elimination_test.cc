@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include <compiler/common_subexpression_elimination.h>
+#include <compiler/graph.h>
+#include <compiler/graph_builder.h>
+#include <compiler/node.h>
+#include <compiler/value.h>
+
+namespace chainer_compiler {
+namespace {
+
+TEST(CommonSubexpressionEliminationTest, Basic) {
+    const Type type(Dtype::kFloat32, {2, 3});
+    Graph graph("test");
+    Value* input = graph.AddInputValue("input", type);
+    Value* output = graph.AddOutputValue("output", type);
+    Value* output2 = graph.AddOutputValue("output2", type);
+    GraphBuilder gb(&graph, "test", output);
+    // Shape -> Gather chains with their own constants.
+    Value* dim0 = gb.Op(Node::kGather, {gb.Op(Node::kShape, {input}), gb.Const(Type(Dtype::kInt64, {}), {0})});
+    Value* dim1 = gb.Op(Node::kGather, {gb.Op(Node::kShape, {input}), gb.Const(Type(Dtype::kInt64, {}), {0})});
+    // Different attributes.
+    Value* t0 = gb.Op(Node::kTranspose, {input});
+    t0->producer()->set_perm({1, 0});
+    Value* t1 = gb.Op(Node::kTranspose, {input});
+    t1->producer()->set_perm({0, 1});
+    Value* sum = gb.Op(Node::kAdd, {dim0, dim1});
+    gb.Op(Node::kAdd, {t0, t1}, output);
+    gb.Op(Node::kReshape, {input, sum}, output2);
+    ASSERT_EQ(11, graph.GetLiveNodes().size());
+
+    EliminateCommonSubexpressions(&graph);
+    graph.DeleteDetached();
+    EXPECT_EQ(8, graph.nodes().size());
+    const Node& add = *sum->producer();
+    EXPECT_EQ(add.input(0), add.input(1));
+    const Node& output_add = *output->producer();
+    EXPECT_NE(output_add.input(0), output_add.input(1));
+    EXPECT_EQ(2, add.input(0)->users().size());
+    graph.CheckSanity("cse");
+}
+
+}  // namespace
+}  // namespace chainer_compiler
@@ -1,101 +1,215 @@
 #include "compiler/constant_propagation.h"
 
+#include <algorithm>
+#include <set>
 #include <vector>
 
 #include <compiler/evaluator.h>
+#include <compiler/flags.h>
 #include <compiler/graph.h>
 #include <compiler/graph_builder.h>
 #include <compiler/log.h>
 #include <compiler/node.h>
 #include <compiler/tensor.h>
+#include <compiler/type.h>
 #include <compiler/value.h>
 
 namespace chainer_compiler {
 
 namespace {
 
-bool HasConstantInputsOnly(const Node& node) {
-    if (node.inputs().empty()) return false;
-    for (Value* input : node.inputs()) {
-        if (input->producer() &&
-            (input->producer()->op_type() == Node::kConstant || input->producer()->op_type() == Node::kChainerSequenceConstants ||
-             input->producer()->op_type() == Node::kChainerSequenceCreate)) {
-        } else {
+bool IsConstant(const Node& node) {
+    switch (node.op_type()) {
+        case Node::kConstant:
+        case Node::kChainerSequenceConstants:
+        case Node::kChainerSequenceCreate:
+            return true;
+        default:
             return false;
-        }
-    }
-    return true;
-}
-
-void DoConstantPropagation(Graph* graph, Node* node) {
-    CLOG() << "Propagate " << node->ToString() << std::endl;
-    std::vector<Node*> inputs;
-    for (Value* input : node->inputs()) inputs.push_back(input->producer());
-
-    std::vector<std::unique_ptr<EvaluatedValue>> next_values;
-    std::vector<Node*> nodes = inputs;
-    nodes.push_back(node);
-    Eval(nodes, node->outputs(), &next_values);
-
-    for (size_t i = 0; i < next_values.size(); ++i) {
-        auto& next_value = next_values[i];
-        GraphBuilder gb(graph, "Const", node->output(i));
-        if (next_value->is_tensor()) {
-            gb.Op(Node::kConstant, {}, node->output(i))->producer()->set_tensor_value(next_value->ReleaseTensor());
-        } else {
-            gb.Op(Node::kChainerSequenceConstants, {}, node->output(i))->producer()->set_tensor_values(next_value->ReleaseSequence());
-        }
-    }
-
-    graph->DetachNode(node);
-    for (Node* input : inputs) {
-        if (input->output(0)->users().empty()) {
-            graph->DetachNode(input);
-        }
     }
 }
 
-bool MaybePropagateConstant(Graph* graph, Node* node) {
-    switch (node->op_type()) {
-        // TODO(hamaji): Handle more ops.
+// Deterministic ops which do not depend on states of the runtime.
+bool IsPropagatable(const Node& node) {
+    switch (node.op_type()) {
+        // Element-wise ops.
         case Node::kIdentity:
+        case Node::kNeg:
+        case Node::kReciprocal:
+        case Node::kExp:
+        case Node::kLog:
+        case Node::kSqrt:
+        case Node::kAbs:
+        case Node::kNot:
+        case Node::kFloor:
+        case Node::kCeil:
         case Node::kAdd:
         case Node::kSub:
         case Node::kMul:
         case Node::kDiv:
-        case Node::kChainerGenericIs:
-        case Node::kChainerGenericLen:
+        case Node::kPow:
+        case Node::kEqual:
+        case Node::kGreater:
+        case Node::kLess:
+        case Node::kAnd:
+        case Node::kOr:
+        case Node::kXor:
+        case Node::kSum:
+        case Node::kMax:
+        case Node::kMin:
+        case Node::kClip:
+        case Node::kCast:
+        // Shape and layout ops.
         case Node::kShape:
+        case Node::kSize:
+        case Node::kReshape:
+        case Node::kExpand:
+        case Node::kSqueeze:
         case Node::kUnsqueeze:
+        case Node::kFlatten:
+        case Node::kSlice:
+        case Node::kDynamicSlice:
         case Node::kGather:
-        case Node::kCast:
+        case Node::kConcat:
+        case Node::kSplit:
+        case Node::kTranspose:
+        case Node::kConstantFill:
+        // Reductions.
+        case Node::kReduceSum:
+        case Node::kReduceMax:
+        case Node::kReduceMin:
+        case Node::kReduceMean:
+        // Sequence ops.
+        case Node::kChainerGenericIs:
+        case Node::kChainerGenericLen:
+        case Node::kChainerGenericGetItem:
         case Node::kChainerSequenceAppend:
+        case Node::kChainerSequenceLookup:
         case Node::kChainerSequenceConcat:
         case Node::kChainerSequenceStack:
-        case Node::kChainerSequenceRange: {
-            DoConstantPropagation(graph, node);
+        case Node::kChainerSequenceSize:
+        case Node::kChainerSequenceRange:
             return true;
-        }
+        default:
+            return false;
+    }
+}
 
+// Ops whose outputs may be much larger than their inputs.
+bool MayExpand(const Node& node) {
+    switch (node.op_type()) {
+        case Node::kExpand:
+        case Node::kConstantFill:
+        case Node::kChainerSequenceRange:
+            return true;
         default:
+            return false;
+    }
+}
+
+// Large constants make programs large and are computed only once at
+// runtime anyway.
+bool HasSmallOutputs(const Node& node) {
+    if (g_constant_propagation_max_bytes < 0) return true;
+    for (Value* output : node.outputs()) {
+        if (output->IsNull() || output->type().kind() != Type::Kind::kTensor) continue;
+        const int64_t nbytes = output->GetNBytes();
+        if (nbytes < 0 ? MayExpand(node) : nbytes > g_constant_propagation_max_bytes) return false;
+    }
+    return true;
+}
+
+// Returns nodes which can be computed from constants, in a
+// topological order. Each node is visited once when all its inputs
+// become constant.
+std::vector<Node*> FindPropagatableNodes(const Graph& graph) {
+    std::vector<Node*> found;
+    std::set<Node*> found_set;
+    auto is_constant = [&found_set](const Value* value) {
+        Node* producer = value->producer();
+        return producer && !producer->detached() && (IsConstant(*producer) || found_set.count(producer));
+    };
+    auto maybe_add = [&found, &found_set, &is_constant](Node* node) {
+        if (node->detached() || node->inputs().empty() || found_set.count(node)) return;
+        for (Value* input : node->inputs()) {
+            if (!is_constant(input)) return;
+        }
+        if (!IsPropagatable(*node) || !HasSmallOutputs(*node)) {
             CLOG() << "Not propagate " << node->ToString() << std::endl;
+            return;
+        }
+        found.push_back(node);
+        found_set.insert(node);
+    };
+
+    for (Node* node : graph.GetLiveNodes()) maybe_add(node);
+    for (size_t i = 0; i < found.size(); ++i) {
+        for (Value* output : found[i]->outputs()) {
+            for (Node* user : output->users()) maybe_add(user);
+        }
     }
-    return false;
+    return found;
 }
 
 }  // namespace
 
 void PropagateConstants(Graph* graph) {
-    bool replaced = true;
-    while (replaced) {
-        replaced = false;
-        for (Node* node : graph->GetLiveNodes()) {
-            if (!HasConstantInputsOnly(*node)) continue;
-            if (MaybePropagateConstant(graph, node)) {
-                replaced = true;
+    const std::vector<Node*> nodes = FindPropagatableNodes(*graph);
+    if (nodes.empty()) return;
+    const std::set<Node*> node_set(nodes.begin(), nodes.end());
+
+    // All nodes are evaluated by a single run of XCVM. Only values
+    // used outside of them are fetched and become constants.
+    std::vector<Node*> inputs;
+    std::set<Node*> input_set;
+    std::vector<Value*> fetches;
+    for (Node* node : nodes) {
+        CLOG() << "Propagate " << node->ToString() << std::endl;
+        for (Value* input : node->inputs()) {
+            Node* producer = input->producer();
+            if (!node_set.count(producer) && input_set.insert(producer).second) inputs.push_back(producer);
+        }
+        for (Value* output : node->outputs()) {
+            if (output->IsNull()) continue;
+            const std::vector<Node*>& users = output->users();
+            if (output->IsOutput() || std::any_of(users.begin(), users.end(), [&node_set](Node* user) { return !node_set.count(user); })) {
+                fetches.push_back(output);
             }
         }
     }
+
+    if (!fetches.empty()) {
+        std::vector<Node*> eval_nodes = inputs;
+        eval_nodes.insert(eval_nodes.end(), nodes.begin(), nodes.end());
+        std::vector<std::unique_ptr<EvaluatedValue>> next_values;
+        Eval(eval_nodes, fetches, &next_values);
+
+        for (size_t i = 0; i < next_values.size(); ++i) {
+            auto& next_value = next_values[i];
+            GraphBuilder gb(graph, "Const", fetches[i]);
+            if (next_value->is_tensor()) {
+                gb.Op(Node::kConstant, {}, fetches[i])->producer()->set_tensor_value(next_value->ReleaseTensor());
+            } else {
+                gb.Op(Node::kChainerSequenceConstants, {}, fetches[i])->producer()->set_tensor_values(next_value->ReleaseSequence());
+            }
+        }
+    }
+
+    for (Node* node : nodes) {
+        graph->DetachNode(node);
+    }
+    int num_removed = nodes.size();
+    for (Node* input : inputs) {
+        if (input->output(0)->users().empty() && !input->output(0)->IsOutput()) {
+            graph->DetachNode(input);
+            ++num_removed;
+        }
+    }
+
+    if (g_dump_constant_propagation) {
+        std::cerr << "Constant propagation in " << graph->name() << ": folded " << nodes.size() << " nodes into " << fetches.size()
+                  << " constants, " << num_removed - static_cast<int>(fetches.size()) << " instructions eliminated" << std::endl;
+    }
 }
 
 }  // namespace chainer_compiler
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include <chainerx/context.h>
+
+#include <compiler/constant_propagation.h>
+#include <compiler/flags.h>
+#include <compiler/graph.h>
+#include <compiler/graph_builder.h>
+#include <compiler/node.h>
+#include <compiler/tensor.h>
+#include <compiler/value.h>
+
+namespace chainer_compiler {
+namespace {
+
+TEST(ConstantPropagationTest, Chain) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    const Type type(Dtype::kInt32, {2});
+    Graph graph("test");
+    Value* input = graph.AddInputValue("input", type);
+    Value* output = graph.AddOutputValue("output", type);
+    Value* output2 = graph.AddOutputValue("output2", type);
+    GraphBuilder gb(&graph, "test", output);
+    Value* a = gb.Const(type, {3, 10});
+    Value* b = gb.Const(type, {7, 32});
+    Value* sum = gb.Op(Node::kAdd, {a, b});
+    Value* product = gb.Op(Node::kMul, {sum, b});
+    gb.Op(Node::kAdd, {input, product}, output);
+    gb.Op(Node::kSub, {product, sum}, output2);
+
+    PropagateConstants(&graph);
+    graph.DeleteDetached();
+
+    // Only values used by non-constant nodes or graph outputs remain.
+    ASSERT_EQ(3, graph.nodes().size());
+    const Node* product_node = product->producer();
+    ASSERT_EQ(Node::kConstant, product_node->op_type());
+    EXPECT_EQ(70, product_node->tensor_value()->Get<int>(0));
+    EXPECT_EQ(1344, product_node->tensor_value()->Get<int>(1));
+    const Node* output2_node = output2->producer();
+    ASSERT_EQ(Node::kConstant, output2_node->op_type());
+    EXPECT_EQ(60, output2_node->tensor_value()->Get<int>(0));
+    EXPECT_EQ(1302, output2_node->tensor_value()->Get<int>(1));
+    EXPECT_EQ(Node::kAdd, output->producer()->op_type());
+    graph.CheckSanity("propagated");
+}
+
+TEST(ConstantPropagationTest, SequenceOutputs) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    const Type type(Dtype::kInt32, {2});
+    Graph graph("test");
+    Value* output = graph.AddOutputValue("output", Type(Type::Kind::kSequence));
+    Value* output2 = graph.AddOutputValue("output2", Type(Type::Kind::kSequence));
+    GraphBuilder gb(&graph, "test", output);
+    Value* seq = gb.Op(Node::kChainerSequenceCreate, {});
+    gb.Op(Node::kChainerSequenceAppend, {seq, gb.Const(type, {3, 10})}, output);
+    // `output` has a single user but must not be moved.
+    gb.Op(Node::kChainerSequenceAppend, {output, gb.Const(type, {7, 32})}, output2);
+
+    PropagateConstants(&graph);
+    graph.DeleteDetached();
+
+    ASSERT_EQ(Node::kChainerSequenceConstants, output->producer()->op_type());
+    EXPECT_EQ(1, output->producer()->tensor_values().size());
+    ASSERT_EQ(Node::kChainerSequenceConstants, output2->producer()->op_type());
+    EXPECT_EQ(2, output2->producer()->tensor_values().size());
+    graph.CheckSanity("propagated");
+}
+
+TEST(ConstantPropagationTest, MaxBytes) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    for (int max_bytes : {-1, 16}) {
+        const Type type(Dtype::kFloat32, {3, 2});
+        Graph graph("test");
+        Value* output = graph.AddOutputValue("output", type);
+        GraphBuilder gb(&graph, "test", output);
+        Value* a = gb.Const(Type(Dtype::kFloat32, {2, 3}), {1, 2, 3, 4, 5, 6});
+        Value* shape = gb.Const(Type(Dtype::kInt64, {2}), {3, 2});
+        gb.Op(Node::kReshape, {a, shape}, output);
+
+        g_constant_propagation_max_bytes = max_bytes;
+        PropagateConstants(&graph);
+        g_constant_propagation_max_bytes = 1024 * 1024;
+        graph.DeleteDetached();
+
+        if (max_bytes < 0) {
+            ASSERT_EQ(1, graph.nodes().size());
+            ASSERT_EQ(Node::kConstant, output->producer()->op_type());
+            EXPECT_EQ(6.0, output->producer()->tensor_value()->Get<float>(5));
+        } else {
+            EXPECT_EQ(3, graph.nodes().size());
+            EXPECT_EQ(Node::kReshape, output->producer()->op_type());
+        }
+    }
+}
+
+}  // namespace
+}  // namespace chainer_compiler
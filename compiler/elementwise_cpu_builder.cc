@@ -0,0 +1,167 @@
+#include "compiler/elementwise_cpu_builder.h"
+
+#include <algorithm>
+#include <map>
+
+#include <common/log.h>
+#include <compiler/node.h>
+#include <compiler/tensor.h>
+#include <compiler/topology.h>
+#include <compiler/value.h>
+#include <runtime/xcvm.pb.h>
+
+namespace chainer_compiler {
+
+using runtime::XCInstructionProto;
+
+namespace {
+
+XCInstructionProto::Op GetElementWiseOp(const Node& node) {
+    switch (node.op_type()) {
+        case Node::kIdentity:
+            return XCInstructionProto::Identity;
+        case Node::kAdd:
+            return XCInstructionProto::Add;
+        case Node::kSub:
+            return XCInstructionProto::Sub;
+        case Node::kMul:
+            return XCInstructionProto::Mul;
+        case Node::kDiv:
+            return XCInstructionProto::Div;
+        case Node::kTanh:
+            return XCInstructionProto::Tanh;
+        case Node::kSigmoid:
+            return XCInstructionProto::Sigmoid;
+        case Node::kExp:
+            return XCInstructionProto::Exp;
+        case Node::kLog:
+            return XCInstructionProto::Log;
+        case Node::kSqrt:
+            return XCInstructionProto::Sqrt;
+        case Node::kNeg:
+            return XCInstructionProto::Neg;
+        case Node::kPow:
+            return XCInstructionProto::Pow;
+        case Node::kRelu:
+            return XCInstructionProto::Relu;
+        case Node::kLeakyRelu:
+            return XCInstructionProto::LeakyRelu;
+        case Node::kElu:
+            return XCInstructionProto::Elu;
+        case Node::kClip:
+            return XCInstructionProto::Clip;
+        case Node::kReduceSum:
+            return XCInstructionProto::ReduceSum;
+        case Node::kReduceMean:
+            return XCInstructionProto::ReduceMean;
+        default:
+            CHECK(false) << "Cannot build ElementWiseCpu program for: " << node.ToString();
+    }
+    return XCInstructionProto::Identity;
+}
+
+double GetScalarConstant(const Node& node) {
+    const Tensor& t = *node.tensor_value();
+    CHECK_EQ(1, t.NumElements()) << node.ToString();
+    switch (t.dtype()) {
+        case Dtype::kFloat32:
+            return t.Get<float>(0);
+        case Dtype::kFloat64:
+            return t.Get<double>(0);
+        default:
+            CHECK(false) << t.dtype();
+    }
+    return 0;
+}
+
+}  // namespace
+
+int GetNumReducedTrailingAxes(const Node& node) {
+    if (node.op_type() != Node::kReduceSum && node.op_type() != Node::kReduceMean) return -1;
+    if (!node.keepdims() || node.inputs().size() != 1) return -1;
+    const Type& type = node.input(0)->type();
+    if (!type.HasKnownShape()) return -1;
+    const int ndim = type.ndim();
+    if (node.axes().empty()) return ndim;
+    std::vector<int64_t> axes;
+    for (int64_t axis : node.axes()) axes.push_back(axis < 0 ? axis + ndim : axis);
+    std::sort(axes.begin(), axes.end());
+    for (size_t i = 0; i < axes.size(); ++i) {
+        if (axes[i] != ndim - static_cast<int>(axes.size() - i)) return -1;
+    }
+    return axes.size();
+}
+
+void BuildElementWiseCpuProgram(
+        const std::vector<Node*>& nodes,
+        const std::vector<Value*>& inputs,
+        const std::vector<Value*>& outputs,
+        std::vector<int64_t>* program,
+        std::vector<double>* constants,
+        std::vector<int64_t>* output_regs) {
+    std::map<const Value*, int64_t> regs;
+    int64_t num_regs = 0;
+    for (Value* value : inputs) {
+        CHECK(regs.emplace(value, num_regs++).second);
+    }
+    // Attributes are passed as constants, too.
+    std::map<const Node*, int64_t> attr_regs;
+    auto add_constant = [constants, &num_regs](double value) {
+        constants->push_back(value);
+        return num_regs++;
+    };
+    for (Node* node : nodes) {
+        switch (node->op_type()) {
+            case Node::kConstant:
+                CHECK(regs.emplace(node->output(0), add_constant(GetScalarConstant(*node))).second);
+                break;
+            case Node::kLeakyRelu:
+            case Node::kElu:
+                attr_regs[node] = add_constant(node->alpha());
+                break;
+            case Node::kClip:
+                attr_regs[node] = add_constant(node->min());
+                add_constant(node->max());
+                break;
+            default:
+                break;
+        }
+    }
+
+    auto get_reg = [&regs](const Value* value) {
+        auto found = regs.find(value);
+        CHECK(found != regs.end()) << value->DebugString();
+        return found->second;
+    };
+
+    const std::vector<Node*> sorted_nodes = SortTopologically(nodes, inputs, false);
+    CHECK_EQ(nodes.size(), sorted_nodes.size());
+    for (Node* node : sorted_nodes) {
+        if (node->op_type() == Node::kConstant) continue;
+        CHECK_EQ(1, node->outputs().size()) << node->ToString();
+        CHECK_LE(1, node->inputs().size()) << node->ToString();
+        CHECK_GE(2, node->inputs().size()) << node->ToString();
+        program->push_back(GetElementWiseOp(*node));
+        const int64_t reg = num_regs++;
+        CHECK(regs.emplace(node->output(0), reg).second);
+        program->push_back(reg);
+        program->push_back(get_reg(node->input(0)));
+        auto found = attr_regs.find(node);
+        if (found != attr_regs.end()) {
+            program->push_back(found->second);
+        } else if (node->op_type() == Node::kReduceSum || node->op_type() == Node::kReduceMean) {
+            CHECK_EQ(node, sorted_nodes.back()) << "Reduction must be the last: " << node->ToString();
+            const int num_axes = GetNumReducedTrailingAxes(*node);
+            CHECK_LE(0, num_axes) << node->ToString();
+            program->push_back(num_axes);
+        } else {
+            program->push_back(node->inputs().size() == 2 ? get_reg(node->input(1)) : -1);
+        }
+    }
+
+    for (Value* value : outputs) {
+        output_regs->push_back(get_reg(value));
+    }
+}
+
+}  // namespace chainer_compiler
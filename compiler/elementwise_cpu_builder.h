@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace chainer_compiler {
+
+class Node;
+class Value;
+
+// Returns the number of trailing axes reduced by ReduceSum or
+// ReduceMean `node`, or -1 if ElementWiseCpu cannot run `node` as its
+// reduction epilogue.
+int GetNumReducedTrailingAxes(const Node& node);
+
+// Builds a program for ElementWiseCpu from a fusion group made of
+// element-wise `nodes`, optionally followed by a reduction. Registers
+// are numbered in the order of `inputs`, constants, and temporary
+// values. `program` is a sequence of (op, output register, first
+// input register, second input register or -1) where op is an
+// XCInstructionProto::Op, with a few exceptions:
+//
+// - LeakyRelu and Elu take alpha from the second register.
+// - Clip takes min and max from the second register and the next one.
+// - ReduceSum and ReduceMean, which must be the last instruction,
+//   keep dims and have the number of reduced trailing axes instead of
+//   the second register.
+//
+// `constants` keeps the values of constant registers and
+// `output_regs` keeps the registers of `outputs`.
+void BuildElementWiseCpuProgram(
+        const std::vector<Node*>& nodes,
+        const std::vector<Value*>& inputs,
+        const std::vector<Value*>& outputs,
+        std::vector<int64_t>* program,
+        std::vector<double>* constants,
+        std::vector<int64_t>* output_regs);
+
+}  // namespace chainer_compiler
@@ -81,7 +81,8 @@ void Eval(const std::vector<Node*>& nodes, const std::vector<Value*>& fetches, s
     chainerx::DeviceScope device_scope{chainerx::GetNativeBackend().GetDevice(0)};
 
     runtime::XCVM xcvm(program);
-    runtime::XCVMState state(runtime::XCVMOptions{}, xcvm.num_variables(), {});
+    runtime::InOuts inputs;
+    runtime::XCVMState state(runtime::XCVMOptions{}, xcvm.num_variables(), inputs);
     xcvm.Run(&state);
 
     for (size_t i = 0; i < fetches.size(); ++i) {
@@ -1,5 +1,7 @@
 #include "compiler/flags.h"
 
+#include <common/strutil.h>
+
 namespace chainer_compiler {
 
 bool g_compiler_log;
@@ -12,6 +14,8 @@ bool g_replace_constant;
 
 int g_recompute_relu;
 
+int g_memory_budget_mb;
+
 bool g_modify_pool_with_imbalanced_pads;
 
 bool g_use_cuda;
@@ -22,7 +26,15 @@ bool g_use_nvrtc;
 
 bool g_use_tvm;
 
-bool g_reuse_tvm_code;
+bool g_schedule_for_memory;
+
+bool g_plan_memory;
+
+bool g_inference_only;
+
+int g_constant_propagation_max_bytes = 1024 * 1024;
+
+std::string g_tvm_cache_dir;
 
 std::string g_dump_autotvm_task_dir;
 
@@ -37,4 +49,47 @@ bool g_dump_after_fusion;
 bool g_dump_after_scheduling;
 bool g_dump_subgraphs;
 
+bool g_dump_constant_propagation;
+
+bool g_dump_cse;
+
+std::string GetCompilerFlagsFingerprint() {
+    // Flags which only affect logs and dumps are not included.
+    return StrCat(
+            "permissive=",
+            g_permissive,
+            " skip_inference=",
+            g_skip_inference,
+            " replace_constant=",
+            g_replace_constant,
+            " recompute_relu=",
+            g_recompute_relu,
+            " memory_budget_mb=",
+            g_memory_budget_mb,
+            " modify_pool_with_imbalanced_pads=",
+            g_modify_pool_with_imbalanced_pads,
+            " use_cuda=",
+            g_use_cuda,
+            " fuse_operations=",
+            g_fuse_operations,
+            " use_nvrtc=",
+            g_use_nvrtc,
+            " use_tvm=",
+            g_use_tvm,
+            " schedule_for_memory=",
+            g_schedule_for_memory,
+            " plan_memory=",
+            g_plan_memory,
+            " inference_only=",
+            g_inference_only,
+            " constant_propagation_max_bytes=",
+            g_constant_propagation_max_bytes,
+            " tvm_cache_dir=",
+            g_tvm_cache_dir,
+            " autotvm_log=",
+            g_autotvm_log,
+            " backend=",
+            g_backend_name);
+}
+
 }  // namespace chainer_compiler
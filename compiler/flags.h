@@ -22,6 +22,10 @@ extern bool g_replace_constant;
 // this number of steps.
 extern int g_recompute_relu;
 
+// Recomputes cheap forward values in backprop until the simulated
+// peak memory fits in this budget. Zero means no budget.
+extern int g_memory_budget_mb;
+
 // Modifies MaxPool and AveragePool with imbalanced pads (e.g., (0, 0,
 // 1, 1)) so these ops will be split into Pad and Pool. This is
 // for backends such as Chainer which do not support imbalanced pads.
@@ -39,8 +43,27 @@ extern bool g_use_nvrtc;
 // Use TVM to execute fused operations.
 extern bool g_use_tvm;
 
-// Reuse existing TVM code. Unsafe.
-extern bool g_reuse_tvm_code;
+// Search computation orders with lower peak memory than the default
+// greedy scheduler at the cost of compilation time.
+extern bool g_schedule_for_memory;
+
+// Assign statically sized temporaries to offsets in a preallocated
+// arena. Only for inference.
+extern bool g_plan_memory;
+
+// Compile programs only for inference. This enables optimizations
+// which are invalid for training, e.g., folding BatchNormalization
+// into Conv. Such programs refuse to run for training.
+extern bool g_inference_only;
+
+// Constant propagation does not create constants larger than this.
+// Negative values mean no limit.
+extern int g_constant_propagation_max_bytes;
+
+// TVM kernels are kept in this directory keyed by hashes of their
+// computation, shared by processes. Empty means no cache. The
+// directory must be owned by and writable only by the current user.
+extern std::string g_tvm_cache_dir;
 
 // Output AutoTVM tasks in this directory.
 extern std::string g_dump_autotvm_task_dir;
@@ -59,4 +82,15 @@ extern bool g_dump_after_fusion;
 extern bool g_dump_after_scheduling;
 extern bool g_dump_subgraphs;
 
+// Reports the number of instructions eliminated by constant propagation.
+extern bool g_dump_constant_propagation;
+
+// Reports the number of nodes removed by common subexpression
+// elimination.
+extern bool g_dump_cse;
+
+// Returns a string which identifies the values of the flags above
+// which affect generated code. Used as a part of cache keys.
+std::string GetCompilerFlagsFingerprint();
+
 }  // namespace chainer_compiler
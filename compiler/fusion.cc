@@ -9,6 +9,8 @@
 #include <vector>
 
 #include <common/strutil.h>
+#include <compiler/elementwise_cpu_builder.h>
+#include <compiler/flags.h>
 #include <compiler/graph.h>
 #include <compiler/graph_builder.h>
 #include <compiler/node.h>
@@ -182,19 +184,70 @@ void FuseTVMOperations(Graph* graph) {
         CreateFusionGroup(graph, fused_nodes, "tvm", num_fusion_groups);
     }
 }
-void FuseElementwiseOperations(Graph* graph) {
+
+// Fuses Conv with a following residual Add and Relu so the runtime
+// can apply them while the output of Conv is still hot.
+void FuseConvOperations(Graph* graph, int* num_fusion_groups) {
+    auto single_user = [](Node* node, Node::OpType op_type) -> Node* {
+        if (node->outputs().size() != 1) return nullptr;
+        const std::vector<Node*>& users = node->output(0)->users();
+        if (users.size() != 1 || users[0]->op_type() != op_type) return nullptr;
+        if (users[0]->chainer_fusion_group() || users[0]->IsGradNode() != node->IsGradNode()) return nullptr;
+        return users[0];
+    };
+
+    for (Node* conv : graph->GetTopologicallySortedNodes()) {
+        if (conv->op_type() != Node::kConv || conv->chainer_fusion_group()) continue;
+        if (!conv->output(0)->type().dtype().IsFloat()) continue;
+        if (std::any_of(conv->dilations().begin(), conv->dilations().end(), [](int d) { return d != 1; })) continue;
+
+        std::set<Node*> nodes = {conv};
+        Node* last = conv;
+        if (Node* add = single_user(conv, Node::kAdd)) {
+            if (add->input(0) != add->input(1)) {
+                nodes.insert(add);
+                last = add;
+            }
+        }
+        if (Node* relu = single_user(last, Node::kRelu)) {
+            nodes.insert(relu);
+        }
+        if (nodes.size() <= 1) continue;
+
+        ++*num_fusion_groups;
+        for (Node* node : nodes) {
+            node->set_chainer_fusion_group(*num_fusion_groups);
+        }
+        CreateFusionGroup(graph, nodes, "conv", *num_fusion_groups);
+    }
+}
+
+void FuseElementwiseOperations(Graph* graph, int* num_fusion_groups) {
     // TODO(hamaji): Do not try fusing integer ops.
     const std::set<Node::OpType> fusable_ops = {
             Node::kIdentity,
             Node::kAdd,
             Node::kSub,
             Node::kMul,
-            // Node::kDiv,
+            Node::kDiv,
+            Node::kPow,
+            Node::kNeg,
             Node::kTanh,
             Node::kSigmoid,
             Node::kExp,
+            Node::kLog,
+            Node::kSqrt,
+            Node::kRelu,
+            Node::kLeakyRelu,
+            Node::kElu,
+            Node::kClip,
     };
 
+    // Values used by more nodes than this are not fused through. They
+    // must be materialized anyway and fusing them only makes groups
+    // larger.
+    const size_t kMaxFanOut = 4;
+
     auto is_fusable = [&fusable_ops](const Node& node) {
         if (node.op_type() == Node::kConstant) {
             Tensor* t = node.tensor_value().get();
@@ -211,12 +264,28 @@ void FuseElementwiseOperations(Graph* graph) {
         return true;
     };
 
-    int num_fusion_groups = 0;
+    // Only the CPU backend runs a reduction after element-wise ops.
+    auto is_fusable_reduction = [](const Node& node) { return !g_use_nvrtc && GetNumReducedTrailingAxes(node) >= 0; };
+
+    // All element-wise ops in a group must compute values of the same
+    // shape. Inputs of the group may be broadcasted to the shape. The
+    // CPU backend broadcasts all outputs to the shape of the group, so
+    // it requires the shapes to be known.
+    auto is_same_shape = [](const Type& ta, const Type& tb) {
+        if (!ta.HasKnownShape() || !tb.HasKnownShape()) return g_use_nvrtc;
+        return ta.dims() == tb.dims();
+    };
+    auto has_same_shape = [&is_same_shape](const Node& a, const Node& b) {
+        return is_same_shape(a.output(0)->type(), b.output(0)->type());
+    };
+
     for (Node* base_node : graph->nodes()) {
         if (base_node->chainer_fusion_group()) continue;
+        if (base_node->op_type() == Node::kConstant) continue;
         if (!is_fusable(*base_node)) continue;
 
         std::set<Node*> cands;
+        Node* reduction = nullptr;
         std::stack<Node*> q;
         q.push(base_node);
         while (!q.empty()) {
@@ -224,37 +293,78 @@ void FuseElementwiseOperations(Graph* graph) {
             CHECK_EQ(0, node->chainer_fusion_group());
             q.pop();
             if (!cands.emplace(node).second) continue;
+            // Constants are scalars which do not determine the shape.
+            if (node->op_type() == Node::kConstant) continue;
 
             for (Value* value : node->inputs()) {
                 Node* next_node = value->producer();
                 if (!next_node) continue;
                 if (!is_fusable(*next_node)) continue;
                 if (base_node->IsGradNode() != next_node->IsGradNode()) continue;
+                if (next_node->op_type() != Node::kConstant) {
+                    if (value->users().size() > kMaxFanOut) continue;
+                    if (!has_same_shape(*base_node, *next_node)) continue;
+                }
                 q.push(next_node);
             }
             for (Value* value : node->outputs()) {
+                if (value->users().size() > kMaxFanOut) continue;
                 for (Node* next_node : value->users()) {
-                    if (!is_fusable(*next_node)) continue;
                     if (base_node->IsGradNode() != next_node->IsGradNode()) continue;
+                    if (!reduction && !next_node->chainer_fusion_group() && is_fusable_reduction(*next_node) &&
+                        is_same_shape(base_node->output(0)->type(), value->type())) {
+                        // A reduction terminates the group.
+                        reduction = next_node;
+                        cands.insert(reduction);
+                        continue;
+                    }
+                    if (!is_fusable(*next_node)) continue;
+                    if (next_node->op_type() != Node::kConstant && !has_same_shape(*base_node, *next_node)) continue;
                     q.push(next_node);
                 }
             }
         }
 
+        // The reduction must be the last op in the group.
+        if (reduction) {
+            for (Node* user : reduction->output(0)->users()) {
+                if (cands.count(user)) {
+                    cands.erase(reduction);
+                    break;
+                }
+            }
+        }
+
         RejectCyclicNodes(&cands);
 
+        // Constants used outside would be outputs of the group, which
+        // are not scalars.
+        for (auto it = cands.begin(); it != cands.end();) {
+            const std::vector<Node*>& users = (*it)->output(0)->users();
+            if ((*it)->op_type() == Node::kConstant &&
+                std::any_of(users.begin(), users.end(), [&cands](Node* user) { return !cands.count(user); })) {
+                it = cands.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        // The input of the reduction must be computed in the group.
+        if (reduction && cands.count(reduction) && !cands.count(reduction->input(0)->producer())) {
+            cands.erase(reduction);
+        }
+
         int num_calculation = 0;
         for (Node* node : cands) {
             if (node->op_type() != Node::kIdentity && node->op_type() != Node::kConstant) ++num_calculation;
         }
         if (num_calculation <= 1) continue;
 
-        ++num_fusion_groups;
+        ++*num_fusion_groups;
         for (Node* node : cands) {
-            node->set_chainer_fusion_group(num_fusion_groups);
+            node->set_chainer_fusion_group(*num_fusion_groups);
         }
 
-        CreateFusionGroup(graph, cands, "nvrtc", num_fusion_groups);
+        CreateFusionGroup(graph, cands, "nvrtc", *num_fusion_groups);
     }
 }
 
@@ -271,7 +381,9 @@ void FuseOperations(Graph* graph, bool use_tvm) {
     if (use_tvm) {
         FuseTVMOperations(graph);
     } else {
-        FuseElementwiseOperations(graph);
+        int num_fusion_groups = 0;
+        FuseConvOperations(graph, &num_fusion_groups);
+        FuseElementwiseOperations(graph, &num_fusion_groups);
     }
 }
 
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 
+#include <common/strutil.h>
 #include <compiler/fusion.h>
 #include <compiler/graph.h>
 #include <compiler/graph_builder.h>
@@ -13,7 +14,7 @@ TEST(FusionTest, Basic) {
     Value* input = graph.AddInputValue("input", type);
     Value* output = graph.AddOutputValue("output", type);
     GraphBuilder gb(&graph, "test", output);
-    Value* tmp = gb.Op(Node::kTanh, {input});
+    Value* tmp = gb.Op(Node::kTanh, {input}, gb.Temp(type));
     gb.Op(Node::kSigmoid, {tmp}, {output});
 
     FuseOperations(&graph);
@@ -25,5 +26,78 @@ TEST(FusionTest, Basic) {
     graph.CheckSanity("fused");
 }
 
+TEST(FusionTest, BroadcastAndReduction) {
+    Type type(Dtype::kFloat32, {2, 3});
+    Graph graph("test");
+    Value* x = graph.AddInputValue("x", type);
+    Value* b = graph.AddInputValue("b", Type(Dtype::kFloat32, {3}));
+    Value* output = graph.AddOutputValue("output", Type(Dtype::kFloat32, {2, 1}));
+    GraphBuilder gb(&graph, "test", output);
+    Value* t = gb.Op(Node::kAdd, {x, b}, gb.Temp(type));
+    t = gb.Op(Node::kDiv, {t, gb.Const(Type(Dtype::kFloat32, {}), {2.0})}, gb.Temp(type));
+    t = gb.Op(Node::kRelu, {t}, gb.Temp(type));
+    gb.Op(Node::kReduceMean, {t}, output)->producer()->set_axes({-1});
+
+    FuseOperations(&graph);
+    ASSERT_EQ(1, graph.nodes().size());
+    const Node& node = *graph.nodes()[0];
+    ASSERT_EQ(Node::kChainerFusionGroup, node.op_type());
+    EXPECT_EQ(2, node.inputs().size());
+    EXPECT_EQ(5, node.subgraph()->nodes().size());
+    graph.CheckSanity("fused");
+}
+
+TEST(FusionTest, UnknownShape) {
+    Graph graph("test");
+    Value* input = graph.AddInputValue("input", Type(Dtype::kFloat32));
+    Value* output = graph.AddOutputValue("output", Type(Dtype::kFloat32));
+    GraphBuilder gb(&graph, "test", output);
+    Value* tmp = gb.Op(Node::kTanh, {input});
+    gb.Op(Node::kSigmoid, {tmp}, {output});
+
+    FuseOperations(&graph);
+    for (const Node* node : graph.nodes()) {
+        EXPECT_NE(Node::kChainerFusionGroup, node->op_type());
+    }
+}
+
+TEST(FusionTest, FanOut) {
+    Type type(Dtype::kFloat32, {2, 3});
+    Graph graph("test");
+    Value* input = graph.AddInputValue("input", type);
+    GraphBuilder gb(&graph, "test", input);
+    Value* t = gb.Op(Node::kTanh, {input}, gb.Temp(type));
+    for (int i = 0; i < 5; ++i) {
+        gb.Op(Node::kExp, {t}, graph.AddOutputValue(StrCat("output", i), type));
+    }
+
+    FuseOperations(&graph);
+    for (const Node* node : graph.nodes()) {
+        EXPECT_NE(Node::kChainerFusionGroup, node->op_type());
+    }
+}
+
+TEST(FusionTest, ConvAddRelu) {
+    Type type(Dtype::kFloat32, {1, 2, 3, 3});
+    Graph graph("test");
+    Value* x = graph.AddInputValue("x", type);
+    Value* w = graph.AddInputValue("w", Type(Dtype::kFloat32, {2, 2, 1, 1}));
+    Value* residual = graph.AddInputValue("residual", type);
+    Value* output = graph.AddOutputValue("output", type);
+    GraphBuilder gb(&graph, "test", output);
+    Value* conv = gb.Op(Node::kConv, {x, w}, gb.Temp(type));
+    Value* add = gb.Op(Node::kAdd, {residual, conv}, gb.Temp(type));
+    gb.Op(Node::kRelu, {add}, {output});
+
+    FuseOperations(&graph);
+    ASSERT_EQ(1, graph.nodes().size());
+    const Node& node = *graph.nodes()[0];
+    ASSERT_EQ(Node::kChainerFusionGroup, node.op_type());
+    EXPECT_EQ("conv", node.fusion_type());
+    EXPECT_EQ(3, node.inputs().size());
+    EXPECT_EQ(3, node.subgraph()->nodes().size());
+    graph.CheckSanity("fused");
+}
+
 }  // namespace
 }  // namespace chainer_compiler
@@ -200,6 +200,19 @@ Node* Graph::AddNode(Node::OpType op_type, const std::vector<Value*>& inputs, co
     return node;
 }
 
+Node* Graph::CloneNode(
+        const Node& node, const std::vector<Value*>& inputs, const std::vector<Value*>& outputs, const std::string& base) {
+    onnx::NodeProto xnode;
+    node.ToONNX(&xnode);
+    xnode.clear_input();
+    xnode.clear_output();
+    xnode.set_name(GenSym(base.empty() ? Node::OpTypeToString(node.op_type()) : base));
+    Node* cloned = new Node(xnode, inputs, outputs);
+    cloned->set_chainer_order(-1);
+    AddNodeImpl(std::unique_ptr<Node>(cloned), inputs, outputs);
+    return cloned;
+}
+
 void Graph::DetachNode(Node* node) {
     node->Detach();
 }
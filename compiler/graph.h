@@ -78,6 +78,11 @@ public:
     Node* AddNode(
             Node::OpType op_type, const std::vector<Value*>& inputs, const std::vector<Value*>& outputs, const std::string& base = "");
 
+    // Creates a new node which has the op type and the attributes of
+    // `node`. The new node is not scheduled.
+    Node* CloneNode(
+            const Node& node, const std::vector<Value*>& inputs, const std::vector<Value*>& outputs, const std::string& base = "");
+
     void DetachNode(Node* node);
 
     std::vector<Node*> GetTopologicallySortedNodes() const;
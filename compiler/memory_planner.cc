@@ -0,0 +1,133 @@
+#include "compiler/memory_planner.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <common/log.h>
+#include <compiler/graph.h>
+#include <compiler/log.h>
+#include <compiler/node.h>
+#include <compiler/value.h>
+
+namespace chainer_compiler {
+
+namespace {
+
+// Aligned for vectorized loads and CUDA kernels.
+const int64_t kAlignment = 256;
+
+int64_t AlignUp(int64_t size) {
+    return (size + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+struct Interval {
+    const Value* value;
+    int64_t size;
+    // Indices in the computation sequence.
+    int begin;
+    int end;
+    int64_t offset;
+};
+
+}  // namespace
+
+bool CanWriteToPreallocatedOutput(Node::OpType op_type) {
+    switch (op_type) {
+        case Node::kAdd:
+        case Node::kSub:
+        case Node::kMul:
+        case Node::kDiv:
+        case Node::kExp:
+        case Node::kLog:
+        case Node::kSqrt:
+        case Node::kTanh:
+        case Node::kRelu:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool IsAliasFreeOp(Node::OpType op_type) {
+    if (CanWriteToPreallocatedOutput(op_type)) return true;
+    switch (op_type) {
+        case Node::kNeg:
+        case Node::kReciprocal:
+        case Node::kAbs:
+        case Node::kSigmoid:
+        case Node::kConv:
+        case Node::kMatMul:
+        case Node::kGemm:
+        case Node::kSoftmax:
+        case Node::kLogSoftmax:
+        case Node::kReduceSum:
+        case Node::kReduceMean:
+            return true;
+        default:
+            return false;
+    }
+}
+
+MemoryPlan PlanMemory(const Graph& graph) {
+    std::vector<const Node*> nodes(graph.GetComputationSequence());
+    std::map<const Node*, int> node_index;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        node_index.emplace(nodes[i], i);
+    }
+
+    std::vector<Interval> intervals;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const Node* node = nodes[i];
+        if (!CanWriteToPreallocatedOutput(node->op_type())) continue;
+        for (const Value* value : node->outputs()) {
+            if (!value->IsTemp() || value->IsNull() || value->users().empty()) continue;
+            const int64_t size = value->GetNBytes();
+            if (size <= 0) continue;
+
+            int end = i;
+            bool ok = true;
+            for (const Node* user : value->users()) {
+                auto found = node_index.find(user);
+                if (found == node_index.end() || !IsAliasFreeOp(user->op_type())) {
+                    ok = false;
+                    break;
+                }
+                end = std::max(end, found->second);
+            }
+            if (!ok) continue;
+            intervals.push_back(Interval{value, AlignUp(size), static_cast<int>(i), end, -1});
+        }
+    }
+
+    // Greedy by size: place larger values first at the lowest offset
+    // which does not conflict with values alive at the same time.
+    std::stable_sort(intervals.begin(), intervals.end(), [](const Interval& a, const Interval& b) { return a.size > b.size; });
+
+    MemoryPlan plan;
+    std::vector<const Interval*> placed;
+    for (Interval& interval : intervals) {
+        std::vector<const Interval*> conflicts;
+        for (const Interval* p : placed) {
+            if (p->begin <= interval.end && interval.begin <= p->end) conflicts.push_back(p);
+        }
+        std::sort(conflicts.begin(), conflicts.end(), [](const Interval* a, const Interval* b) { return a->offset < b->offset; });
+
+        int64_t offset = 0;
+        for (const Interval* p : conflicts) {
+            if (offset + interval.size <= p->offset) break;
+            offset = std::max(offset, p->offset + p->size);
+        }
+        interval.offset = offset;
+        placed.push_back(&interval);
+        plan.arena_size = std::max(plan.arena_size, offset + interval.size);
+        CHECK(plan.offsets.emplace(interval.value, offset).second);
+    }
+
+    int64_t total = 0;
+    for (const Interval& interval : intervals) total += interval.size;
+    CLOG() << "Memory plan: " << intervals.size() << " values of " << total << " bytes in an arena of " << plan.arena_size << " bytes"
+           << std::endl;
+    return plan;
+}
+
+}  // namespace chainer_compiler
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+
+#include <compiler/node.h>
+
+namespace chainer_compiler {
+
+class Graph;
+class Value;
+
+// Returns true if the XCVM op for `op_type` can write its output into
+// an array given by the runtime, i.e., a region of the arena or its
+// own input.
+bool CanWriteToPreallocatedOutput(Node::OpType op_type);
+
+// Returns true if the XCVM op for `op_type` returns arrays which are
+// not shared with anything else and keeps no references to its
+// inputs. Views such as Reshape or Identity are not.
+bool IsAliasFreeOp(Node::OpType op_type);
+
+struct MemoryPlan {
+    // The number of bytes of the arena which holds all planned values.
+    int64_t arena_size{0};
+    // Offsets in the arena. Values whose lifetimes overlap never
+    // share bytes.
+    std::map<const Value*, int64_t> offsets;
+};
+
+// Assigns an offset in a single arena to each temporary value of
+// `graph` with a statically known size. Lifetimes are taken from the
+// computation sequence so `graph` must be scheduled. Only values
+// produced by ops which can write into a preallocated output and
+// consumed by ops which never keep references to their inputs are
+// planned, as other values may be aliased after their last use.
+MemoryPlan PlanMemory(const Graph& graph);
+
+}  // namespace chainer_compiler
@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include <compiler/onnx.h>
+
+#include <common/log.h>
+#include <compiler/graph.h>
+#include <compiler/memory_planner.h>
+#include <compiler/node.h>
+#include <compiler/scheduler.h>
+#include <compiler/type.h>
+#include <compiler/value.h>
+
+namespace chainer_compiler {
+namespace {
+
+TEST(MemoryPlannerTest, Basic) {
+    const Type type(Dtype::kFloat32, {1024});
+    Graph graph("test");
+    Value* in = graph.AddInputValue("in", type);
+    Value* out = graph.AddOutputValue("out", type);
+    Value* t0 = graph.AddValue("t0", type);
+    Value* t1 = graph.AddValue("t1", type);
+    Value* t2 = graph.AddValue("t2", type);
+    graph.AddNode(Node::kAdd, {in, in}, {t0});
+    graph.AddNode(Node::kRelu, {t0}, {t1});
+    graph.AddNode(Node::kExp, {t1}, {t2});
+    graph.AddNode(Node::kMul, {t2, in}, {out});
+    ScheduleComputation(graph, 0);
+
+    MemoryPlan plan = PlanMemory(graph);
+    ASSERT_EQ(3UL, plan.offsets.size());
+    EXPECT_EQ(0, plan.offsets.count(in));
+    EXPECT_EQ(0, plan.offsets.count(out));
+    // t0 is dead when t2 is computed.
+    EXPECT_EQ(plan.offsets[t0], plan.offsets[t2]);
+    EXPECT_NE(plan.offsets[t0], plan.offsets[t1]);
+    EXPECT_EQ(4096 * 2, plan.arena_size);
+}
+
+TEST(MemoryPlannerTest, Aliasing) {
+    const Type type(Dtype::kFloat32, {4, 4});
+    Graph graph("test");
+    Value* in = graph.AddInputValue("in", type);
+    Value* out = graph.AddOutputValue("out", Type(Dtype::kFloat32, {16}));
+    Value* t0 = graph.AddValue("t0", type);
+    Value* shape = graph.AddInputValue("shape", Type(Dtype::kInt64, {1}));
+    graph.AddNode(Node::kAdd, {in, in}, {t0});
+    // Reshape may return a view of `t0`.
+    graph.AddNode(Node::kReshape, {t0, shape}, {out});
+    ScheduleComputation(graph, 0);
+
+    MemoryPlan plan = PlanMemory(graph);
+    EXPECT_TRUE(plan.offsets.empty());
+    EXPECT_EQ(0, plan.arena_size);
+}
+
+}  // namespace
+}  // namespace chainer_compiler
@@ -12,9 +12,11 @@ namespace chainer_compiler {
 SimulatedMemoryUsage SimulateMemoryUsage(const Graph& graph) {
     std::map<const Value*, int> num_users;
     SimulatedMemoryUsage usage{};
+    usage.peak_step = -1;
     int64_t mem = 0;
+    int step = -1;
 
-    auto alloc = [&usage, &mem](const Value* value) {
+    auto alloc = [&usage, &mem, &step](const Value* value) {
         const int64_t increase = value->GetNBytes();
         usage.num_values++;
         if (increase < 0) {
@@ -25,7 +27,10 @@ SimulatedMemoryUsage SimulateMemoryUsage(const Graph& graph) {
         }
         mem += increase;
         usage.all += increase;
-        usage.peak = std::max<int64_t>(usage.peak, mem);
+        if (usage.peak < mem) {
+            usage.peak = mem;
+            usage.peak_step = step;
+        }
     };
 
     for (const Value* value : graph.GetNecessaryValues()) {
@@ -44,6 +49,7 @@ SimulatedMemoryUsage SimulateMemoryUsage(const Graph& graph) {
 
     std::vector<const Node*> nodes(graph.GetComputationSequence());
     for (const Node* node : nodes) {
+        ++step;
         for (const Value* value : node->outputs()) {
             alloc(value);
         }
@@ -12,6 +12,9 @@ struct SimulatedMemoryUsage {
     int64_t all;
     int num_values;
     int num_unknowns;
+    // The index in the computation sequence of the node whose outputs
+    // made the peak. -1 if the peak consists only of inputs.
+    int peak_step;
 };
 
 SimulatedMemoryUsage SimulateMemoryUsage(const Graph& graph);
@@ -3,6 +3,7 @@
 #include <ctype.h>
 
 #include <algorithm>
+#include <cmath>
 #include <iterator>
 #include <map>
 #include <queue>
@@ -10,6 +11,7 @@
 #include <sstream>
 
 #include <common/log.h>
+#include <common/strutil.h>
 #include <compiler/code_emitter.h>
 #include <compiler/node.h>
 #include <compiler/tensor.h>
@@ -31,6 +33,11 @@ std::string CleanseIdent(const std::string& s, const char* prefix = "v_") {
     return o;
 }
 
+std::string FloatLiteral(double value) {
+    if (std::isinf(value)) return value > 0 ? "__int_as_float(0x7f800000)" : "__int_as_float(0xff800000)";
+    return StrCat("T(", value, ")");
+}
+
 void EmitNode(const Node* node, CodeEmitter* ce) {
     std::vector<std::string> ins;
     std::vector<std::string> outs;
@@ -64,6 +71,39 @@ void EmitNode(const Node* node, CodeEmitter* ce) {
             out1("sigmoid(" + ins[0] + ")");
             break;
 
+        case Node::kLog:
+            out1("log(" + ins[0] + ")");
+            break;
+
+        case Node::kSqrt:
+            out1("sqrt(" + ins[0] + ")");
+            break;
+
+        case Node::kNeg:
+            out1("-" + ins[0]);
+            break;
+
+        case Node::kRelu:
+            out1(ins[0] + " > 0 ? " + ins[0] + " : 0");
+            break;
+
+        case Node::kLeakyRelu:
+            out1(StrCat(ins[0], " > 0 ? ", ins[0], " : ", ins[0], " * ", FloatLiteral(node->alpha())));
+            break;
+
+        case Node::kElu:
+            out1(StrCat(ins[0], " > 0 ? ", ins[0], " : ", FloatLiteral(node->alpha()), " * (exp(", ins[0], ") - 1)"));
+            break;
+
+        case Node::kClip:
+            out1(StrCat("min(max(", ins[0], ", ", FloatLiteral(node->min()), "), ", FloatLiteral(node->max()), ")"));
+            break;
+
+        case Node::kPow:
+            CHECK_EQ(2UL, ins.size());
+            out1("pow(" + ins[0] + ", " + ins[1] + ")");
+            break;
+
         case Node::kAdd:
             binary('+');
             break;
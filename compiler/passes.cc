@@ -4,6 +4,9 @@
 #include <map>
 #include <memory>
 
+#include <compiler/algebraic_simplifier.h>
+#include <compiler/batch_normalization_folding.h>
+#include <compiler/common_subexpression_elimination.h>
 #include <compiler/config.h>
 #include <compiler/constant_propagation.h>
 #include <compiler/flags.h>
@@ -68,10 +71,19 @@ void RunDefaultPasses(Graph* graph, bool gen_backprop) {
 
     CanonicalizeSubGraphs(graph);
 
+    if (g_inference_only) {
+        CHECK(!gen_backprop) << "Gradients cannot be generated for inference only programs";
+        Recursively(FoldBatchNormalizations, graph);
+    }
+
     Recursively([&ccfg, gen_backprop](Graph* g) { Simplify(*ccfg, g, gen_backprop); }, graph);
 
     Recursively(PropagateConstants, graph);
 
+    Recursively(SimplifyAlgebraically, graph);
+
+    Recursively(EliminateCommonSubexpressions, graph);
+
     Recursively([](Graph* g) { g->DeleteDetached(); }, graph);
 
     dump_onnx(g_dump_after_simplification, "after simplification");
@@ -85,6 +97,10 @@ void RunDefaultPasses(Graph* graph, bool gen_backprop) {
 
     Recursively(PropagateConstants, graph);
 
+    Recursively(SimplifyAlgebraically, graph);
+
+    Recursively(EliminateCommonSubexpressions, graph);
+
     Recursively([](Graph* g) { g->DeleteDetached(); }, graph);
 
     dump_onnx(g_dump_after_gradient, "after gradient generation");
@@ -100,8 +116,17 @@ void RunDefaultPasses(Graph* graph, bool gen_backprop) {
         dump_onnx(g_dump_after_fusion, "after fusion");
     }
 
+    const SchedulerType scheduler_type = g_schedule_for_memory ? SchedulerType::kMemoryOptimal : SchedulerType::kGreedy;
     int64_t order = 0;
-    Recursively([&order](Graph* g) { order = ScheduleComputation(*g, order); }, graph);
+    Recursively(
+            [&order, graph, scheduler_type](Graph* g) {
+                const int64_t start_order = order;
+                order = ScheduleComputation(*g, order, scheduler_type);
+                if (g == graph && g_memory_budget_mb > 0) {
+                    order = RecomputeForMemoryBudget(g, static_cast<int64_t>(g_memory_budget_mb) * 1000 * 1000, start_order);
+                }
+            },
+            graph);
 
     dump_onnx(g_dump_after_scheduling, "after scheduling");
 
@@ -116,6 +141,8 @@ void RunDefaultPassesBeforeGradient(Graph* graph) {
     CanonicalizeSubGraphs(graph);
     Recursively([&ccfg](Graph* g) { Simplify(*ccfg, g, true); }, graph);
     Recursively(PropagateConstants, graph);
+    Recursively(SimplifyAlgebraically, graph);
+    Recursively(EliminateCommonSubexpressions, graph);
     Recursively([](Graph* g) { g->DeleteDetached(); }, graph);
     Recursively([&ccfg](Graph* g) { CheckAllOpsSupported(*ccfg, g); }, graph);
 }
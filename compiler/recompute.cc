@@ -1,13 +1,19 @@
 #include "compiler/recompute.h"
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <queue>
+#include <set>
+#include <vector>
 
 #include <compiler/graph.h>
 #include <compiler/graph_builder.h>
 #include <compiler/log.h>
+#include <compiler/memory_simulator.h>
 #include <compiler/node.h>
+#include <compiler/type.h>
+#include <compiler/value.h>
 
 namespace chainer_compiler {
 
@@ -57,6 +63,205 @@ int GetDistance(const Node* node, const std::map<const Node*, int>& distances) {
     return found->second;
 }
 
+// The maximum number of nodes recomputed for a value.
+const size_t kMaxRecomputeSegmentSize = 4;
+
+// Returns true if the first output of `node` is cheap to compute and
+// does not depend on the other outputs. BatchNormalization is not
+// recomputed because it updates the running statistics in training.
+bool IsCheapToRecompute(const Node& node) {
+    switch (node.op_type()) {
+        case Node::kIdentity:
+        case Node::kNeg:
+        case Node::kReciprocal:
+        case Node::kExp:
+        case Node::kLog:
+        case Node::kSqrt:
+        case Node::kTanh:
+        case Node::kAbs:
+        case Node::kRelu:
+        case Node::kSelu:
+        case Node::kLeakyRelu:
+        case Node::kElu:
+        case Node::kSigmoid:
+        case Node::kSoftplus:
+        case Node::kSoftsign:
+        case Node::kAdd:
+        case Node::kSub:
+        case Node::kMul:
+        case Node::kDiv:
+        case Node::kPow:
+        case Node::kClip:
+        case Node::kCast:
+        case Node::kReshape:
+        case Node::kSqueeze:
+        case Node::kUnsqueeze:
+        case Node::kFlatten:
+        case Node::kTranspose:
+        case Node::kMaxPool:
+        case Node::kAveragePool:
+        case Node::kGlobalMaxPool:
+        case Node::kGlobalAveragePool:
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::vector<Node*> GetScheduledNodes(const Graph& graph) {
+    std::vector<Node*> nodes;
+    for (Node* node : graph.nodes()) {
+        if (node->chainer_order() >= 0) nodes.push_back(node);
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const Node* a, const Node* b) { return a->chainer_order() < b->chainer_order(); });
+    return nodes;
+}
+
+void SetOrders(const std::vector<Node*>& nodes, int64_t order) {
+    for (Node* node : nodes) {
+        node->set_chainer_order(++order);
+    }
+}
+
+// A forward value dropped after its last forward user and recomputed
+// by `segment` before `backward_users`.
+struct Recomputation {
+    Value* value{nullptr};
+    std::vector<Node*> segment;
+    std::vector<Node*> backward_users;
+    // The recomputation is inserted before this step.
+    int step{-1};
+    // Bytes of `value` per bytes computed by `segment`.
+    double score{0};
+};
+
+class RecomputationFinder {
+public:
+    explicit RecomputationFinder(const std::vector<Node*>& nodes) {
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            steps_.emplace(nodes[i], i);
+            for (const Value* input : nodes[i]->inputs()) {
+                last_uses_[input] = i;
+            }
+        }
+    }
+
+    // Finds the best value to recompute among values alive at
+    // `peak_step`. Returns false if there is no such value.
+    bool Find(const std::vector<Node*>& nodes, int peak_step, const std::set<const Value*>& tried, Recomputation* best) const {
+        for (int i = 0; i < peak_step; ++i) {
+            Node* node = nodes[i];
+            if (node->IsGradNode() || !IsCheapToRecompute(*node)) continue;
+            Value* value = node->output(0);
+            const int64_t bytes = value->GetNBytes();
+            if (bytes <= 0 || value->IsOutput() || tried.count(value)) continue;
+
+            Recomputation recomputation;
+            recomputation.value = value;
+            bool has_forward_users = false;
+            bool is_valid = true;
+            for (Node* user : std::set<Node*>(value->users().begin(), value->users().end())) {
+                const int step = GetStep(user);
+                if (step < 0) continue;
+                if (step < peak_step) {
+                    has_forward_users = true;
+                } else if (step > peak_step && user->IsGradNode()) {
+                    recomputation.backward_users.push_back(user);
+                    if (recomputation.step < 0 || step < recomputation.step) recomputation.step = step;
+                } else {
+                    is_valid = false;
+                }
+            }
+            if (!is_valid || !has_forward_users || recomputation.backward_users.empty()) continue;
+
+            if (!CollectSegment(node, recomputation.step, &recomputation.segment)) continue;
+            int64_t cost = 0;
+            for (const Node* n : recomputation.segment) {
+                const int64_t s = n->output(0)->GetNBytes();
+                if (s < 0) {
+                    cost = -1;
+                    break;
+                }
+                cost += s;
+            }
+            if (cost <= 0) continue;
+            recomputation.score = static_cast<double>(bytes) / cost;
+
+            if (!best->value || best->score < recomputation.score ||
+                (best->score == recomputation.score && best->value->GetNBytes() < bytes)) {
+                *best = recomputation;
+            }
+        }
+        return best->value != nullptr;
+    }
+
+private:
+    int GetStep(const Node* node) const {
+        auto found = steps_.find(node);
+        if (found == steps_.end()) return -1;
+        return found->second;
+    }
+
+    bool IsAliveAt(const Value* value, int step) const {
+        // Parameters and outputs are never freed.
+        if (value->initializer() || value->IsOutput()) return true;
+        auto found = last_uses_.find(value);
+        return found != last_uses_.end() && found->second >= step;
+    }
+
+    // Collects nodes to recompute the first output of `node` before
+    // `step` in topological order. Inputs which are freed before
+    // `step` are recomputed, too.
+    bool CollectSegment(Node* node, int step, std::vector<Node*>* segment) const {
+        if (node->IsGradNode() || !IsCheapToRecompute(*node)) return false;
+        if (std::find(segment->begin(), segment->end(), node) != segment->end()) return true;
+        for (Value* input : node->inputs()) {
+            if (input->IsNull() || IsAliveAt(input, step)) continue;
+            Node* producer = input->producer();
+            if (!producer || GetStep(producer) < 0 || producer->output(0) != input) return false;
+            if (!CollectSegment(producer, step, segment)) return false;
+        }
+        if (segment->size() >= kMaxRecomputeSegmentSize) return false;
+        segment->push_back(node);
+        return true;
+    }
+
+    std::map<const Node*, int> steps_;
+    std::map<const Value*, int> last_uses_;
+};
+
+// Adds nodes in `recomputation.segment` and lets the backward users
+// use the recomputed value. Returns the added nodes.
+std::vector<Node*> AddRecomputation(Graph* graph, const Recomputation& recomputation) {
+    GraphBuilder gb(graph, "Recompute", recomputation.value);
+    std::map<Value*, Value*> recomputed;
+    std::vector<Node*> added;
+    for (Node* node : recomputation.segment) {
+        std::vector<Value*> inputs;
+        for (Value* input : node->inputs()) {
+            auto found = recomputed.find(input);
+            inputs.push_back(found == recomputed.end() ? input : found->second);
+        }
+        Value* output = gb.Temp(node->output(0)->type());
+        added.push_back(graph->CloneNode(*node, inputs, {output}, gb.GenName()));
+        recomputed.emplace(node->output(0), output);
+    }
+    for (Node* user : recomputation.backward_users) {
+        recomputation.value->ReplaceInputOf(user, recomputed[recomputation.value]);
+    }
+    return added;
+}
+
+void RemoveRecomputation(Graph* graph, const Recomputation& recomputation, const std::vector<Node*>& added) {
+    for (Node* user : recomputation.backward_users) {
+        added.back()->output(0)->ReplaceInputOf(user, recomputation.value);
+    }
+    for (Node* node : added) {
+        node->set_chainer_order(-1);
+        graph->DetachNode(node);
+    }
+}
+
 }  //  namespace
 
 void GetReluRecompute(Graph* graph, int threshold) {
@@ -99,4 +304,39 @@ void GetReluRecompute(Graph* graph, int threshold) {
     }
 }
 
+int64_t RecomputeForMemoryBudget(Graph* graph, int64_t budget, int64_t order) {
+    std::vector<Node*> nodes = GetScheduledNodes(*graph);
+    SimulatedMemoryUsage usage = SimulateMemoryUsage(*graph);
+    const int64_t original_peak = usage.peak;
+    std::set<const Value*> tried;
+    int num_recomputed = 0;
+    while (usage.peak > budget) {
+        Recomputation recomputation;
+        if (!RecomputationFinder(nodes).Find(nodes, usage.peak_step, tried, &recomputation)) break;
+        tried.insert(recomputation.value);
+
+        const std::vector<Node*> added = AddRecomputation(graph, recomputation);
+        nodes.insert(nodes.begin() + recomputation.step, added.begin(), added.end());
+        SetOrders(nodes, order);
+
+        const SimulatedMemoryUsage next_usage = SimulateMemoryUsage(*graph);
+        if (next_usage.peak > usage.peak) {
+            // Temporary values of the segment made a new peak.
+            RemoveRecomputation(graph, recomputation, added);
+            nodes.erase(nodes.begin() + recomputation.step, nodes.begin() + recomputation.step + added.size());
+            SetOrders(nodes, order);
+            continue;
+        }
+
+        CLOG() << "Recompute: " << recomputation.value->GetNBytes() / 1000 << "kB by " << added.size() << " nodes "
+               << recomputation.value->name() << std::endl;
+        usage = next_usage;
+        ++num_recomputed;
+    }
+
+    CLOG() << "Recomputed " << num_recomputed << " values: peak=" << original_peak / 1000 / 1000 << "MB => " << usage.peak / 1000 / 1000
+           << "MB budget=" << budget / 1000 / 1000 << "MB" << std::endl;
+    return order + nodes.size();
+}
+
 }  // namespace chainer_compiler
@@ -1,9 +1,17 @@
 #pragma once
 
+#include <stdint.h>
+
 namespace chainer_compiler {
 
 class Graph;
 
 void GetReluRecompute(Graph* graph, int threshold);
 
+// Recomputes cheap forward values just before their users in backprop
+// until the peak memory simulated by `SimulateMemoryUsage` fits in
+// `budget` bytes or no more values can be recomputed. `graph` must be
+// scheduled after `order`. Returns the last order of nodes in `graph`.
+int64_t RecomputeForMemoryBudget(Graph* graph, int64_t budget, int64_t order);
+
 }  // namespace chainer_compiler
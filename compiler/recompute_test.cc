@@ -0,0 +1,65 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <common/strutil.h>
+#include <compiler/graph.h>
+#include <compiler/memory_simulator.h>
+#include <compiler/node.h>
+#include <compiler/recompute.h>
+#include <compiler/type.h>
+
+namespace chainer_compiler {
+namespace {
+
+TEST(RecomputeTest, MemoryBudget) {
+    Graph graph("test");
+    const Type type(Dtype::kFloat32, {250});
+    Value* x = graph.AddInputValue("x", type);
+    Value* w = graph.AddInputValue("w", Type(Dtype::kFloat32, {1}));
+
+    // Relu outputs are used by the next MatMul and its gradient while
+    // Relu inputs are kept alive by the gradients of Relu.
+    std::vector<Value*> inputs = {x};
+    std::vector<Value*> relu_inputs;
+    for (int i = 0; i < 4; ++i) {
+        Value* h = graph.AddValue(StrCat("h", i), type);
+        Value* r = graph.AddValue(StrCat("r", i), type);
+        graph.AddNode(Node::kMatMul, {inputs.back(), w}, {h});
+        graph.AddNode(Node::kRelu, {h}, {r});
+        relu_inputs.push_back(h);
+        inputs.push_back(r);
+    }
+    Value* gy = graph.AddValue("gy", type);
+    graph.AddNode(Node::kIdentity, {inputs.back()}, {gy});
+    for (int i = 3; i >= 0; --i) {
+        Value* gx = i ? graph.AddValue(StrCat("g", i), type) : graph.AddOutputValue("gx", type);
+        graph.AddNode(Node::kSum, {gy, relu_inputs[i], inputs[i]}, {gx}, "Grad");
+        gy = gx;
+    }
+
+    int64_t order = 0;
+    for (Node* node : graph.nodes()) {
+        node->set_chainer_order(++order);
+    }
+    const int64_t peak = SimulateMemoryUsage(graph).peak;
+
+    // The input of the first MatMul is not an output of Relu.
+    EXPECT_EQ(16, RecomputeForMemoryBudget(&graph, 0, 0));
+    EXPECT_GT(peak, SimulateMemoryUsage(graph).peak);
+
+    const std::vector<const Node*> nodes = graph.GetComputationSequence();
+    ASSERT_EQ(16UL, nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const Node* node = nodes[i];
+        if (!node->IsGradNode() || node->input(2) == x) continue;
+        // Gradients use Relu recomputed just before them.
+        const Node* relu = node->input(2)->producer();
+        EXPECT_EQ(Node::kRelu, relu->op_type());
+        EXPECT_EQ(nodes[i - 1], relu);
+    }
+}
+
+}  // namespace
+}  // namespace chainer_compiler
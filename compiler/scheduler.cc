@@ -5,6 +5,10 @@
 #include <iterator>
 #include <map>
 #include <queue>
+#include <random>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <common/strutil.h>
@@ -201,6 +205,291 @@ std::vector<Node*> ScheduleGreedy(const Graph& graph, const std::vector<Value*>&
     return nodes;
 }
 
+// The number of partial orders kept in each step of the beam search.
+const size_t kBeamWidth = 16;
+
+// The beam search degenerates to a greedy search after this number of
+// expanded candidates so huge graphs are still scheduled in a
+// reasonable time. Unlike a time limit, this keeps schedules
+// reproducible.
+const int64_t kBeamSearchMaxExpansions = 1 << 22;
+
+// A partial order in the beam search. Only differences from the
+// initial counts are kept so copying a state costs as much as the
+// frontier of the partial order, not the whole graph.
+struct ScheduleState {
+    // Pending input counts of nodes which have some but not all of
+    // their inputs ready, keyed by node IDs.
+    std::unordered_map<int, int> input_counts;
+    // Remaining users of values which are partially consumed, keyed by
+    // value IDs.
+    std::unordered_map<int, int> num_users;
+    // Node IDs whose inputs are all ready.
+    std::vector<int> ready;
+    // The index of the last scheduled node in the trail shared by all
+    // states, or -1.
+    int last{-1};
+    int64_t mem{0};
+    int64_t peak{0};
+    // XOR of keys of scheduled nodes. Partial orders which have
+    // scheduled the same set of nodes have the same live values.
+    uint64_t hash{0};
+};
+
+// Searches an order with the lowest peak memory by beam search. Unlike
+// `ScheduleGreedy`, memory usage is tracked exactly in the same way as
+// `SimulateMemoryUsage` instead of being estimated.
+std::vector<Node*> ScheduleBeamSearch(
+        const Graph& graph, const std::vector<Value*>& input_values, const std::vector<Value*>& output_values) {
+    const std::map<Node*, int> necessary_nodes = graph.GetNecessaryNodesAndInputCounts(output_values);
+
+    std::vector<Node*> nodes;
+    std::map<const Node*, int> node_ids;
+    for (const auto& p : necessary_nodes) {
+        node_ids.emplace(p.first, nodes.size());
+        nodes.push_back(p.first);
+    }
+
+    std::vector<int64_t> value_bytes;
+    std::vector<int> initial_num_users;
+    std::map<const Value*, int> value_ids;
+    auto get_value_id = [&value_bytes, &initial_num_users, &value_ids](const Value* value) {
+        auto p = value_ids.emplace(value, value_ids.size());
+        if (p.second) {
+            value_bytes.push_back(std::max<int64_t>(0, value->GetNBytes()));
+            // We assume parameters will never be freed.
+            initial_num_users.push_back(value->users().size() + (value->initializer() ? 1 : 0));
+        }
+        return p.first->second;
+    };
+
+    // Node IDs which lose one of pending inputs when `value` is ready.
+    auto get_users = [&node_ids](const Value* value) {
+        std::vector<int> users;
+        if (value->IsNull()) return users;
+        for (Node* user : value->users()) {
+            auto found = node_ids.find(user);
+            if (found != node_ids.end()) users.push_back(found->second);
+        }
+        return users;
+    };
+
+    std::vector<std::vector<std::pair<int, int>>> node_inputs(nodes.size());
+    std::vector<int64_t> node_output_bytes(nodes.size());
+    std::vector<std::vector<int>> node_users(nodes.size());
+    std::vector<uint64_t> node_keys(nodes.size());
+    std::mt19937_64 rng(0);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        Node* node = nodes[i];
+        // Pairs of value IDs and the number of their occurrences.
+        std::map<int, int> inputs;
+        for (const Value* input : node->inputs()) {
+            ++inputs[get_value_id(input)];
+        }
+        node_inputs[i].assign(inputs.begin(), inputs.end());
+        for (const Value* output : node->outputs()) {
+            // Already scheduled nodes have run before this schedule.
+            if (node->chainer_order() < 0) node_output_bytes[i] += std::max<int64_t>(0, output->GetNBytes());
+            const std::vector<int> users = get_users(output);
+            node_users[i].insert(node_users[i].end(), users.begin(), users.end());
+        }
+        node_keys[i] = rng();
+    }
+
+    // Values used outside the scheduled nodes are never freed, so they
+    // do not need to be tracked by each state.
+    std::vector<int> num_consumers(initial_num_users.size());
+    for (const auto& inputs : node_inputs) {
+        for (const auto& p : inputs) num_consumers[p.first] += p.second;
+    }
+    std::vector<bool> freeable(initial_num_users.size());
+    for (size_t i = 0; i < freeable.size(); ++i) {
+        freeable[i] = num_consumers[i] == initial_num_users[i];
+    }
+
+    std::vector<int> initial_input_counts;
+    for (Node* node : nodes) {
+        initial_input_counts.push_back(necessary_nodes.find(node)->second);
+    }
+
+    // The number of users of `value_id` which have not run yet.
+    auto get_num_users = [&initial_num_users](const ScheduleState& state, int value_id) {
+        auto found = state.num_users.find(value_id);
+        return found == state.num_users.end() ? initial_num_users[value_id] : found->second;
+    };
+
+    // Consumes inputs of the node `id` and frees values without
+    // remaining users.
+    auto consume_inputs = [&node_inputs, &initial_num_users, &value_bytes, &freeable](int id, ScheduleState* state) {
+        for (const auto& p : node_inputs[id]) {
+            if (!freeable[p.first]) continue;
+            auto found = state->num_users.emplace(p.first, initial_num_users[p.first]).first;
+            if ((found->second -= p.second) == 0) {
+                state->mem -= value_bytes[p.first];
+                state->num_users.erase(found);
+            }
+        }
+    };
+
+    // Decrements input counts of `users` and runs nodes which have
+    // become ready if they are already scheduled.
+    auto make_ready = [&nodes, &node_users, &node_keys, &initial_input_counts, consume_inputs](
+                              const std::vector<int>& users, ScheduleState* state) {
+        std::vector<int> q(users);
+        std::vector<int> scheduled;
+        while (!q.empty() || !scheduled.empty()) {
+            if (q.empty()) {
+                const int id = scheduled.back();
+                scheduled.pop_back();
+                state->hash ^= node_keys[id];
+                consume_inputs(id, state);
+                q = node_users[id];
+                continue;
+            }
+            const int id = q.back();
+            q.pop_back();
+            auto found = state->input_counts.emplace(id, initial_input_counts[id]).first;
+            const int cnt = --found->second;
+            CHECK_LE(0, cnt) << nodes[id]->ToString();
+            if (cnt != 0) continue;
+            state->input_counts.erase(found);
+            if (nodes[id]->chainer_order() >= 0) {
+                scheduled.push_back(id);
+            } else {
+                state->ready.push_back(id);
+            }
+        }
+    };
+
+    // Scheduled nodes and indices of their predecessors in partial
+    // orders, shared by all states.
+    std::vector<std::pair<int, int>> trail;
+
+    auto run_node = [&node_output_bytes, &node_users, &node_keys, &trail, consume_inputs, make_ready](
+                            size_t ready_index, ScheduleState* state) {
+        const int id = state->ready[ready_index];
+        state->ready.erase(state->ready.begin() + ready_index);
+        trail.emplace_back(id, state->last);
+        state->last = trail.size() - 1;
+        state->mem += node_output_bytes[id];
+        state->peak = std::max(state->peak, state->mem);
+        state->hash ^= node_keys[id];
+        consume_inputs(id, state);
+        make_ready(node_users[id], state);
+    };
+
+    std::vector<ScheduleState> beam(1);
+    {
+        ScheduleState& state = beam[0];
+        std::vector<int> users;
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            // Schedule nodes which are already schedulable (e.g., Constant).
+            if (initial_input_counts[i] == 0) {
+                ++initial_input_counts[i];
+                users.push_back(i);
+            }
+        }
+        for (const Value* value : input_values) {
+            const std::vector<int> input_users = get_users(value);
+            users.insert(users.end(), input_users.begin(), input_users.end());
+        }
+        make_ready(users, &state);
+    }
+
+    int64_t num_expansions = 0;
+    size_t beam_width = kBeamWidth;
+    for (int step = 0; !beam[0].ready.empty(); ++step) {
+        if (beam_width > 1 && num_expansions > kBeamSearchMaxExpansions) {
+            CLOG() << "Beam search gave up after " << step << " steps" << std::endl;
+            beam_width = 1;
+        }
+
+        struct Candidate {
+            int64_t peak;
+            int64_t mem;
+            size_t parent;
+            size_t ready_index;
+        };
+        std::vector<Candidate> candidates;
+        // A map from sets of scheduled nodes to indices of candidates.
+        std::unordered_map<uint64_t, size_t> seen;
+        for (size_t parent = 0; parent < beam.size(); ++parent) {
+            const ScheduleState& state = beam[parent];
+            num_expansions += state.ready.size();
+            for (size_t i = 0; i < state.ready.size(); ++i) {
+                const int id = state.ready[i];
+                int64_t mem = state.mem + node_output_bytes[id];
+                const int64_t peak = std::max(state.peak, mem);
+                for (const auto& p : node_inputs[id]) {
+                    if (freeable[p.first] && get_num_users(state, p.first) == p.second) mem -= value_bytes[p.first];
+                }
+                const Candidate candidate{peak, mem, parent, i};
+                auto found = seen.emplace(state.hash ^ node_keys[id], candidates.size());
+                if (found.second) {
+                    candidates.push_back(candidate);
+                } else if (peak < candidates[found.first->second].peak) {
+                    candidates[found.first->second] = candidate;
+                }
+            }
+        }
+        CHECK(!candidates.empty());
+
+        std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+            return std::tie(a.peak, a.mem) < std::tie(b.peak, b.mem);
+        });
+        if (candidates.size() > beam_width) candidates.resize(beam_width);
+
+        // The last child of each partial order takes over its state.
+        std::vector<int> num_children(beam.size());
+        for (const Candidate& candidate : candidates) ++num_children[candidate.parent];
+        std::vector<ScheduleState> next_beam;
+        next_beam.reserve(candidates.size());
+        for (const Candidate& candidate : candidates) {
+            ScheduleState& parent = beam[candidate.parent];
+            if (--num_children[candidate.parent] == 0) {
+                next_beam.push_back(std::move(parent));
+            } else {
+                next_beam.push_back(parent);
+            }
+            run_node(candidate.ready_index, &next_beam.back());
+        }
+        beam.swap(next_beam);
+    }
+
+    std::vector<Node*> order;
+    for (int i = beam[0].last; i >= 0; i = trail[i].second) {
+        order.push_back(nodes[trail[i].first]);
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+// Returns the peak memory simulated by `SimulateMemoryUsage` when
+// `nodes` are scheduled after `order`.
+int64_t SimulatePeakMemory(const Graph& graph, const std::vector<Node*>& nodes, int64_t order) {
+    for (Node* node : nodes) {
+        node->set_chainer_order(++order);
+    }
+    const int64_t peak = SimulateMemoryUsage(graph).peak;
+    for (Node* node : nodes) {
+        node->set_chainer_order(-1);
+    }
+    return peak;
+}
+
+// Runs both the beam search and the greedy scheduler and returns the
+// order with the lower peak memory so this is never worse than
+// `ScheduleGreedy`.
+std::vector<Node*> ScheduleMemoryOptimal(
+        const Graph& graph, const std::vector<Value*>& input_values, const std::vector<Value*>& output_values, int64_t order) {
+    const std::vector<Node*> greedy = ScheduleGreedy(graph, input_values, output_values);
+    const std::vector<Node*> searched = ScheduleBeamSearch(graph, input_values, output_values);
+    const int64_t greedy_peak = SimulatePeakMemory(graph, greedy, order);
+    const int64_t searched_peak = SimulatePeakMemory(graph, searched, order);
+    CLOG() << "Simulated peak memory: greedy=" << greedy_peak << " beam_search=" << searched_peak << std::endl;
+    return searched_peak < greedy_peak ? searched : greedy;
+}
+
 void CheckSanity(
         const Graph& graph,
         const std::vector<Value*>& input_values,
@@ -252,6 +541,9 @@ int64_t ScheduleComputation(
         case SchedulerType::kGreedy:
             nodes = ScheduleGreedy(graph, input_values, output_values);
             break;
+        case SchedulerType::kMemoryOptimal:
+            nodes = ScheduleMemoryOptimal(graph, input_values, output_values, order);
+            break;
     }
 
     CheckSanity(graph, input_values, output_values, nodes);
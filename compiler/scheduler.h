@@ -9,6 +9,8 @@ class Value;
 enum class SchedulerType {
     kNaive,
     kGreedy,
+    // Searches orders with lower peak memory than `kGreedy`. Slower.
+    kMemoryOptimal,
 };
 
 int64_t ScheduleComputation(
@@ -4,8 +4,10 @@
 
 #include <common/log.h>
 #include <compiler/graph.h>
+#include <compiler/memory_simulator.h>
 #include <compiler/node.h>
 #include <compiler/scheduler.h>
+#include <compiler/type.h>
 
 namespace chainer_compiler {
 namespace {
@@ -94,7 +96,34 @@ TEST_P(SchedulerTest, MultipleTimes) {
     EXPECT_EQ(2, n3->chainer_order());
 }
 
-INSTANTIATE_TEST_CASE_P(ForEachScheduler, SchedulerTest, ::testing::Values(SchedulerType::kNaive, SchedulerType::kGreedy));
+INSTANTIATE_TEST_CASE_P(
+        ForEachScheduler,
+        SchedulerTest,
+        ::testing::Values(SchedulerType::kNaive, SchedulerType::kGreedy, SchedulerType::kMemoryOptimal));
+
+// The greedy scheduler delays Relu, which keeps both `a` and `r`
+// alive while `big` is alive.
+int64_t GetPeakMemoryOfReluGraph(SchedulerType scheduler_type) {
+    Graph graph("test");
+    Value* a = graph.AddInputValue("a", Type(Dtype::kFloat32, {1000}));
+    Value* b = graph.AddInputValue("b", Type(Dtype::kFloat32, {1}));
+    Value* c = graph.AddInputValue("c", Type(Dtype::kFloat32, {1}));
+    Value* big = graph.AddValue("big", Type(Dtype::kFloat32, {1000}));
+    Value* r = graph.AddValue("r", Type(Dtype::kFloat32, {1000}));
+    Value* out = graph.AddOutputValue("out", Type(Dtype::kFloat32, {1}));
+    graph.AddNode(Node::kAdd, {b, c}, {big});
+    graph.AddNode(Node::kRelu, {a}, {r});
+    graph.AddNode(Node::kAdd, {big, r}, {out});
+
+    ScheduleComputation(graph, 0, scheduler_type);
+    EXPECT_EQ(3UL, graph.GetComputationSequence().size());
+    return SimulateMemoryUsage(graph).peak;
+}
+
+TEST(MemoryOptimalSchedulerTest, LowerPeak) {
+    EXPECT_EQ(12000, GetPeakMemoryOfReluGraph(SchedulerType::kGreedy));
+    EXPECT_EQ(8008, GetPeakMemoryOfReluGraph(SchedulerType::kMemoryOptimal));
+}
 
 }  // namespace
 }  // namespace chainer_compiler
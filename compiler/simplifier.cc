@@ -559,17 +559,6 @@ bool ReplaceShape(Graph* graph, Node* node) {
     return true;
 }
 
-bool RemoveIdentity(Graph* graph, Node* node) {
-    Value* input = node->input(0);
-    Value* output = node->output(0);
-    if (!input->IsTemp() || !output->IsTemp()) return false;
-    for (Node* user : output->users()) {
-        input->AddUser(user);
-        user->ReplaceInput(output, input);
-    }
-    return true;
-}
-
 bool ReplaceSelectItem(Graph* graph, Node* node) {
     GraphBuilder gb(graph, "SimplifySelectItem", node->output(0));
     Value* x = node->input(0);
@@ -646,7 +635,6 @@ void Simplify(const CompilerConfig& ccfg, Graph* graph, bool gen_backprop) {
     CHECK(simplifiers.emplace(Node::kConstantLike, ReplaceConstantLike).second);
     CHECK(simplifiers.emplace(Node::kShape, ReplaceShape).second);
     CHECK(simplifiers.emplace(Node::kImageScaler, ReplaceImageScaler).second);
-    CHECK(simplifiers.emplace(Node::kIdentity, RemoveIdentity).second);
 
     auto replace_if_not_supported = [&ccfg, &simplifiers](Node::OpType op, SimplifierFn fn) {
         if (!ccfg.HasOp(op)) {
@@ -4,8 +4,10 @@
 #include <cstdlib>
 #include <cstring>
 #include <sstream>
+#include <string>
 
 #include <common/log.h>
+#include <common/mmap_util.h>
 #include <compiler/serializer_util.h>
 
 namespace chainer_compiler {
@@ -93,7 +95,9 @@ Tensor::Tensor(const onnx::TensorProto& xtensor)
       doc_string_(xtensor.doc_string()) {
     CHECK(!xtensor.has_segment()) << "Segmented TensorProto not supported";
 
-    if (xtensor.has_raw_data()) {
+    if (xtensor.data_location() == onnx::TensorProto::EXTERNAL) {
+        LoadExternalData(xtensor);
+    } else if (xtensor.has_raw_data()) {
         CHECK_EQ(0, xtensor.float_data_size());
         CHECK_EQ(0, xtensor.int32_data_size());
         CHECK_EQ(0, xtensor.string_data_size());
@@ -103,28 +107,28 @@ Tensor::Tensor(const onnx::TensorProto& xtensor)
 
         switch (dtype_) {
             case Dtype::kBool:
-                data_.reset(LoadDataFromRawData<bool>(xtensor.raw_data(), NumElements()).release());
+                data_ = LoadDataFromRawData<bool>(xtensor.raw_data(), NumElements());
                 break;
             case Dtype::kInt8:
-                data_.reset(LoadDataFromRawData<int8_t>(xtensor.raw_data(), NumElements()).release());
+                data_ = LoadDataFromRawData<int8_t>(xtensor.raw_data(), NumElements());
                 break;
             case Dtype::kInt16:
-                data_.reset(LoadDataFromRawData<int16_t>(xtensor.raw_data(), NumElements()).release());
+                data_ = LoadDataFromRawData<int16_t>(xtensor.raw_data(), NumElements());
                 break;
             case Dtype::kInt32:
-                data_.reset(LoadDataFromRawData<int32_t>(xtensor.raw_data(), NumElements()).release());
+                data_ = LoadDataFromRawData<int32_t>(xtensor.raw_data(), NumElements());
                 break;
             case Dtype::kInt64:
-                data_.reset(LoadDataFromRawData<int64_t>(xtensor.raw_data(), NumElements()).release());
+                data_ = LoadDataFromRawData<int64_t>(xtensor.raw_data(), NumElements());
                 break;
             case Dtype::kUInt8:
-                data_.reset(LoadDataFromRawData<uint8_t>(xtensor.raw_data(), NumElements()).release());
+                data_ = LoadDataFromRawData<uint8_t>(xtensor.raw_data(), NumElements());
                 break;
             case Dtype::kFloat32:
-                data_.reset(LoadDataFromRawData<float>(xtensor.raw_data(), NumElements()).release());
+                data_ = LoadDataFromRawData<float>(xtensor.raw_data(), NumElements());
                 break;
             case Dtype::kFloat64:
-                data_.reset(LoadDataFromRawData<double>(xtensor.raw_data(), NumElements()).release());
+                data_ = LoadDataFromRawData<double>(xtensor.raw_data(), NumElements());
                 break;
             default:
                 CHECK(false) << "Unknown data type: " << dtype_.ToString();
@@ -132,28 +136,28 @@ Tensor::Tensor(const onnx::TensorProto& xtensor)
     } else {
         switch (dtype_) {
             case Dtype::kBool:
-                data_.reset(LoadDataFromRepeated<int32_t, bool>(xtensor.int32_data()).release());
+                data_ = LoadDataFromRepeated<int32_t, bool>(xtensor.int32_data());
                 break;
             case Dtype::kInt8:
-                data_.reset(LoadDataFromRepeated<int32_t, int8_t>(xtensor.int32_data()).release());
+                data_ = LoadDataFromRepeated<int32_t, int8_t>(xtensor.int32_data());
                 break;
             case Dtype::kInt16:
-                data_.reset(LoadDataFromRepeated<int32_t, int16_t>(xtensor.int32_data()).release());
+                data_ = LoadDataFromRepeated<int32_t, int16_t>(xtensor.int32_data());
                 break;
             case Dtype::kInt32:
-                data_.reset(LoadDataFromRepeated<int32_t, int32_t>(xtensor.int32_data()).release());
+                data_ = LoadDataFromRepeated<int32_t, int32_t>(xtensor.int32_data());
                 break;
             case Dtype::kInt64:
-                data_.reset(LoadDataFromRepeated<int64_t, int64_t>(xtensor.int64_data()).release());
+                data_ = LoadDataFromRepeated<int64_t, int64_t>(xtensor.int64_data());
                 break;
             case Dtype::kUInt8:
-                data_.reset(LoadDataFromRepeated<int32_t, uint8_t>(xtensor.int32_data()).release());
+                data_ = LoadDataFromRepeated<int32_t, uint8_t>(xtensor.int32_data());
                 break;
             case Dtype::kFloat32:
-                data_.reset(LoadDataFromRepeated<float, float>(xtensor.float_data()).release());
+                data_ = LoadDataFromRepeated<float, float>(xtensor.float_data());
                 break;
             case Dtype::kFloat64:
-                data_.reset(LoadDataFromRepeated<double, double>(xtensor.double_data()).release());
+                data_ = LoadDataFromRepeated<double, double>(xtensor.double_data());
                 break;
             default:
                 CHECK(false) << "Unknown data type: " << dtype_.ToString();
@@ -234,12 +238,39 @@ template Tensor::Tensor(const std::string& name, Dtype dtype, const std::vector<
 template Tensor::Tensor(const std::string& name, Dtype dtype, const std::vector<int64_t>& dims, const std::vector<long>& data);
 
 Tensor::Tensor(const std::string& name, const Tensor& t)
-    : dims_(t.dims_),
-      dtype_(t.dtype_),
-      data_(Tensor::UniqueData(std::malloc(t.ElementSize() * t.NumElements()), &std::free)),
-      name_(name),
-      doc_string_(t.doc_string_) {
-    std::memcpy(data_.get(), t.data_.get(), t.ElementSize() * t.NumElements());
+    : dims_(t.dims_), dtype_(t.dtype_), data_(t.data_), is_mapped_(t.is_mapped_), name_(name), doc_string_(t.doc_string_) {
+}
+
+void Tensor::LoadExternalData(const onnx::TensorProto& xtensor) {
+    std::string location;
+    int64_t offset = 0;
+    int64_t length = -1;
+    for (const onnx::StringStringEntryProto& entry : xtensor.external_data()) {
+        if (entry.key() == "location") {
+            location = entry.value();
+        } else if (entry.key() == "offset") {
+            offset = std::stoll(entry.value());
+        } else if (entry.key() == "length") {
+            length = std::stoll(entry.value());
+        }
+    }
+    CHECK(!location.empty()) << "No location for external data of " << name_;
+    CHECK_LE(0, offset) << "Invalid offset of external data of " << name_;
+    const int64_t nbytes = ElementSize() * NumElements();
+    if (length >= 0) CHECK_EQ(nbytes, length) << "Invalid length of external data of " << name_;
+
+    // Pages are not read until the data is accessed.
+    MappedFile mapped = MapFile(location);
+    CHECK_LE(offset, mapped.size) << "External data of " << name_ << " exceeds " << location;
+    CHECK_LE(nbytes, mapped.size - offset) << "External data of " << name_ << " exceeds " << location;
+    char* data = static_cast<char*>(mapped.data.get()) + offset;
+    if (reinterpret_cast<uintptr_t>(data) % ElementSize() == 0) {
+        data_ = std::shared_ptr<void>(mapped.data, data);
+        is_mapped_ = true;
+    } else {
+        data_.reset(std::malloc(nbytes), &std::free);
+        std::memcpy(data_.get(), data, nbytes);
+    }
 }
 
 }  // namespace chainer_compiler
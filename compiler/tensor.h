@@ -33,6 +33,7 @@ public:
     Tensor(const Tensor&) = delete;
     Tensor& operator=(const Tensor&) = delete;
 
+    // Shares the data of `t`.
     Tensor(const std::string& name, const Tensor& t);
 
     void ToONNX(onnx::TensorProto* xtensor) const;
@@ -64,10 +65,26 @@ public:
         return data_.get();
     }
 
+    // Arrays can share the data with this tensor to avoid copies. The
+    // data must not be written. See also `is_mapped`.
+    const std::shared_ptr<void>& GetSharedData() const {
+        return data_;
+    }
+
+    // True if the data is a part of a file mapped to read-only memory,
+    // which is shared by all tensors mapping the same file.
+    bool is_mapped() const {
+        return is_mapped_;
+    }
+
 private:
+    void LoadExternalData(const onnx::TensorProto& xtensor);
+
     std::vector<int64_t> dims_;
     Dtype dtype_;
-    UniqueData data_;
+    // Either allocated by malloc or a part of a file mapped to memory.
+    std::shared_ptr<void> data_;
+    bool is_mapped_{false};
     std::string name_;
     std::string doc_string_;
 };
@@ -1,3 +1,8 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
 #include <string>
 
 #include <gtest/gtest.h>
@@ -43,5 +48,36 @@ TEST(TensorTest, Constructor) {
     }
 }
 
+TEST(TensorTest, ExternalData) {
+    char path[] = "/tmp/tensor_test_XXXXXX";
+    const int fd = mkstemp(path);
+    CHECK_LE(0, fd);
+    close(fd);
+    const float data[] = {0.0f, 2.0f, 3.0f};
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(data), sizeof(data));
+
+    onnx::TensorProto xtensor;
+    xtensor.set_name("foo");
+    xtensor.set_data_type(onnx::TensorProto::FLOAT);
+    xtensor.add_dims(2);
+    xtensor.set_data_location(onnx::TensorProto::EXTERNAL);
+    onnx::StringStringEntryProto* location = xtensor.add_external_data();
+    location->set_key("location");
+    location->set_value(path);
+    onnx::StringStringEntryProto* offset = xtensor.add_external_data();
+    offset->set_key("offset");
+    offset->set_value("4");
+
+    Tensor tensor(xtensor);
+    std::remove(path);
+    EXPECT_TRUE(tensor.is_mapped());
+    ASSERT_EQ(1, tensor.dims().size());
+    EXPECT_EQ(2, tensor.dims()[0]);
+    EXPECT_EQ(2.0, tensor.Get<float>(0));
+    EXPECT_EQ(3.0, tensor.Get<float>(1));
+    Tensor copied("bar", tensor);
+    EXPECT_EQ(tensor.GetRawData(), copied.GetRawData());
+}
+
 }  // namespace
 }  // namespace chainer_compiler
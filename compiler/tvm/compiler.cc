@@ -6,8 +6,14 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
 
+#include <cstdio>
 #include <fstream>
+#include <map>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -22,6 +28,10 @@
 #include <tvm/build_module.h>
 #include <tvm/codegen.h>
 
+#include <compiler/onnx.h>
+
+#include <common/file_util.h>
+#include <common/hash.h>
 #include <common/strutil.h>
 #include <compiler/flags.h>
 #include <compiler/log.h>
@@ -36,11 +46,85 @@ namespace chainer_compiler {
 
 namespace {
 
+// Bump this when the way to build kernels changes.
+const int kTVMKernelCacheVersion = 1;
+
+// Schedules defined in Python are used when available.
+#if CHAINER_COMPILER_ENABLE_PYTHON
+const bool kUsePythonSchedules = true;
+#else
+const bool kUsePythonSchedules = false;
+#endif
+
+#ifdef TVM_VERSION
+const char kTVMVersion[] = TVM_VERSION;
+#else
+const char kTVMVersion[] = "unknown";
+#endif
+
 bool Exists(const std::string& filename) {
     std::ifstream ifs(filename);
     return static_cast<bool>(ifs);
 }
 
+std::string ReadFile(const std::string& filename) {
+    std::ifstream ifs(filename, std::ios::binary);
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    return oss.str();
+}
+
+// Returns a string which identifies the kernel built from `nodes` for
+// `target`. Names of values and fusion groups do not matter, so the
+// same computation in different models shares the key.
+std::string GetKernelKey(
+        const std::vector<Node*>& nodes, const std::vector<Value*>& inputs, const std::vector<Value*>& outputs, const std::string& target) {
+    std::map<const Value*, int> ids;
+    auto value_key = [&ids](const Value* value) {
+        auto inserted = ids.emplace(value, ids.size());
+        const Type& type = value->type();
+        const std::string dims = JoinString(MapToString(type.dims(), [](int64_t d) { return StrCat(d); }), ",");
+        return StrCat('v', inserted.first->second, ':', type.dtype().ToString(), '[', dims, ']');
+    };
+
+    std::string key = StrCat(
+            "version=",
+            kTVMKernelCacheVersion,
+            " tvm=",
+            kTVMVersion,
+            " target=",
+            target,
+            " python=",
+            kUsePythonSchedules,
+            '\n');
+    for (const Value* value : inputs) {
+        key += StrCat("input ", value_key(value), '\n');
+    }
+    for (const Node* node : nodes) {
+        key += Node::OpTypeToString(node->op_type());
+        for (const Value* value : node->inputs()) key += ' ' + value_key(value);
+        key += " ->";
+        for (const Value* value : node->outputs()) key += ' ' + value_key(value);
+        onnx::NodeProto xnode;
+        node->FillONNXAttributes(&xnode);
+        for (const onnx::AttributeProto& xattr : xnode.attribute()) {
+            if (xattr.name() == "chainer_order" || xattr.name() == "chainer_fusion_group") continue;
+            std::string data;
+            CHECK(xattr.SerializeToString(&data));
+            key += StrCat(' ', data.size(), ':', data);
+        }
+        key += '\n';
+    }
+    for (const Value* value : outputs) {
+        key += StrCat("output ", value_key(value), '\n');
+    }
+    // The best schedules of AutoTVM may change the kernel.
+    if (!g_autotvm_log.empty()) {
+        key += "autotvm_log=" + ReadFile(g_autotvm_log);
+    }
+    return key;
+}
+
 tvm::Type GetType(Dtype dtype) {
     switch (dtype) {
         case Dtype::kUnknown:
@@ -101,12 +185,27 @@ public:
             const std::vector<Value*>& outputs,
             std::string* filename,
             std::string* func_name) {
-        *func_name = StrCat("tvm_op_", id);
-        const std::string& dso_name = StrCat("/tmp/libchainer_compiler_op_", *func_name);
-        *filename = dso_name + ".so";
-        if (g_reuse_tvm_code && Exists(*filename)) {
-            CLOG() << "Reuse existing " << *filename << std::endl;
-            return;
+        std::string dso_name;
+        if (g_tvm_cache_dir.empty()) {
+            *func_name = StrCat("tvm_op_", id);
+            dso_name = StrCat("/tmp/libchainer_compiler_op_", *func_name);
+            *filename = dso_name + ".so";
+        } else {
+            const std::string hash = Fingerprint(GetKernelKey(nodes, inputs, outputs, target_->str()));
+            *func_name = StrCat("tvm_op_", hash);
+            *filename = StrCat(g_tvm_cache_dir, '/', hash, ".so");
+            // Cached kernels are dlopen()ed.
+            MakePrivateDirs(g_tvm_cache_dir);
+            CheckPrivateFile(g_tvm_cache_dir);
+            // Tasks are dumped only when kernels are built.
+            if (g_dump_autotvm_task_dir.empty() && Exists(*filename)) {
+                CheckPrivateFile(*filename);
+                CLOG() << "Reuse cached " << *filename << " for fusion group " << id << std::endl;
+                return;
+            }
+            // Built with a temporary name and renamed later so other
+            // processes never see a partial file.
+            dso_name = GetTemporaryFilename(StrCat(g_tvm_cache_dir, '/', hash));
         }
 
         PrepareInputs(inputs);
@@ -223,6 +322,12 @@ public:
         if (system(cmd.c_str()) != 0) {
             CHECK(false) << strerror(errno) << ": cmd=" << cmd;
         }
+
+        if (!g_tvm_cache_dir.empty()) {
+            const std::string tmp_filename = dso_name + ".so";
+            CHECK_EQ(0, rename(tmp_filename.c_str(), filename->c_str())) << "Failed to rename " << tmp_filename << ": " << strerror(errno);
+            for (const std::string& input_file : input_files) unlink(input_file.c_str());
+        }
     }
 
 private:
@@ -1,5 +1,6 @@
 #include "compiler/util.h"
 
+#include <common/protoutil.h>
 #include <common/strutil.h>
 
 #include <compiler/tensor.h>
@@ -42,4 +43,31 @@ void StripONNXModel(onnx::ModelProto* model) {
     StripONNXGraph(model->mutable_graph());
 }
 
+namespace {
+
+void ResolveExternalData(const std::string& dir, onnx::GraphProto* graph) {
+    for (onnx::TensorProto& tensor : *graph->mutable_initializer()) {
+        if (tensor.data_location() != onnx::TensorProto::EXTERNAL) continue;
+        for (onnx::StringStringEntryProto& entry : *tensor.mutable_external_data()) {
+            if (entry.key() == "location" && !HasPrefix(entry.value(), "/")) {
+                entry.set_value(StrCat(dir, '/', entry.value()));
+            }
+        }
+    }
+    for (onnx::NodeProto& node : *graph->mutable_node()) {
+        for (onnx::AttributeProto& attr : *node.mutable_attribute()) {
+            if (attr.has_g()) ResolveExternalData(dir, attr.mutable_g());
+            for (onnx::GraphProto& g : *attr.mutable_graphs()) ResolveExternalData(dir, &g);
+        }
+    }
+}
+
+}  // namespace
+
+onnx::ModelProto LoadONNXModel(const std::string& filename) {
+    onnx::ModelProto xmodel(LoadLargeProto<onnx::ModelProto>(filename));
+    ResolveExternalData(Dirname(filename), xmodel.mutable_graph());
+    return xmodel;
+}
+
 }  // namespace chainer_compiler
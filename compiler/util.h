@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 #include <compiler/onnx.h>
 
 namespace chainer_compiler {
@@ -12,4 +14,8 @@ void StripONNXGraph(onnx::GraphProto* graph);
 
 void StripONNXModel(onnx::ModelProto* model);
 
+// Loads an ONNX model. Locations of external data of initializers are
+// made absolute since they are relative to the directory of the model.
+onnx::ModelProto LoadONNXModel(const std::string& filename);
+
 }  // namespace chainer_compiler
@@ -4,6 +4,7 @@
 
 #include <common/log.h>
 #include <common/strutil.h>
+#include <compiler/node.h>
 #include <compiler/serializer_util.h>
 #include <compiler/tensor.h>
 #include <compiler/type.h>
@@ -59,6 +60,23 @@ void Value::DetachUser(const Node* user) {
     users_.erase(found);
 }
 
+void Value::ReplaceInputOf(Node* user, Value* to) {
+    for (size_t i = 0; i < user->inputs().size(); ++i) {
+        if (user->input(i) != this) continue;
+        user->ReplaceInput(this, to);
+        DetachUser(user);
+        to->AddUser(user);
+    }
+}
+
+void Value::ReplaceAllUsesWith(Value* to) {
+    // Copied as `users_` is modified in the loop.
+    const std::vector<Node*> users = users_;
+    for (Node* user : users) {
+        ReplaceInputOf(user, to);
+    }
+}
+
 void Value::SetProducer(Node* producer) {
     producer_ = producer;
 }
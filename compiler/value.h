@@ -73,6 +73,10 @@ public:
     }
     void AddUser(Node* user);
     void DetachUser(const Node* user);
+    // Lets `user` use `to` instead of this value.
+    void ReplaceInputOf(Node* user, Value* to);
+    // Lets all users use `to` instead of this value.
+    void ReplaceAllUsesWith(Value* to);
 
     Node* producer() const {
         return producer_;
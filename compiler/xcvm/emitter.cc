@@ -1,18 +1,24 @@
 #include "compiler/xcvm/emitter.h"
 
+#include <algorithm>
 #include <map>
+#include <string>
 
 #include <common/log.h>
 #include <common/strutil.h>
+#include <compiler/elementwise_cpu_builder.h>
 #include <compiler/flags.h>
 #include <compiler/gen_xcvm_codegen.h>
 #include <compiler/graph.h>
 #include <compiler/log.h>
+#include <compiler/memory_planner.h>
 #include <compiler/model.h>
 #include <compiler/node.h>
 #include <compiler/nvrtc_builder.h>
 #include <compiler/passes.h>
+#include <compiler/tensor.h>
 #include <compiler/tvm/compiler.h>
+#include <compiler/type.h>
 #include <compiler/value.h>
 #include <runtime/xcvm.pb.h>
 
@@ -34,6 +40,9 @@ namespace {
 
 using chainer_compiler::runtime::XCProgramProto;
 
+// The alignment of each constant in `XCProgramProto::constants`.
+const size_t kConstantAlignment = 64;
+
 std::vector<int> IntVector(const std::vector<int64_t>& ints) {
     return std::vector<int>{ints.begin(), ints.end()};
 }
@@ -66,6 +75,15 @@ public:
 
     void EmitModel(const Graph& graph, XCProgramProto* program, bool dump_value_names) {
         AssignValueIds(graph);
+        has_grad_nodes_ = std::any_of(graph.nodes().begin(), graph.nodes().end(), [](const Node* node) { return node->IsGradNode(); });
+        if (g_plan_memory) {
+            MemoryPlan plan = PlanMemory(graph);
+            for (const auto& p : plan.offsets) {
+                CHECK(arena_offsets_.emplace(GetValueId(p.first), p.second).second);
+            }
+            program->set_arena_size(plan.arena_size);
+        }
+        if (g_inference_only) program->set_inference_only(true);
         EmitGraph(graph, program, false /* in_loop */, graph.output_values());
         EmitOutputs(graph.output_values(), program);
         if (dump_value_names) {
@@ -93,7 +111,8 @@ public:
         }
     }
 
-    void EmitNodes(const std::vector<Node*>& nodes, runtime::XCProgramProto* program) {
+    void EmitNodes(const std::vector<Node*>& nodes, const std::vector<Value*>& fetches, runtime::XCProgramProto* program) {
+        fetched_values_.insert(fetches.begin(), fetches.end());
         for (Node* node : nodes) {
             EmitNode(nullptr /* graph */, *node, program);
         }
@@ -107,6 +126,12 @@ public:
     }
 
 private:
+    // A sequence can be moved instead of copied when nothing else reads
+    // it, including the caller of the program.
+    bool CanMoveSequence(const Value* value) const {
+        return value->users().size() == 1 && !value->IsOutput() && !fetched_values_.count(value);
+    }
+
     void AssignValueIds(const Graph& graph) {
         for (const Value* v : graph.input_values()) {
             CHECK(value_ids_.emplace(v, next_value_id_++).second) << v->DebugString();
@@ -123,6 +148,23 @@ private:
         }
     }
 
+    static std::vector<int> GetPads(const Node& node) {
+        std::vector<int> pads = IntVector(node.pads());
+        // Both Chainer and ChainerX expect paddings for beginning
+        // and end are the same.
+        CHECK_EQ(pads.size() % 2, 0);
+        for (size_t i = 0; i < pads.size() / 2; ++i) {
+            CHECK_EQ(pads[i], pads[i + pads.size() / 2]);
+        }
+        pads.resize(pads.size() / 2);
+        return ComplementStrideOrPad(pads, node.input(0), 0);
+    }
+
+    static std::vector<int> GetStrides(const Node& node) {
+        std::vector<int> strides = IntVector(node.strides());
+        return ComplementStrideOrPad(strides, node.input(0), 1);
+    }
+
     int GetStackId(int i) const {
         auto found = stack_ids_.find(i);
         CHECK(found != stack_ids_.end()) << "Stack not exist: " << i;
@@ -164,22 +206,9 @@ private:
             return out(i);
         };
 
-        auto pads = [&node]() {
-            std::vector<int> pads = IntVector(node.pads());
-            // Both Chainer and ChainerX expect paddings for beginning
-            // and end are the same.
-            CHECK_EQ(pads.size() % 2, 0);
-            for (size_t i = 0; i < pads.size() / 2; ++i) {
-                CHECK_EQ(pads[i], pads[i + pads.size() / 2]);
-            }
-            pads.resize(pads.size() / 2);
-            return ComplementStrideOrPad(pads, node.input(0), 0);
-        };
+        auto pads = [&node]() { return GetPads(node); };
 
-        auto strides = [&node]() {
-            std::vector<int> strides = IntVector(node.strides());
-            return ComplementStrideOrPad(strides, node.input(0), 1);
-        };
+        auto strides = [&node]() { return GetStrides(node); };
 
         auto direction = [&node]() {
             const std::string& dir = node.direction();
@@ -584,7 +613,7 @@ private:
             EMIT(SequenceLengths, out(0), in(0));
         } else if (node.op_type() == Node::kChainerSequenceAppend) {
             XCVMValue o(out(0));
-            if (node.input(0)->users().size() == 1) {
+            if (CanMoveSequence(node.input(0))) {
                 // Avoid O(N^2) copies for the simple case.
                 EMIT(SequenceMove, o, in(0));
                 EMIT(SequenceAppend, o.id(), in(1));
@@ -594,7 +623,7 @@ private:
             }
         } else if (node.op_type() == Node::kChainerSequencePop) {
             XCVMValue o0(out(0));
-            if (node.input(0)->users().size() == 1) {
+            if (CanMoveSequence(node.input(0))) {
                 // Avoid O(N^2) copies for the simple case.
                 EMIT(SequenceMove, o0, in(0));
                 EMIT(SequencePop, out(1), o0.id());
@@ -655,42 +684,43 @@ private:
             CHECK_GT(1ULL << 32ULL, d);
             shape.push_back(d);
         }
-        if (dtype.IsFloat()) {
-            std::vector<double> v;
-            for (int64_t i = 0; i < value->NumElements(); ++i) {
-                if (dtype.SizeOf() == 4) {
-                    v.push_back(value->Get<float>(i));
-                } else if (dtype.SizeOf() == 8) {
-                    v.push_back(value->Get<double>(i));
-                } else {
-                    CHECK(false) << "Unknown type: " << dtype;
-                }
-            }
-            if (shape.empty()) {
-                EMIT(FloatScalarConstant, out, v[0], dtype, host);
+        // Integer tensors are usually shapes or indices which are
+        // consumed on the host.
+        if (!dtype.IsFloat()) host = dtype == Dtype::kInt64;
+
+        if (!shape.empty()) {
+            // The raw data is stored out of line so the runtime can
+            // create arrays which share the data.
+            std::string* constants = prog->mutable_constants();
+            constants->resize((constants->size() + kConstantAlignment - 1) / kConstantAlignment * kConstantAlignment);
+            const int64_t offset = constants->size();
+            CHECK_GT(1LL << 31LL, offset) << "Too large constants";
+            constants->append(static_cast<const char*>(value->GetRawData()), value->NumElements() * value->ElementSize());
+            EMIT(BinaryConstant, out, offset, dtype, shape, host);
+        } else if (dtype.IsFloat()) {
+            double v;
+            if (dtype.SizeOf() == 4) {
+                v = value->Get<float>(0);
+            } else if (dtype.SizeOf() == 8) {
+                v = value->Get<double>(0);
             } else {
-                EMIT(FloatConstant, out, v, dtype, shape, host);
+                CHECK(false) << "Unknown type: " << dtype;
             }
+            EMIT(FloatScalarConstant, out, v, dtype, host);
         } else {
-            std::vector<int64_t> v;
-            for (int64_t i = 0; i < value->NumElements(); ++i) {
-                if (dtype.SizeOf() == 1) {
-                    v.push_back(value->Get<int8_t>(i));
-                } else if (dtype.SizeOf() == 2) {
-                    v.push_back(value->Get<int16_t>(i));
-                } else if (dtype.SizeOf() == 4) {
-                    v.push_back(value->Get<int32_t>(i));
-                } else if (dtype.SizeOf() == 8) {
-                    v.push_back(value->Get<int64_t>(i));
-                } else {
-                    CHECK(false) << "Unknown type: " << dtype;
-                }
-            }
-            if (shape.empty()) {
-                EMIT(IntScalarConstant, out, v[0], dtype, true);
+            int64_t v;
+            if (dtype.SizeOf() == 1) {
+                v = value->Get<int8_t>(0);
+            } else if (dtype.SizeOf() == 2) {
+                v = value->Get<int16_t>(0);
+            } else if (dtype.SizeOf() == 4) {
+                v = value->Get<int32_t>(0);
+            } else if (dtype.SizeOf() == 8) {
+                v = value->Get<int64_t>(0);
             } else {
-                EMIT(IntConstant, out, v, dtype, shape, dtype == Dtype::kInt64);
+                CHECK(false) << "Unknown type: " << dtype;
             }
+            EMIT(IntScalarConstant, out, v, dtype, true);
         }
     }
 
@@ -747,7 +777,12 @@ private:
                 }
             }
 
+            const int node_begin = prog->instructions_size();
             EmitNode(&graph, *node, prog);
+            SetArenaOffsets(node_begin, prog);
+            if (prog->instructions_size() == node_begin + 1) {
+                MarkInplaceInput(*node, num_users, output_values, prog->mutable_instructions(node_begin));
+            }
 
             for (const Value* output : node->outputs()) {
                 // Do not free output values.
@@ -768,6 +803,59 @@ private:
         }
     }
 
+    // Lets the runtime reuse the buffer of an input which dies at
+    // `node` for its output. `num_users` must not be updated for
+    // `node` yet. Nothing is marked for a graph with gradient nodes
+    // since they may read values retained by forward ops.
+    void MarkInplaceInput(
+            const Node& node,
+            const std::map<const Value*, int>& num_users,
+            const std::vector<Value*>& output_values,
+            runtime::XCInstructionProto* inst) {
+        if (has_grad_nodes_) return;
+        if (!CanWriteToPreallocatedOutput(node.op_type()) || node.outputs().size() != 1) return;
+        if (inst->output_offsets_size()) return;
+        const Type& type = node.output(0)->type();
+        if (type.kind() != Type::Kind::kTensor || !type.HasKnownShape()) return;
+
+        for (size_t i = 0; i < node.inputs().size(); ++i) {
+            const Value* input = node.input(i);
+            // Inputs of the graph are owned by the caller, and values
+            // in the arena must stay in their regions.
+            if (!input->IsTemp() || arena_offsets_.count(GetValueId(input))) continue;
+            if (std::find(output_values.begin(), output_values.end(), input) != output_values.end()) continue;
+            auto found = num_users.find(input);
+            if (found == num_users.end() || found->second != std::count(node.inputs().begin(), node.inputs().end(), input)) continue;
+            // Other values may share the buffer of `input`.
+            if (!input->producer() || !IsAliasFreeOp(input->producer()->op_type())) continue;
+            const auto is_alias_free = [](const Node* user) { return IsAliasFreeOp(user->op_type()); };
+            if (!std::all_of(input->users().begin(), input->users().end(), is_alias_free)) continue;
+            const Type& input_type = input->type();
+            if (input_type.kind() != Type::Kind::kTensor || !input_type.HasKnownShape() || input_type.dtype() != type.dtype() ||
+                input_type.dims() != type.dims()) {
+                continue;
+            }
+            inst->set_inplace_input(i);
+            return;
+        }
+    }
+
+    void SetArenaOffsets(int begin, XCProgramProto* prog) {
+        if (arena_offsets_.empty()) return;
+        for (int pc = begin; pc < prog->instructions_size(); ++pc) {
+            runtime::XCInstructionProto* inst = prog->mutable_instructions(pc);
+            bool has_offset = false;
+            for (int id : inst->outputs()) {
+                if (arena_offsets_.count(id)) has_offset = true;
+            }
+            if (!has_offset) continue;
+            for (int id : inst->outputs()) {
+                auto found = arena_offsets_.find(id);
+                inst->add_output_offsets(found == arena_offsets_.end() ? -1 : found->second);
+            }
+        }
+    }
+
     std::string GetFusionGroupSummary(const Node& node) {
         std::string ret = node.ToString();
         ret += " (";
@@ -776,6 +864,58 @@ private:
         return ret;
     }
 
+    // Emits a fusion group made by `FuseConvOperations`, which is Conv
+    // followed by an optional Add and an optional Relu.
+    void EmitFusedConv(const Node& node, XCProgramProto* prog) {
+        const Graph& body = *node.subgraph();
+        const Node* conv = nullptr;
+        const Node* add = nullptr;
+        const Node* relu = nullptr;
+        for (const Node* n : body.nodes()) {
+            switch (n->op_type()) {
+                case Node::kConv:
+                    conv = n;
+                    break;
+                case Node::kAdd:
+                    add = n;
+                    break;
+                case Node::kRelu:
+                    relu = n;
+                    break;
+                default:
+                    CHECK(false) << "Unexpected node in a fused Conv: " << n->ToString();
+            }
+        }
+        CHECK(conv);
+        CHECK_EQ(1, node.outputs().size());
+
+        // Values in `body` are mapped to inputs of the fusion group.
+        auto outer_id = [this, &body, &node](const Value* value) {
+            const std::vector<Value*>& inputs = body.input_values();
+            auto found = std::find(inputs.begin(), inputs.end(), value);
+            CHECK(found != inputs.end()) << value->DebugString();
+            return GetValueId(node.input(found - inputs.begin()));
+        };
+
+        int b = -1;
+        if (conv->inputs().size() >= 3 && !conv->input(2)->IsNull()) b = outer_id(conv->input(2));
+        int residual = -1;
+        if (add) residual = outer_id(add->input(0) == conv->output(0) ? add->input(1) : add->input(0));
+
+        const std::string& debug_info = node.ToString();
+        AddFusedConvOp(
+                prog,
+                XCVMValue(GetValueId(node.output(0)), node.output(0)),
+                outer_id(conv->input(0)),
+                outer_id(conv->input(1)),
+                b,
+                residual,
+                GetStrides(*conv),
+                GetPads(*conv),
+                relu != nullptr);
+        FillOpInfo(node, debug_info, prog);
+    }
+
     void EmitFusionGroup(const Node& node, XCProgramProto* prog) {
         const Graph& body = *node.subgraph();
         CHECK_EQ(node.inputs().size(), body.input_values().size());
@@ -836,6 +976,32 @@ private:
             return;
         }
 
+        if (node.fusion_type() == "nvrtc") {
+            std::vector<int64_t> program;
+            std::vector<double> constants;
+            std::vector<int64_t> output_regs;
+            BuildElementWiseCpuProgram(body.nodes(), body.input_values(), body.output_values(), &program, &constants, &output_regs);
+            if (g_compiler_log) {
+                CLOG() << "Fusion group (CPU) " << GetFusionGroupSummary(node) << std::endl;
+            }
+
+            std::vector<int> inputs;
+            std::vector<XCVMValue> outputs;
+            for (Value* value : node.inputs()) {
+                inputs.push_back(GetValueId(value));
+            }
+            for (Value* value : node.outputs()) {
+                outputs.emplace_back(GetValueId(value), value);
+            }
+            EMIT(ElementWiseCpu, outputs, inputs, program, constants, output_regs, node.chainer_fusion_group());
+            return;
+        }
+
+        if (node.fusion_type() == "conv") {
+            EmitFusedConv(node, prog);
+            return;
+        }
+
         AssignValueIds(body);
 
         for (size_t i = 0; i < node.inputs().size(); ++i) {
@@ -1116,6 +1282,10 @@ private:
     std::map<const Value*, int> value_ids_;
     std::map<int, int> stack_ids_;
     std::set<const Node*> emitted_;
+    // Offsets in the arena keyed by value IDs.
+    std::map<int, int64_t> arena_offsets_;
+    bool has_grad_nodes_{false};
+    std::set<const Value*> fetched_values_;
 };
 
 }  // namespace
@@ -1148,7 +1318,7 @@ void Emit(
     }
     emitter.AssignValueIds(values);
     for (Value* v : fetches) output_ids->push_back(emitter.GetValueId(v));
-    emitter.EmitNodes(nodes, program);
+    emitter.EmitNodes(nodes, fetches, program);
 }
 
 }  // namespace xcvm
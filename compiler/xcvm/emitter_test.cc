@@ -1,4 +1,5 @@
 #include <iostream>
+#include <map>
 #include <sstream>
 
 #include <gtest/gtest.h>
@@ -7,8 +8,13 @@
 
 #include <common/log.h>
 #include <common/protoutil.h>
+#include <compiler/graph.h>
+#include <compiler/graph_builder.h>
 #include <compiler/model.h>
+#include <compiler/node.h>
 #include <compiler/passes.h>
+#include <compiler/scheduler.h>
+#include <compiler/type.h>
 #include <compiler/xcvm/emitter.h>
 #include <runtime/xcvm.pb.h>
 
@@ -41,5 +47,82 @@ TEST(XCVMTest, Compile) {
     ASSERT_EQ(runtime::XCInstructionProto::Free, program.instructions(6).op());
 }
 
+TEST(XCVMTest, InplaceInput) {
+    const Type type(Dtype::kFloat32, {2, 3});
+    Graph graph("test");
+    Value* in = graph.AddInputValue("in", type);
+    Value* out = graph.AddOutputValue("out", type);
+    Value* t0 = graph.AddValue("t0", type);
+    Value* t1 = graph.AddValue("t1", type);
+    graph.AddNode(Node::kRelu, {in}, {t0});
+    graph.AddNode(Node::kExp, {t0}, {t1});
+    graph.AddNode(Node::kAdd, {in, t1}, {out});
+    ScheduleComputation(graph, 0);
+
+    runtime::XCProgramProto program;
+    xcvm::Emit(graph, &program);
+
+    std::map<runtime::XCInstructionProto::Op, int> inplace_inputs;
+    for (const runtime::XCInstructionProto& inst : program.instructions()) {
+        inplace_inputs[inst.op()] = inst.inplace_input();
+    }
+    // The graph input is owned by the caller.
+    EXPECT_EQ(-1, inplace_inputs[runtime::XCInstructionProto::Relu]);
+    EXPECT_EQ(0, inplace_inputs[runtime::XCInstructionProto::Exp]);
+    EXPECT_EQ(1, inplace_inputs[runtime::XCInstructionProto::Add]);
+}
+
+TEST(XCVMTest, NoInplaceInputWithGradNodes) {
+    const Type type(Dtype::kFloat32, {2, 3});
+    Graph graph("test");
+    Value* in = graph.AddInputValue("in", type);
+    Value* out = graph.AddOutputValue("out", type);
+    Value* gout = graph.AddOutputValue("gout", type);
+    Value* t0 = graph.AddValue("t0", type);
+    Value* t1 = graph.AddValue("t1", type);
+    graph.AddNode(Node::kRelu, {in}, {t0});
+    graph.AddNode(Node::kExp, {t0}, {t1});
+    graph.AddNode(Node::kNeg, {t1}, {out});
+    graph.AddNode(Node::kNeg, {in}, {gout}, "NegGrad");
+    ScheduleComputation(graph, 0);
+
+    runtime::XCProgramProto program;
+    xcvm::Emit(graph, &program);
+
+    for (const runtime::XCInstructionProto& inst : program.instructions()) {
+        EXPECT_EQ(-1, inst.inplace_input()) << inst.DebugString();
+    }
+}
+
+TEST(XCVMTest, BinaryConstant) {
+    Graph graph("test");
+    Value* out = graph.AddOutputValue("out", Type(Dtype::kFloat32, {3, 1}));
+    GraphBuilder gb(&graph, "test", out);
+    Value* a = gb.Const(Type(Dtype::kFloat32, {3}), {1.0, 2.0, 3.0});
+    Value* b = gb.Const(Type(Dtype::kInt64, {2}), {3, 1});
+    gb.Op(Node::kReshape, {a, b}, out);
+    ScheduleComputation(graph, 0);
+
+    runtime::XCProgramProto program;
+    xcvm::Emit(graph, &program);
+
+    // Offsets keyed by dtypes.
+    std::map<int, int64_t> offsets;
+    for (const runtime::XCInstructionProto& inst : program.instructions()) {
+        if (inst.op() == runtime::XCInstructionProto::BinaryConstant) offsets.emplace(inst.inputs(1).i(), inst.inputs(0).i());
+    }
+    ASSERT_EQ(2UL, offsets.size());
+    const int64_t a_offset = offsets[static_cast<int>(Dtype::kFloat32)];
+    const int64_t b_offset = offsets[static_cast<int>(Dtype::kInt64)];
+    // Each constant is aligned.
+    EXPECT_EQ(0, a_offset % 64);
+    EXPECT_EQ(0, b_offset % 64);
+    EXPECT_NE(a_offset, b_offset);
+    const float* a_data = reinterpret_cast<const float*>(program.constants().data() + a_offset);
+    EXPECT_EQ(3.0, a_data[2]);
+    const int64_t* b_data = reinterpret_cast<const int64_t*>(program.constants().data() + b_offset);
+    EXPECT_EQ(1, b_data[1]);
+}
+
 }  // namespace
 }  // namespace chainer_compiler
@@ -0,0 +1,155 @@
+#include "compiler/xcvm/program_cache.h"
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+
+#include <compiler/onnx.h>
+
+#include <common/file_util.h>
+#include <common/hash.h>
+#include <common/log.h>
+#include <common/strutil.h>
+#include <compiler/batch_normalization_folding.h>
+#include <compiler/flags.h>
+#include <compiler/graph.h>
+#include <compiler/tensor.h>
+#include <compiler/value.h>
+#include <runtime/xcvm.h>
+#include <runtime/xcvm.pb.h>
+
+namespace chainer_compiler {
+namespace xcvm {
+
+namespace {
+
+// Bump this when the compiler changes generated code without changing
+// the set of XCVM ops.
+const int kProgramCacheVersion = 2;
+
+// 64-bit FNV-1a over 8-byte words, which is fast enough for weights.
+uint64_t HashData(const void* data, size_t size) {
+    const uint64_t kPrime = 0x100000001b3ULL;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const char* p = static_cast<const char*>(data);
+    for (size_t i = 0; i < size; i += sizeof(uint64_t)) {
+        uint64_t word = 0;
+        memcpy(&word, p + i, std::min(sizeof(uint64_t), size - i));
+        hash ^= word;
+        hash *= kPrime;
+    }
+    return hash;
+}
+
+void WriteFile(const std::string& filename, const std::string& data) {
+    // Written to a temporary file first so concurrent readers never
+    // see a partial file.
+    const std::string tmp = GetTemporaryFilename(filename);
+    {
+        std::ofstream ofs(tmp, std::ios::binary);
+        CHECK(ofs) << "Failed to open " << tmp;
+        CHECK(ofs.write(data.data(), data.size())) << "Failed to write " << tmp;
+    }
+    CHECK_EQ(0, rename(tmp.c_str(), filename.c_str())) << "Failed to rename " << tmp << ": " << strerror(errno);
+}
+
+}  // namespace
+
+ProgramCache::ProgramCache(const std::string& dir) : dir_(dir) {
+    // Cached programs are loaded and run.
+    MakePrivateDirs(dir_);
+    CheckPrivateFile(dir_);
+}
+
+std::string ProgramCache::GetKey(const Graph& graph, const std::string& extra) const {
+    onnx::GraphProto xgraph;
+    graph.ToONNX(&xgraph, false /* serialize_initializers */);
+    // Which inputs have initializers matters, e.g., for gradients.
+    for (const Value* value : graph.input_values()) {
+        if (value->initializer()) xgraph.add_initializer()->set_name(value->name());
+    }
+    std::string data;
+    CHECK(xgraph.SerializeToString(&data));
+    // Values of these initializers are embedded to the program.
+    if (g_inference_only) {
+        for (const Value* value : GetInitializersToFoldBatchNormalizations(graph)) {
+            const Tensor& tensor = *value->initializer();
+            data += StrCat(' ', value->name(), '=', HashData(tensor.GetRawData(), tensor.ElementSize() * tensor.NumElements()));
+        }
+    }
+    // TVM kernels depend on the contents of the AutoTVM log, not only
+    // on its path.
+    if (!g_autotvm_log.empty()) {
+        std::ifstream ifs(g_autotvm_log, std::ios::binary);
+        CHECK(ifs) << "Failed to open " << g_autotvm_log;
+        const std::string log((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+        data += StrCat(" autotvm_log=", HashData(log.data(), log.size()));
+    }
+    data += StrCat(
+            "\nversion=",
+            kProgramCacheVersion,
+            " num_ops=",
+            runtime::XCInstructionProto::Op_ARRAYSIZE,
+            " ",
+            GetCompilerFlagsFingerprint(),
+            " ",
+            extra);
+    return Fingerprint(data);
+}
+
+bool ProgramCache::Load(const std::string& key, runtime::XCProgramProto* program) const {
+    const std::string filename = GetPath(key, ".xcvm");
+    std::ifstream ifs(filename, std::ios::binary);
+    if (!ifs) return false;
+    CheckPrivateFile(filename);
+    ::google::protobuf::io::IstreamInputStream iis(&ifs);
+    ::google::protobuf::io::CodedInputStream cis(&iis);
+    cis.SetTotalBytesLimit(std::numeric_limits<int>::max(), std::numeric_limits<int>::max());
+    if (!program->ParseFromCodedStream(&cis)) {
+        WARN_ONCE(StrCat("Broken program in the cache: ", filename));
+        return false;
+    }
+    runtime::ResolveConstantsFile(filename, program);
+    if (program->has_constants_file()) {
+        struct stat st;
+        if (stat(program->constants_file().c_str(), &st) != 0) {
+            WARN_ONCE(StrCat("Missing constants in the cache: ", program->constants_file()));
+            return false;
+        }
+        CheckPrivateFile(program->constants_file());
+    }
+    return true;
+}
+
+void ProgramCache::Save(const std::string& key, const runtime::XCProgramProto& program) const {
+    runtime::XCProgramProto stored(program);
+    if (!stored.constants().empty()) {
+        // Named by their hash so the program, which is written last,
+        // never refers to constants written for another program.
+        const std::string& constants = stored.constants();
+        const std::string filename = GetPath(key, StrCat('.', HashData(constants.data(), constants.size()), ".constants"));
+        WriteFile(filename, constants);
+        stored.clear_constants();
+        stored.set_constants_file(Basename(filename));
+    }
+    std::string data;
+    CHECK(stored.SerializeToString(&data));
+    WriteFile(GetPath(key, ".xcvm"), data);
+}
+
+std::string ProgramCache::GetPath(const std::string& key, const std::string& suffix) const {
+    return StrCat(dir_, '/', key, suffix);
+}
+
+}  // namespace xcvm
+}  // namespace chainer_compiler
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+
+namespace chainer_compiler {
+
+class Graph;
+
+namespace runtime {
+class XCProgramProto;
+}
+
+namespace xcvm {
+
+// A directory which keeps XCVM programs compiled from ONNX graphs so
+// processes can skip the compilation of models compiled before.
+class ProgramCache {
+public:
+    explicit ProgramCache(const std::string& dir);
+
+    // Returns the key of the program compiled from `graph` with the
+    // current compiler flags. `graph` must not be optimized yet.
+    // Values of initializers are not a part of the key as they are
+    // passed to programs as inputs, except ones which will be folded
+    // into constants with `g_inference_only`. `extra` distinguishes
+    // programs compiled from the same graph with different options.
+    std::string GetKey(const Graph& graph, const std::string& extra) const;
+
+    // Returns false if there is no program for `key`.
+    bool Load(const std::string& key, runtime::XCProgramProto* program) const;
+
+    // Constants of `program` are stored in a separate file so the
+    // loaded program maps them to memory. The program is written after
+    // the constants, so a loaded program always has its constants.
+    void Save(const std::string& key, const runtime::XCProgramProto& program) const;
+
+private:
+    std::string GetPath(const std::string& key, const std::string& suffix) const;
+
+    const std::string dir_;
+};
+
+}  // namespace xcvm
+}  // namespace chainer_compiler
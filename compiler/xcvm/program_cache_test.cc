@@ -0,0 +1,125 @@
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <common/log.h>
+#include <compiler/flags.h>
+#include <compiler/graph.h>
+#include <compiler/node.h>
+#include <compiler/type.h>
+#include <compiler/xcvm/program_cache.h>
+#include <runtime/xcvm.pb.h>
+
+namespace chainer_compiler {
+namespace {
+
+std::unique_ptr<Graph> MakeGraph(float weight) {
+    std::unique_ptr<Graph> graph(new Graph("test"));
+    const Type type(Dtype::kFloat32, {2});
+    Value* in = graph->AddInputValue("in", type);
+    Value* w = graph->AddConstValue("w", type, {weight, weight});
+    Value* out = graph->AddOutputValue("out", type);
+    graph->AddNode(Node::kAdd, {in, w}, {out});
+    return graph;
+}
+
+// A cache directory which is removed with its files at the end of a
+// test.
+class TempCacheDir {
+public:
+    TempCacheDir() {
+        char dir[] = "/tmp/program_cache_test_XXXXXX";
+        CHECK(mkdtemp(dir));
+        dir_ = dir;
+    }
+
+    ~TempCacheDir() {
+        DIR* dir = opendir(dir_.c_str());
+        CHECK(dir);
+        while (const dirent* ent = readdir(dir)) {
+            const std::string name = ent->d_name;
+            if (name != "." && name != "..") unlink((dir_ + '/' + name).c_str());
+        }
+        closedir(dir);
+        rmdir(dir_.c_str());
+    }
+
+    const std::string& dir() const {
+        return dir_;
+    }
+
+private:
+    std::string dir_;
+};
+
+TEST(ProgramCacheTest, Key) {
+    TempCacheDir dir;
+    xcvm::ProgramCache cache(dir.dir());
+    const std::string key = cache.GetKey(*MakeGraph(1), "");
+    // Values of initializers do not matter.
+    EXPECT_EQ(key, cache.GetKey(*MakeGraph(2), ""));
+    EXPECT_NE(key, cache.GetKey(*MakeGraph(1), "backprop"));
+
+    g_fuse_operations = true;
+    EXPECT_NE(key, cache.GetKey(*MakeGraph(1), ""));
+    g_fuse_operations = false;
+
+    // Contents of the AutoTVM log matter.
+    g_autotvm_log = dir.dir() + "/autotvm.log";
+    { std::ofstream(g_autotvm_log) << "foo"; }
+    const std::string tvm_key = cache.GetKey(*MakeGraph(1), "");
+    { std::ofstream(g_autotvm_log) << "bar"; }
+    EXPECT_NE(tvm_key, cache.GetKey(*MakeGraph(1), ""));
+    g_autotvm_log.clear();
+
+    std::unique_ptr<Graph> graph(MakeGraph(1));
+    graph->AddNode(Node::kRelu, {graph->input_values()[0]}, {graph->AddOutputValue("out2", Type(Dtype::kFloat32, {2}))});
+    EXPECT_NE(key, cache.GetKey(*graph, ""));
+}
+
+TEST(ProgramCacheTest, SaveAndLoad) {
+    TempCacheDir dir;
+    xcvm::ProgramCache cache(dir.dir());
+    const std::string key = cache.GetKey(*MakeGraph(1), "");
+    runtime::XCProgramProto program;
+    EXPECT_FALSE(cache.Load(key, &program));
+
+    program.add_instructions()->set_op(runtime::XCInstructionProto::Add);
+    program.set_constants("constant data");
+    cache.Save(key, program);
+
+    runtime::XCProgramProto loaded;
+    ASSERT_TRUE(cache.Load(key, &loaded));
+    ASSERT_EQ(1, loaded.instructions_size());
+    EXPECT_EQ(runtime::XCInstructionProto::Add, loaded.instructions(0).op());
+    // Constants are moved to a file.
+    EXPECT_TRUE(loaded.constants().empty());
+    std::ifstream ifs(loaded.constants_file());
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    EXPECT_EQ("constant data", oss.str());
+}
+
+TEST(ProgramCacheTest, MissingConstants) {
+    TempCacheDir dir;
+    xcvm::ProgramCache cache(dir.dir());
+    const std::string key = cache.GetKey(*MakeGraph(1), "");
+    runtime::XCProgramProto program;
+    program.set_constants("constant data");
+    cache.Save(key, program);
+
+    runtime::XCProgramProto loaded;
+    ASSERT_TRUE(cache.Load(key, &loaded));
+    ASSERT_EQ(0, unlink(loaded.constants_file().c_str()));
+    EXPECT_FALSE(cache.Load(key, &loaded));
+}
+
+}  // namespace
+}  // namespace chainer_compiler
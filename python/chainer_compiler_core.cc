@@ -9,13 +9,15 @@
 #include <chainerx/array_body.h>
 
 #include <common/log.h>
-#include <common/protoutil.h>
 #include <compiler/gradient.h>
 #include <compiler/graph.h>
+#include <compiler/log.h>
 #include <compiler/model.h>
 #include <compiler/passes.h>
 #include <compiler/subgraph_canonicalizer.h>
+#include <compiler/util.h>
 #include <compiler/xcvm/emitter.h>
+#include <compiler/xcvm/program_cache.h>
 #include <runtime/xcvm.h>
 #include <runtime/xcvm.pb.h>
 #include <runtime/xcvm_var.h>
@@ -30,7 +32,7 @@ typedef std::shared_ptr<chainerx::internal::ArrayBody> ArrayBodyPtr;
 typedef std::shared_ptr<runtime::XCVMVar> VarPtr;
 
 std::shared_ptr<Graph> LoadGraph(const std::string& onnx_path) {
-    onnx::ModelProto xmodel(LoadLargeProto<onnx::ModelProto>(onnx_path));
+    onnx::ModelProto xmodel(LoadONNXModel(onnx_path));
     return std::make_shared<Graph>(xmodel.graph());
 }
 
@@ -43,12 +45,27 @@ std::map<std::string, VarPtr> LoadParams(const std::shared_ptr<Graph>& graph) {
     return params;
 }
 
-std::shared_ptr<runtime::XCVM> Compile(const std::shared_ptr<Graph>& graph) {
+std::shared_ptr<runtime::XCVM> Compile(const std::shared_ptr<Graph>& graph, const std::string& program_cache_dir) {
+    std::unique_ptr<xcvm::ProgramCache> program_cache;
+    std::string program_cache_key;
+    runtime::XCProgramProto xcvm_prog;
+    if (!program_cache_dir.empty()) {
+        program_cache.reset(new xcvm::ProgramCache(program_cache_dir));
+        program_cache_key = program_cache->GetKey(*graph, "python");
+        if (program_cache->Load(program_cache_key, &xcvm_prog)) {
+            CLOG() << "Program cache hit: " << program_cache_key << std::endl;
+            return std::make_shared<runtime::XCVM>(xcvm_prog);
+        }
+        CLOG() << "Program cache miss: " << program_cache_key << std::endl;
+    }
+
     constexpr bool kBackprop = false;
     RunDefaultPasses(graph.get(), kBackprop);
-    runtime::XCProgramProto xcvm_prog;
     constexpr bool kDumpValueNames = false;
     xcvm::Emit(*graph, &xcvm_prog, kDumpValueNames);
+    if (program_cache) {
+        program_cache->Save(program_cache_key, xcvm_prog);
+    }
     return std::make_shared<runtime::XCVM>(xcvm_prog);
 }
 
@@ -90,7 +107,7 @@ std::string Dump(const std::shared_ptr<Graph>& graph) {
 void InitGraph(py::module& m) {
     py::class_<Graph, std::shared_ptr<Graph>> c{m, "Graph"};
     c.def("params", &LoadParams, "Load parameters of a model");
-    c.def("compile", &Compile, "Compile a model");
+    c.def("compile", &Compile, "Compile a model", py::arg("program_cache_dir") = "");
     c.def("input_names", &GetInputNames, "Names of inputs");
     c.def("output_names", &GetOutputNames, "Names of outputs");
     c.def("backward", &GenerateBackward, "Generate a pair of graphs for forward and back propagation");
@@ -2,6 +2,7 @@
 
 #include <cstring>
 #include <limits>
+#include <mutex>
 #include <numeric>
 
 #include <chainerx/array.h>
@@ -125,7 +126,9 @@ chainerx::Array Sigmoid(chainerx::Array a) {
 namespace {
 
 uint32_t xorshift() {
+    static std::mutex mu;
     static uint32_t y = 2463534242;
+    std::lock_guard<std::mutex> lock{mu};
     y = y ^ (y << 13);
     y = y ^ (y >> 17);
     return y = y ^ (y << 15);
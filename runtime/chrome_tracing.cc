@@ -1,65 +1,160 @@
 #include "chrome_tracing.h"
 
-#include <cstdint>
+#include <atomic>
 #include <fstream>
+#include <thread>
+
+#include <runtime/meminfo.h>
 
 namespace chainer_compiler {
 namespace runtime {
 
-ChromeTracingEmitter::ChromeTracingEmitter() : base_time_(std::chrono::system_clock::now()) {
+struct ChromeTracingEmitter::ThreadBuffer {
+    ThreadBuffer(std::thread::id t, int i, size_t c) : thread_id(t), tid(i), capacity(c) {
+    }
+
+    const std::thread::id thread_id;
+    const int tid;
+    const size_t capacity;
+    // Grows up to `capacity` events.
+    std::vector<Record> records;
+    // The total number of recorded events. Only the last
+    // `records.size()` events are kept.
+    uint64_t num_records{0};
+    // A cache of `names_` which can be looked up without locks.
+    std::unordered_map<std::string, int> name_ids;
+};
+
+namespace {
+
+std::atomic<int64_t> g_next_emitter_id{0};
+
+struct ThreadLocalCache {
+    int64_t emitter_id{-1};
+    void* buffer{nullptr};
+};
+
+thread_local ThreadLocalCache g_cache;
+
+}  // namespace
+
+ChromeTracingEmitter::ChromeTracingEmitter(size_t buffer_size)
+    : buffer_size_(buffer_size), id_(g_next_emitter_id++), base_time_(std::chrono::steady_clock::now()) {
 }
 
-void ChromeTracingEmitter::AddEvent(Event* event) {
-    events_.emplace_back(event);
+ChromeTracingEmitter::~ChromeTracingEmitter() {
 }
 
-ChromeTracingEmitter::Event::Event(const std::string& c, const std::string& n, int p)
-    : category(c), name(n), pc(p), start_time(std::chrono::system_clock::now()) {
+ChromeTracingEmitter::ThreadBuffer* ChromeTracingEmitter::GetThreadBuffer() {
+    if (g_cache.emitter_id == id_) return static_cast<ThreadBuffer*>(g_cache.buffer);
+
+    std::lock_guard<std::mutex> lock{mu_};
+    const std::thread::id thread_id = std::this_thread::get_id();
+    ThreadBuffer* buffer = nullptr;
+    for (const std::unique_ptr<ThreadBuffer>& b : buffers_) {
+        if (b->thread_id == thread_id) buffer = b.get();
+    }
+    if (!buffer) {
+        buffers_.emplace_back(new ThreadBuffer(thread_id, buffers_.size() + 1, buffer_size_));
+        buffer = buffers_.back().get();
+    }
+    g_cache.emitter_id = id_;
+    g_cache.buffer = buffer;
+    return buffer;
 }
 
-void ChromeTracingEmitter::Event::Finish() {
-    end_time = std::chrono::system_clock::now();
+int ChromeTracingEmitter::Intern(ThreadBuffer* buffer, const std::string& name) {
+    auto found = buffer->name_ids.find(name);
+    if (found != buffer->name_ids.end()) return found->second;
+
+    int id;
+    {
+        std::lock_guard<std::mutex> lock{mu_};
+        auto inserted = name_ids_.emplace(name, names_.size());
+        if (inserted.second) names_.push_back(name);
+        id = inserted.first->second;
+    }
+    buffer->name_ids.emplace(name, id);
+    return id;
+}
+
+void ChromeTracingEmitter::AddRecord(const Record& record) {
+    ThreadBuffer* buffer = GetThreadBuffer();
+    if (buffer->records.size() < buffer->capacity) {
+        buffer->records.push_back(record);
+    } else if (!buffer->records.empty()) {
+        buffer->records[buffer->num_records % buffer->records.size()] = record;
+    } else {
+        return;
+    }
+    ++buffer->num_records;
 }
 
 ChromeTracingEmitter::ScopedEvent::ScopedEvent(
         ChromeTracingEmitter* chrome_tracing, const std::string& category, const std::string& name, int pc)
-    : event_(nullptr) {
-    if (chrome_tracing) {
-        event_ = new ChromeTracingEmitter::Event(category, name, pc);
-        chrome_tracing->AddEvent(event_);
+    : chrome_tracing_(chrome_tracing), pc_(pc) {
+    if (chrome_tracing_) {
+        ThreadBuffer* buffer = chrome_tracing_->GetThreadBuffer();
+        category_id_ = chrome_tracing_->Intern(buffer, category);
+        name_id_ = chrome_tracing_->Intern(buffer, name);
+        start_allocated_bytes_ = GetThreadAllocatedBytes();
+        start_time_ = std::chrono::steady_clock::now();
     }
 }
 
 ChromeTracingEmitter::ScopedEvent::~ScopedEvent() {
-    if (event_) {
-        event_->Finish();
+    if (chrome_tracing_) {
+        std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
+        const int64_t alloc_bytes = GetThreadAllocatedBytes() - start_allocated_bytes_;
+        const std::chrono::steady_clock::time_point& base_time = chrome_tracing_->base_time_;
+        Record record;
+        record.category_id = category_id_;
+        record.name_id = name_id_;
+        record.pc = pc_;
+        record.start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start_time_ - base_time).count();
+        record.end_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - base_time).count();
+        record.alloc_bytes = alloc_bytes;
+        chrome_tracing_->AddRecord(record);
     }
 }
 
 void ChromeTracingEmitter::Emit(const std::string& output_filename) const {
+    std::lock_guard<std::mutex> lock{mu_};
     std::ofstream ofs(output_filename);
     ofs << "[\n";
     bool is_first = true;
-    for (const std::unique_ptr<Event>& event : events_) {
-        int64_t ts = std::chrono::duration_cast<std::chrono::microseconds>(event->start_time - base_time_).count();
-        int64_t dur = std::chrono::duration_cast<std::chrono::microseconds>(event->end_time - event->start_time).count();
+    for (const std::unique_ptr<ThreadBuffer>& buffer : buffers_) {
+        const uint64_t size = buffer->records.size();
+        const uint64_t begin = buffer->num_records > size ? buffer->num_records - size : 0;
+        for (uint64_t i = begin; i < buffer->num_records; ++i) {
+            const Record& record = buffer->records[i % size];
+            int64_t ts = record.start_ns / 1000;
+            int64_t dur = (record.end_ns - record.start_ns) / 1000;
 
-        if (!is_first) {
-            ofs << ",\n";
-        }
-        is_first = false;
-        ofs << "{";
-        ofs << "\"cat\":\"" << event->category << "\",";
-        ofs << "\"name\":\"" << event->name << "\",";
-        ofs << "\"ts\":" << ts << ",";
-        ofs << "\"dur\":" << dur << ",";
-        ofs << "\"tid\":1,";
-        ofs << "\"pid\":1,";
-        if (event->pc >= 0) {
-            ofs << "\"args\":{\"pc\":" << event->pc << "},";
+            if (!is_first) {
+                ofs << ",\n";
+            }
+            is_first = false;
+            ofs << "{";
+            ofs << "\"cat\":\"" << names_[record.category_id] << "\",";
+            ofs << "\"name\":\"" << names_[record.name_id] << "\",";
+            ofs << "\"ts\":" << ts << ",";
+            ofs << "\"dur\":" << dur << ",";
+            ofs << "\"tid\":" << buffer->tid << ",";
+            ofs << "\"pid\":1,";
+            if (record.pc >= 0 || record.alloc_bytes > 0) {
+                ofs << "\"args\":{";
+                if (record.alloc_bytes > 0) {
+                    ofs << "\"alloc_bytes\":" << record.alloc_bytes << (record.pc >= 0 ? "," : "");
+                }
+                if (record.pc >= 0) {
+                    ofs << "\"pc\":" << record.pc;
+                }
+                ofs << "},";
+            }
+            ofs << "\"ph\":\"X\"";
+            ofs << "}";
         }
-        ofs << "\"ph\":\"X\"";
-        ofs << "}";
     }
     ofs << "]\n";
 }
@@ -1,44 +1,69 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace chainer_compiler {
 namespace runtime {
 
+// Records events into a ring buffer per thread and formats them as
+// Chrome tracing JSON in `Emit`. A buffer grows on demand until it
+// has `buffer_size` events, after which recording an event does not
+// allocate memory once its names have been seen by the thread.
 class ChromeTracingEmitter {
 public:
-    struct Event {
-        Event(const std::string& c, const std::string& n, int p);
-        void Finish();
-        std::string category;
-        std::string name;
-        int pc;
-        std::chrono::system_clock::time_point start_time;
-        std::chrono::system_clock::time_point end_time;
-    };
-
     class ScopedEvent {
     public:
         explicit ScopedEvent(ChromeTracingEmitter* chrome_tracing, const std::string& category, const std::string& name, int pc = -1);
         ~ScopedEvent();
 
     private:
-        Event* event_;
+        ChromeTracingEmitter* chrome_tracing_;
+        int category_id_;
+        int name_id_;
+        int pc_;
+        std::chrono::steady_clock::time_point start_time_;
+        int64_t start_allocated_bytes_;
     };
 
-    ChromeTracingEmitter();
-
-    // Takes the ownership of `event`.
-    void AddEvent(Event* event);
+    // Each thread keeps the last `buffer_size` events.
+    explicit ChromeTracingEmitter(size_t buffer_size = 1 << 16);
+    ~ChromeTracingEmitter();
 
+    // This must not be called while events are being recorded.
     void Emit(const std::string& output_filename) const;
 
 private:
-    std::vector<std::unique_ptr<Event>> events_;
-    std::chrono::system_clock::time_point base_time_;
+    struct Record {
+        int32_t category_id;
+        int32_t name_id;
+        int32_t pc;
+        int64_t start_ns;
+        int64_t end_ns;
+        // Native memory allocated by the thread during the event.
+        int64_t alloc_bytes;
+    };
+
+    struct ThreadBuffer;
+
+    ThreadBuffer* GetThreadBuffer();
+    int Intern(ThreadBuffer* buffer, const std::string& name);
+    void AddRecord(const Record& record);
+
+    const size_t buffer_size_;
+    // Distinguishes emitters in thread local caches.
+    const int64_t id_;
+    const std::chrono::steady_clock::time_point base_time_;
+
+    mutable std::mutex mu_;
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, int> name_ids_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
 };
 
 }  // namespace runtime
@@ -0,0 +1,57 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <runtime/chrome_tracing.h>
+
+namespace chainer_compiler {
+namespace runtime {
+namespace {
+
+int CountSubstr(const std::string& str, const std::string& pattern) {
+    int count = 0;
+    for (size_t pos = str.find(pattern); pos != std::string::npos; pos = str.find(pattern, pos + 1)) ++count;
+    return count;
+}
+
+std::string ReadFile(const std::string& filename) {
+    std::ifstream ifs(filename);
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    return oss.str();
+}
+
+TEST(ChromeTracingTest, KeepsLastEventsOfEachThread) {
+    ChromeTracingEmitter chrome_tracing(100);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&chrome_tracing]() {
+            for (int pc = 0; pc < 150; ++pc) {
+                ChromeTracingEmitter::ScopedEvent se(&chrome_tracing, "XCVM", pc % 2 ? "Add" : "Mul", pc);
+            }
+        });
+    }
+    for (std::thread& th : threads) th.join();
+
+    const std::string filename = "/tmp/chrome_tracing_test.json";
+    chrome_tracing.Emit(filename);
+    const std::string json = ReadFile(filename);
+    std::remove(filename.c_str());
+    EXPECT_EQ(400, CountSubstr(json, "\"ph\":\"X\""));
+    EXPECT_EQ(0, CountSubstr(json, "\"pc\":49}"));
+    EXPECT_EQ(4, CountSubstr(json, "\"pc\":50}"));
+    EXPECT_EQ(4, CountSubstr(json, "\"pc\":149}"));
+    for (int tid = 1; tid <= 4; ++tid) {
+        EXPECT_EQ(100, CountSubstr(json, "\"tid\":" + std::to_string(tid) + ",")) << tid;
+    }
+    EXPECT_EQ(200, CountSubstr(json, "\"name\":\"Add\""));
+}
+
+}  // namespace
+}  // namespace runtime
+}  // namespace chainer_compiler
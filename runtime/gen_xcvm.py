@@ -80,6 +80,7 @@ def gen_gen_xcvm_ops_h():
             rettype = 'void'
         lines.append('%s RunImpl(%s);' % (rettype, ', '.join(args)))
         lines.append('virtual void Run(XCVMState* st);')
+        lines.append('virtual void RunFast(XCVMState* st);')
 
         lines.append('private:')
         for inp in op.inputs:
@@ -123,6 +124,82 @@ namespace runtime {
 ''')
 
 
+def gen_run_body(op, trace_line, fast):
+    """Emits the part of Run/RunFast which fetches inputs and calls RunImpl.
+
+    When `fast` is True, the emitted code uses unchecked accessors of
+    XCVMState and does not output traces.
+    """
+    lines = []
+    if not op.typed:
+        lines.append('RunImpl(st);')
+        return lines
+
+    get_var = 'GetVarUnchecked' if fast else 'GetVar'
+    get_array = 'GetArrayUnchecked' if fast else 'GetArray'
+
+    args = ['st']
+
+    # TODO(hamaji): Remove this code by removing null gradients.
+    conds = []
+    for typ, name in op.inputs:
+        if typ in ARG_TYPES and typ != ARRAY_LIST:
+            conds.append('(%s >= 0 && st->%s(%s)->IsNull())' %
+                         (name, get_var, name))
+    if conds:
+        lines.append('if (%s) {' % (' || '.join(conds)))
+        lines.append('WARN_ONCE("%s skipped\\n");' % op.name)
+        for typ, oname in op.outputs:
+            if typ in ARG_TYPES and typ != ARRAY_LIST:
+                lines.append('st->SetVar(%s, XCVMVar());' % oname)
+        lines.append('return;')
+        lines.append('}')
+
+    for typ, name in op.inputs:
+        if typ == ARRAY:
+            args.append('st->%s(%s)' % (get_array, name))
+        elif typ == OPTIONAL_ARRAY:
+            args.append('st->GetOptionalArray(%s)' % name)
+        elif typ == ARRAY_LIST:
+            args.append('st->GetArrayList(%s)' % name)
+        elif typ == SEQUENCE:
+            args.append('*st->GetSequence(%s)' % name)
+        elif typ == OPAQUE:
+            args.append('st->GetOpaque(%s)' % name)
+
+    outputs = []
+    for output in op.outputs:
+        typ, name = output
+        if typ == SEQUENCE:
+            args.append('st->CreateSequence(%s)' % name)
+        else:
+            outputs.append(output)
+
+    call = 'RunImpl(%s)' % ', '.join(args)
+    if len(outputs) == 1:
+        typ, name = outputs[0]
+        if typ == ARRAY_LIST:
+            lines.append('st->SetArrayList(%s, %s);' % (name, call))
+        elif typ == OPAQUE:
+            lines.append('st->SetOpaque(%s, %s);' % (name, call))
+        else:
+            lines.append('st->SetArray(%s, %s);' % (name, call))
+    elif outputs:
+        lines.append('auto r_ = ' + call + ';')
+        for i, (typ, output) in enumerate(outputs):
+            # TODO(hamaji): Revisit optional outputs.
+            if typ == OPAQUE:
+                lines.append('if (%s >= 0) st->SetOpaque(%s, std::get<%d>(r_));' % (output, output, i))
+                lines.append('else delete std::get<%d>(r_);' % i)
+            else:
+                lines.append('if (%s >= 0) st->SetArray(%s, std::get<%d>(r_));' % (output, output, i))
+            if not fast:
+                lines.append(trace_line)
+    else:
+        lines.append(call + ';')
+    return lines
+
+
 def gen_gen_xcvm_ops_cc():
     lines = []
 
@@ -207,67 +284,7 @@ def gen_gen_xcvm_ops_cc():
             line += ';'
             lines.append(line)
 
-        if op.typed:
-            args = ['st']
-
-            # TODO(hamaji): Remove this code by removing null gradients.
-            conds = []
-            for typ, name in op.inputs:
-                if typ in ARG_TYPES and typ != ARRAY_LIST:
-                    conds.append('(%s >= 0 && st->GetVar(%s)->IsNull())' %
-                                 (name, name))
-            if conds:
-                lines.append('if (%s) {' % (' || '.join(conds)))
-                lines.append('WARN_ONCE("%s skipped\\n");' % op.name)
-                for typ, oname in op.outputs:
-                    if typ in ARG_TYPES and typ != ARRAY_LIST:
-                        lines.append('st->SetVar(%s, XCVMVar());' % oname)
-                lines.append('return;')
-                lines.append('}')
-
-            for typ, name in op.inputs:
-                if typ == ARRAY:
-                    args.append('st->GetArray(%s)' % name)
-                elif typ == OPTIONAL_ARRAY:
-                    args.append('st->GetOptionalArray(%s)' % name)
-                elif typ == ARRAY_LIST:
-                    args.append('st->GetArrayList(%s)' % name)
-                elif typ == SEQUENCE:
-                    args.append('*st->GetSequence(%s)' % name)
-                elif typ == OPAQUE:
-                    args.append('st->GetOpaque(%s)' % name)
-
-            outputs = []
-            for output in op.outputs:
-                typ, name = output
-                if typ == SEQUENCE:
-                    args.append('st->CreateSequence(%s)' % name)
-                else:
-                    outputs.append(output)
-
-            call = 'RunImpl(%s)' % ', '.join(args)
-            if len(outputs) == 1:
-                typ, name = outputs[0]
-                if typ == ARRAY_LIST:
-                    lines.append('st->SetArrayList(%s, %s);' % (name, call))
-                elif typ == OPAQUE:
-                    lines.append('st->SetOpaque(%s, %s);' % (name, call))
-                else:
-                    lines.append('st->SetArray(%s, %s);' % (name, call))
-            elif outputs:
-                lines.append('auto r_ = ' + call + ';')
-                for i, (typ, output) in enumerate(outputs):
-                    # TODO(hamaji): Revisit optional outputs.
-                    if typ == OPAQUE:
-                        lines.append('if (%s >= 0) st->SetOpaque(%s, std::get<%d>(r_));' % (output, output, i))
-                        lines.append('else delete std::get<%d>(r_);' % i)
-                    else:
-                        lines.append('if (%s >= 0) st->SetArray(%s, std::get<%d>(r_));' % (output, output, i))
-                    lines.append(line)
-            else:
-                lines.append(call + ';')
-        else:
-            lines.append('RunImpl(st);')
+        lines += gen_run_body(op, line, fast=False)
 
         line = 'if (st->trace_level()) std::cerr'
         for typ, name in op.outputs:
@@ -292,6 +309,11 @@ def gen_gen_xcvm_ops_cc():
 
         lines.append('}')
 
+        # Emit RunFast, which is used by the release mode of XCVM.
+        lines.append('void %sOp::RunFast(XCVMState* st) {' % op.name)
+        lines += gen_run_body(op, None, fast=True)
+        lines.append('}')
+
     lines.append('XCVMOp* MakeXCVMOp(const XCInstructionProto& inst) {')
     lines.append('switch (inst.op()) {')
     for op in XC_ALL_OPS:
@@ -1,5 +1,7 @@
 #include "runtime/meminfo.h"
 
+#include <atomic>
+
 #ifdef CHAINER_COMPILER_ENABLE_CUDA
 #include <cuda_runtime.h>
 #endif  // CHAINER_COMPILER_ENABLE_CUDA
@@ -9,17 +11,64 @@ namespace runtime {
 
 bool g_meminfo_enabled = false;
 
+namespace {
+
+// These are constant-initialized, so they can be updated by
+// allocations during static initialization.
+std::atomic<bool> g_native_memory_stats_enabled{false};
+std::atomic<int64_t> g_current_bytes{0};
+std::atomic<int64_t> g_peak_bytes{0};
+std::atomic<int64_t> g_num_allocations{0};
+thread_local int64_t g_thread_allocated_bytes = 0;
+
+}  // namespace
+
 int64_t GetMemoryUsageInBytes() {
 #ifdef CHAINER_COMPILER_ENABLE_CUDA
-    if (!g_meminfo_enabled) return -1;
-    size_t bytes;
-    if (cudaMemGetInfo(&bytes, nullptr) != cudaSuccess) {
-        return -1;
+    if (g_meminfo_enabled) {
+        size_t free_bytes, total_bytes;
+        if (cudaMemGetInfo(&free_bytes, &total_bytes) != cudaSuccess) {
+            return -1;
+        }
+        return total_bytes - free_bytes;
     }
-    return bytes;
-#else
-    return -1;
 #endif  // CHAINER_COMPILER_ENABLE_CUDA
+    NativeMemoryStats stats;
+    if (GetNativeMemoryStats(&stats)) return stats.current_bytes;
+    return -1;
+}
+
+bool GetNativeMemoryStats(NativeMemoryStats* stats) {
+    if (!g_native_memory_stats_enabled) return false;
+    stats->current_bytes = g_current_bytes;
+    stats->peak_bytes = g_peak_bytes;
+    stats->num_allocations = g_num_allocations;
+    return true;
+}
+
+void ResetNativePeakMemory() {
+    g_peak_bytes = g_current_bytes.load();
+}
+
+int64_t GetThreadAllocatedBytes() {
+    return g_thread_allocated_bytes;
+}
+
+void EnableNativeMemoryStats() {
+    g_native_memory_stats_enabled = true;
+}
+
+void RecordNativeAllocation(size_t size) {
+    const int64_t current = g_current_bytes += size;
+    int64_t peak = g_peak_bytes.load();
+    while (peak < current && !g_peak_bytes.compare_exchange_weak(peak, current)) {
+    }
+    ++g_num_allocations;
+    g_thread_allocated_bytes += size;
+}
+
+void RecordNativeDeallocation(size_t size) {
+    g_current_bytes -= size;
 }
 
 }  // namespace runtime
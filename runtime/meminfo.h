@@ -1,14 +1,42 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace chainer_compiler {
 namespace runtime {
 
+// Uses the memory info of the CUDA device instead of the host.
 extern bool g_meminfo_enabled;
 
-// Returns -1 when info is not implemented.
+// Returns the number of bytes in use on the CUDA device when
+// `g_meminfo_enabled` is set, or bytes allocated for native arrays
+// otherwise. Returns -1 when info is not implemented.
 int64_t GetMemoryUsageInBytes();
 
+struct NativeMemoryStats {
+    int64_t current_bytes;
+    int64_t peak_bytes;
+    int64_t num_allocations;
+};
+
+// Host memory allocated by array new, which ChainerX's native device
+// uses for array data. Returns false unless the executable links
+// native_memory_tracker.cc (see CHAINER_COMPILER_TRACK_NATIVE_MEMORY).
+bool GetNativeMemoryStats(NativeMemoryStats* stats);
+
+// Makes the current usage the new peak.
+void ResetNativePeakMemory();
+
+// The total bytes of native memory allocated by the calling thread.
+// Never decreases, so the difference of two calls is the amount
+// allocated between them, e.g., by an XCVM instruction.
+int64_t GetThreadAllocatedBytes();
+
+// Used by the array new/delete in native_memory_tracker.cc.
+void EnableNativeMemoryStats();
+void RecordNativeAllocation(size_t size);
+void RecordNativeDeallocation(size_t size);
+
 }  // namespace runtime
 }  // namespace chainer_compiler
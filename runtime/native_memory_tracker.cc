@@ -0,0 +1,65 @@
+#include <cstdlib>
+#include <new>
+
+#include <runtime/meminfo.h>
+
+// Replaces the global array new/delete to count host memory used by
+// ChainerX's native device, which allocates array data by
+// `new uint8_t[]`. Other array allocations are counted, too, but they
+// are rare and small compared to arrays.
+//
+// This must be linked only into executables. A shared library such
+// as a Python module must not replace the allocator of its host
+// process, where memory may be freed by code which does not know the
+// header added here.
+
+namespace chainer_compiler {
+namespace runtime {
+namespace {
+
+// The size of each allocation is stored in front of it. This keeps
+// the alignment of `std::max_align_t`.
+const size_t kHeaderSize = 16;
+
+void* Allocate(size_t size) noexcept {
+    char* base = static_cast<char*>(std::malloc(size + kHeaderSize));
+    if (!base) return nullptr;
+    *reinterpret_cast<size_t*>(base) = size;
+    RecordNativeAllocation(size);
+    return base + kHeaderSize;
+}
+
+void Deallocate(void* ptr) noexcept {
+    if (!ptr) return;
+    char* base = static_cast<char*>(ptr) - kHeaderSize;
+    RecordNativeDeallocation(*reinterpret_cast<size_t*>(base));
+    std::free(base);
+}
+
+const bool g_native_memory_tracked = (EnableNativeMemoryStats(), true);
+
+}  // namespace
+}  // namespace runtime
+}  // namespace chainer_compiler
+
+void* operator new[](size_t size) {
+    void* ptr = chainer_compiler::runtime::Allocate(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return chainer_compiler::runtime::Allocate(size);
+}
+
+void operator delete[](void* ptr) noexcept {
+    chainer_compiler::runtime::Deallocate(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    chainer_compiler::runtime::Deallocate(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    chainer_compiler::runtime::Deallocate(ptr);
+}
@@ -8,6 +8,10 @@ namespace chainer_compiler {
 namespace runtime {
 
 chainerx::Array ReluOp::RunImpl(XCVMState* st, const chainerx::Array& x) {
+    if (nonstd::optional<chainerx::Array> out = st->GetOutputBuffer(inst_, {&x}, x.shape(), x.dtype(), x.device())) {
+        x.device().IfLessElseASSA(x, 0, chainerx::Scalar{0, x.dtype()}, x, *out);
+        return *out;
+    }
     return chainerx::Maximum(x, 0);
 }
 
@@ -36,6 +40,10 @@ chainerx::Array EluOp::RunImpl(XCVMState* st, const chainerx::Array& x) {
 }
 
 chainerx::Array TanhOp::RunImpl(XCVMState* st, const chainerx::Array& a) {
+    if (nonstd::optional<chainerx::Array> out = st->GetOutputBuffer(inst_, {&a}, a.shape(), a.dtype(), a.device())) {
+        a.device().Tanh(a, *out);
+        return *out;
+    }
     return chainerx::Tanh(a);
 }
 
@@ -1,14 +1,44 @@
+#include <chainerx/backprop_mode.h>
+#include <chainerx/context.h>
+#include <chainerx/native/native_device.h>
 #include <chainerx/routines/connection.h>
 #include <chainerx/routines/linalg.h>
 #include <chainerx/routines/manipulation.h>
+#include <chainerx/routines/math.h>
 
 #include <common/log.h>
 #include <runtime/chainerx_util.h>
 #include <runtime/gen_xcvm_ops.h>
+#include <runtime/xcvm_state.h>
 
 namespace chainer_compiler {
 namespace runtime {
 
+namespace {
+
+// Adds `residual` to `y` and applies Relu in a single pass.
+template <typename T>
+void RunConvEpilogue(chainerx::Array* y, const nonstd::optional<chainerx::Array>& residual, bool relu) {
+    T* py = reinterpret_cast<T*>(static_cast<char*>(y->raw_data()) + y->offset());
+    const T* pr = residual ? reinterpret_cast<const T*>(static_cast<const char*>(residual->raw_data()) + residual->offset()) : nullptr;
+    const int64_t size = y->GetTotalSize();
+    for (int64_t i = 0; i < size; ++i) {
+        T v = py[i];
+        if (pr) v += pr[i];
+        py[i] = (relu && v < 0) ? 0 : v;
+    }
+}
+
+bool CanRunConvEpilogueInPlace(const chainerx::Array& y, const nonstd::optional<chainerx::Array>& residual) {
+    if (!dynamic_cast<const chainerx::native::NativeDevice*>(&y.device()) || !y.IsContiguous()) return false;
+    if (y.dtype() != chainerx::Dtype::kFloat32 && y.dtype() != chainerx::Dtype::kFloat64) return false;
+    if (!residual) return true;
+    return &residual->device() == &y.device() && residual->IsContiguous() && residual->shape() == y.shape() &&
+           residual->dtype() == y.dtype();
+}
+
+}  // namespace
+
 chainerx::Array LinearOp::RunImpl(
         XCVMState* st, const chainerx::Array& x, const chainerx::Array& w, const nonstd::optional<chainerx::Array>& b) {
     return chainerx::Linear(x, w, b, n_batch_axes);
@@ -26,6 +56,30 @@ chainerx::Array ConvOp::RunImpl(
     return chainerx::Conv(x, w, b, ComplementStride(strides, x), ComplementPad(pads, x));
 }
 
+chainerx::Array FusedConvOp::RunImpl(
+        XCVMState* st,
+        const chainerx::Array& x,
+        const chainerx::Array& w,
+        const nonstd::optional<chainerx::Array>& b,
+        const nonstd::optional<chainerx::Array>& residual) {
+    chainerx::Array y = chainerx::Conv(x, w, b, ComplementStride(strides, x), ComplementPad(pads, x));
+    // `y` is not shared yet, so the epilogue can overwrite it while
+    // it is likely still in cache. Autograd needs the ChainerX ops to
+    // record the residual and the Relu mask.
+    const bool backprop = st->is_training() || chainerx::IsBackpropRequired(chainerx::GetDefaultContext());
+    if (!backprop && CanRunConvEpilogueInPlace(y, residual)) {
+        if (y.dtype() == chainerx::Dtype::kFloat32) {
+            RunConvEpilogue<float>(&y, residual, relu);
+        } else {
+            RunConvEpilogue<double>(&y, residual, relu);
+        }
+        return y;
+    }
+    if (residual) y = y + *residual;
+    if (relu) y = chainerx::Maximum(y, 0);
+    return y;
+}
+
 chainerx::Array ConvTransposeOp::RunImpl(
         XCVMState* st, const chainerx::Array& x, const chainerx::Array& w, const nonstd::optional<chainerx::Array>& b) {
     nonstd::optional<chainerx::StackVector<int64_t, chainerx::kMaxNdim>> out_size = nonstd::nullopt;
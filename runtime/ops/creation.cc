@@ -31,6 +31,13 @@ chainerx::Array FloatConstantOp::RunImpl(XCVMState* st) {
     return a.AsType(static_cast<chainerx::Dtype>(dtype));
 }
 
+chainerx::Array BinaryConstantOp::RunImpl(XCVMState* st) {
+    chainerx::Array a = st->GetConstant(offset, chainerx::Shape(shape), static_cast<chainerx::Dtype>(dtype));
+    if (host) return a;
+    // No copy is made when the default device is native.
+    return a.ToDevice(chainerx::GetDefaultDevice());
+}
+
 chainerx::Array OneHotOp::RunImpl(
         XCVMState* st, const chainerx::Array& indices, const chainerx::Array& depth, const chainerx::Array& values) {
     int rank = indices.ndim();
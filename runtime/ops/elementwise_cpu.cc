@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <chainerx/array.h>
+#include <chainerx/native/native_device.h>
+#include <chainerx/routines/creation.h>
+#include <chainerx/routines/math.h>
+#include <chainerx/routines/statistics.h>
+#include <chainerx/shape.h>
+
+#include <common/log.h>
+#include <runtime/chainerx_util.h>
+#include <runtime/gen_xcvm_ops.h>
+#include <runtime/xcvm.pb.h>
+
+namespace chainer_compiler {
+namespace runtime {
+
+namespace {
+
+// The number of elements evaluated at once. Registers of a chunk are
+// small enough to stay in L1 cache.
+const int64_t kChunkSize = 256;
+
+struct Instruction {
+    XCInstructionProto::Op op;
+    int64_t y;
+    int64_t a;
+    int64_t b;
+};
+
+bool IsReduction(XCInstructionProto::Op op) {
+    return op == XCInstructionProto::ReduceSum || op == XCInstructionProto::ReduceMean;
+}
+
+template <typename T>
+void RunInstruction(const Instruction& inst, T* const* regs, int64_t n) {
+    T* y = regs[inst.y];
+    const T* a = regs[inst.a];
+    const T* b = inst.b >= 0 ? regs[inst.b] : nullptr;
+    switch (inst.op) {
+        case XCInstructionProto::Identity:
+            std::copy(a, a + n, y);
+            break;
+        case XCInstructionProto::Add:
+            for (int64_t i = 0; i < n; ++i) y[i] = a[i] + b[i];
+            break;
+        case XCInstructionProto::Sub:
+            for (int64_t i = 0; i < n; ++i) y[i] = a[i] - b[i];
+            break;
+        case XCInstructionProto::Mul:
+            for (int64_t i = 0; i < n; ++i) y[i] = a[i] * b[i];
+            break;
+        case XCInstructionProto::Div:
+            for (int64_t i = 0; i < n; ++i) y[i] = a[i] / b[i];
+            break;
+        case XCInstructionProto::Pow:
+            // The same formula as the unfused Pow op.
+            for (int64_t i = 0; i < n; ++i) y[i] = std::exp(std::log(a[i]) * b[i]);
+            break;
+        case XCInstructionProto::Neg:
+            for (int64_t i = 0; i < n; ++i) y[i] = -a[i];
+            break;
+        case XCInstructionProto::Relu:
+            for (int64_t i = 0; i < n; ++i) y[i] = a[i] > 0 ? a[i] : 0;
+            break;
+        case XCInstructionProto::LeakyRelu: {
+            const T alpha = b[0];
+            for (int64_t i = 0; i < n; ++i) y[i] = a[i] > 0 ? a[i] : a[i] * alpha;
+            break;
+        }
+        case XCInstructionProto::Elu: {
+            const T alpha = b[0];
+            for (int64_t i = 0; i < n; ++i) y[i] = a[i] > 0 ? a[i] : alpha * (std::exp(a[i]) - 1);
+            break;
+        }
+        case XCInstructionProto::Clip: {
+            const T min = b[0];
+            const T max = regs[inst.b + 1][0];
+            for (int64_t i = 0; i < n; ++i) y[i] = std::min(std::max(a[i], min), max);
+            break;
+        }
+        case XCInstructionProto::Tanh:
+            for (int64_t i = 0; i < n; ++i) y[i] = std::tanh(a[i]);
+            break;
+        case XCInstructionProto::Sigmoid:
+            for (int64_t i = 0; i < n; ++i) y[i] = std::tanh(a[i] * T(0.5)) * T(0.5) + T(0.5);
+            break;
+        case XCInstructionProto::Exp:
+            for (int64_t i = 0; i < n; ++i) y[i] = std::exp(a[i]);
+            break;
+        case XCInstructionProto::Log:
+            for (int64_t i = 0; i < n; ++i) y[i] = std::log(a[i]);
+            break;
+        case XCInstructionProto::Sqrt:
+            for (int64_t i = 0; i < n; ++i) y[i] = std::sqrt(a[i]);
+            break;
+        default:
+            CHECK(false) << "Unsupported op in ElementWiseCpu: " << XCInstructionProto::Op_Name(inst.op);
+    }
+}
+
+chainerx::Array RunGenericInstruction(const Instruction& inst, const std::vector<chainerx::Array>& regs) {
+    const chainerx::Array& a = regs[inst.a];
+    auto select_negative = [&a](const chainerx::Array& negative) {
+        chainerx::Array negs = (a < chainerx::Zeros({}, a.dtype(), a.device())).AsType(a.dtype());
+        return a * (1 - negs) + negative * negs;
+    };
+    switch (inst.op) {
+        case XCInstructionProto::Identity:
+            return a;
+        case XCInstructionProto::Add:
+            return a + regs[inst.b];
+        case XCInstructionProto::Sub:
+            return a - regs[inst.b];
+        case XCInstructionProto::Mul:
+            return a * regs[inst.b];
+        case XCInstructionProto::Div:
+            return a / regs[inst.b];
+        case XCInstructionProto::Pow:
+            return chainerx::Exp(chainerx::Log(a) * regs[inst.b]);
+        case XCInstructionProto::Neg:
+            return -a;
+        case XCInstructionProto::Relu:
+            return chainerx::Maximum(a, 0);
+        case XCInstructionProto::LeakyRelu:
+            return select_negative(a * regs[inst.b]);
+        case XCInstructionProto::Elu:
+            return select_negative(regs[inst.b] * (chainerx::Exp(a) - 1));
+        case XCInstructionProto::Clip:
+            return -chainerx::Maximum(-chainerx::Maximum(a, regs[inst.b]), -regs[inst.b + 1]);
+        case XCInstructionProto::Tanh:
+            return chainerx::Tanh(a);
+        case XCInstructionProto::Sigmoid:
+            return Sigmoid(a);
+        case XCInstructionProto::Exp:
+            return chainerx::Exp(a);
+        case XCInstructionProto::Log:
+            return chainerx::Log(a);
+        case XCInstructionProto::Sqrt:
+            return chainerx::Sqrt(a);
+        case XCInstructionProto::ReduceSum:
+        case XCInstructionProto::ReduceMean: {
+            Int64StackVector axes;
+            for (int64_t i = a.ndim() - inst.b; i < a.ndim(); ++i) axes.push_back(i);
+            if (inst.op == XCInstructionProto::ReduceSum) return chainerx::Sum(a, GetChainerXAxes(axes), true);
+            return chainerx::Mean(a, GetChainerXAxes(axes), true);
+        }
+        default:
+            CHECK(false) << "Unsupported op in ElementWiseCpu: " << XCInstructionProto::Op_Name(inst.op);
+    }
+    return a;
+}
+
+// Returns the shape of the output of `reduction` which reduces `shape`.
+chainerx::Shape GetReducedShape(const Instruction* reduction, const chainerx::Shape& shape) {
+    if (!reduction) return shape;
+    chainerx::Shape reduced = shape;
+    for (int64_t i = shape.ndim() - reduction->b; i < shape.ndim(); ++i) reduced[i] = 1;
+    return reduced;
+}
+
+// An input of ElementWiseCpu broadcasted to `shape` is read as
+// `data[(i / inner) % size]` if its dimensions which are not one are
+// consecutive, e.g., biases and scales. Returns false otherwise.
+bool GetBroadcastStrides(const chainerx::Shape& input_shape, const chainerx::Shape& shape, int64_t* inner, int64_t* size) {
+    const int64_t offset = shape.ndim() - input_shape.ndim();
+    int64_t lo = -1;
+    int64_t hi = -1;
+    for (int64_t i = 0; i < shape.ndim(); ++i) {
+        const int64_t dim = i < offset ? 1 : input_shape[i - offset];
+        if (dim == 1) continue;
+        if (lo < 0) lo = i;
+        hi = i + 1;
+    }
+    *inner = 1;
+    *size = 1;
+    for (int64_t i = std::max<int64_t>(lo, 0); i < shape.ndim(); ++i) {
+        if (i < hi) {
+            if (i - offset < 0 || input_shape[i - offset] != shape[i]) return false;
+            *size *= shape[i];
+        } else {
+            *inner *= shape[i];
+        }
+    }
+    return true;
+}
+
+template <typename T>
+std::vector<chainerx::Array> RunNative(
+        const std::vector<Instruction>& instructions,
+        int64_t num_regs,
+        const std::vector<double>& constants,
+        const std::vector<int64_t>& output_regs,
+        const std::vector<chainerx::Array>& orig_inputs,
+        const chainerx::Shape& shape) {
+    const int64_t size = shape.GetTotalSize();
+    const int64_t first_temp = orig_inputs.size() + constants.size();
+    const Instruction* reduction = IsReduction(instructions.back().op) ? &instructions.back() : nullptr;
+    const size_t num_elementwise = instructions.size() - (reduction ? 1 : 0);
+
+    // Scalars, constants, gathered inputs, and temporary values live
+    // in `buf`. Other inputs and outputs are accessed directly.
+    std::vector<T> buf(num_regs * kChunkSize);
+    std::vector<T*> regs(num_regs);
+    std::vector<T*> direct(num_regs);
+    struct Gather {
+        int64_t reg;
+        const T* data;
+        int64_t inner;
+        int64_t size;
+    };
+    std::vector<Gather> gathers;
+    std::vector<chainerx::Array> inputs;
+    for (size_t i = 0; i < orig_inputs.size(); ++i) {
+        chainerx::Array input = orig_inputs[i];
+        if (input.GetTotalSize() == 1) {
+            std::fill_n(&buf[i * kChunkSize], kChunkSize, static_cast<T>(static_cast<double>(chainerx::AsScalar(input))));
+            continue;
+        }
+        int64_t inner, input_size;
+        if (!GetBroadcastStrides(input.shape(), shape, &inner, &input_size)) {
+            input = input.BroadcastTo(shape);
+            inner = 1;
+            input_size = size;
+        }
+        if (!input.IsContiguous()) input = chainerx::Copy(input);
+        T* data = reinterpret_cast<T*>(static_cast<char*>(input.raw_data()) + input.offset());
+        if (input_size == size) {
+            direct[i] = data;
+        } else {
+            gathers.push_back(Gather{static_cast<int64_t>(i), data, inner, input_size});
+        }
+        inputs.push_back(input);
+    }
+    for (size_t i = 0; i < constants.size(); ++i) {
+        std::fill_n(&buf[(orig_inputs.size() + i) * kChunkSize], kChunkSize, static_cast<T>(constants[i]));
+    }
+
+    std::vector<chainerx::Array> outputs;
+    std::vector<T*> output_ptrs;
+    for (int64_t reg : output_regs) {
+        const bool is_reduced = reduction && reg == reduction->y;
+        outputs.push_back(chainerx::Empty(
+                is_reduced ? GetReducedShape(reduction, shape) : shape, orig_inputs[0].dtype(), orig_inputs[0].device()));
+        output_ptrs.push_back(static_cast<T*>(outputs.back().raw_data()));
+        // Temporary values are computed in the output buffer.
+        if (!is_reduced && reg >= first_temp && !direct[reg]) direct[reg] = output_ptrs.back();
+    }
+
+    int64_t reduce_inner = 1;
+    for (int64_t i = shape.ndim() - (reduction ? reduction->b : 0); i < shape.ndim(); ++i) reduce_inner *= shape[i];
+    std::vector<double> sums(reduction ? GetReducedShape(reduction, shape).GetTotalSize() : 0);
+
+    for (int64_t base = 0; base < size; base += kChunkSize) {
+        const int64_t n = std::min(kChunkSize, size - base);
+        for (int64_t r = 0; r < num_regs; ++r) {
+            regs[r] = direct[r] ? direct[r] + base : &buf[r * kChunkSize];
+        }
+        for (const Gather& g : gathers) {
+            T* dst = regs[g.reg];
+            for (int64_t i = 0; i < n; ++i) dst[i] = g.data[((base + i) / g.inner) % g.size];
+        }
+        for (size_t i = 0; i < num_elementwise; ++i) {
+            RunInstruction(instructions[i], regs.data(), n);
+        }
+        if (reduction) {
+            const T* a = regs[reduction->a];
+            for (int64_t i = 0; i < n; ++i) sums[(base + i) / reduce_inner] += a[i];
+        }
+        for (size_t i = 0; i < output_regs.size(); ++i) {
+            if (reduction && output_regs[i] == reduction->y) continue;
+            T* out = output_ptrs[i] + base;
+            if (regs[output_regs[i]] != out) std::copy(regs[output_regs[i]], regs[output_regs[i]] + n, out);
+        }
+    }
+
+    for (size_t i = 0; i < output_regs.size(); ++i) {
+        if (!reduction || output_regs[i] != reduction->y) continue;
+        const double scale = reduction->op == XCInstructionProto::ReduceMean ? 1.0 / reduce_inner : 1.0;
+        for (size_t j = 0; j < sums.size(); ++j) output_ptrs[i][j] = static_cast<T>(sums[j] * scale);
+    }
+    return outputs;
+}
+
+}  // namespace
+
+class ElementWiseCpuOp::ElementWiseCpuImpl {
+public:
+    std::vector<Instruction> instructions;
+    int64_t num_regs;
+};
+
+void ElementWiseCpuOp::InitImpl() {
+    // The program is decoded once per instruction so runs only
+    // dispatch on ops.
+    impl_ = new ElementWiseCpuImpl();
+    CHECK(!program.empty());
+    CHECK_EQ(0, program.size() % 4);
+    for (size_t i = 0; i < program.size(); i += 4) {
+        impl_->instructions.push_back(
+                Instruction{static_cast<XCInstructionProto::Op>(program[i]), program[i + 1], program[i + 2], program[i + 3]});
+    }
+    impl_->num_regs = inputs.size() + constants.size() + impl_->instructions.size();
+    for (int64_t reg : output_regs) CHECK_LT(reg, impl_->num_regs);
+    for (size_t i = 0; i + 1 < impl_->instructions.size(); ++i) {
+        CHECK(!IsReduction(impl_->instructions[i].op)) << "Reduction must be the last instruction";
+    }
+}
+
+ElementWiseCpuOp::~ElementWiseCpuOp() {
+    delete impl_;
+}
+
+std::vector<chainerx::Array> ElementWiseCpuOp::RunImpl(XCVMState* st, const std::vector<chainerx::Array>& orig_inputs) {
+    CHECK(!orig_inputs.empty());
+    const chainerx::Dtype dtype = orig_inputs[0].dtype();
+    const chainerx::Device& device = orig_inputs[0].device();
+    chainerx::Shape shape = orig_inputs[0].shape();
+    bool is_native = dynamic_cast<const chainerx::native::NativeDevice*>(&device) &&
+                     (dtype == chainerx::Dtype::kFloat32 || dtype == chainerx::Dtype::kFloat64);
+    for (const chainerx::Array& input : orig_inputs) {
+        shape = chainerx::internal::BroadcastShapes(shape, input.shape());
+        if (input.dtype() != dtype || &input.device() != &device) is_native = false;
+    }
+
+    if (is_native) {
+        if (dtype == chainerx::Dtype::kFloat32) {
+            return RunNative<float>(impl_->instructions, impl_->num_regs, constants, output_regs, orig_inputs, shape);
+        }
+        return RunNative<double>(impl_->instructions, impl_->num_regs, constants, output_regs, orig_inputs, shape);
+    }
+
+    // Falls back to ChainerX routines for other devices and dtypes.
+    std::vector<chainerx::Array> regs(orig_inputs);
+    for (double value : constants) {
+        regs.push_back(chainerx::Full({}, value, dtype, device));
+    }
+    for (const Instruction& inst : impl_->instructions) {
+        CHECK_EQ(inst.y, regs.size());
+        regs.push_back(RunGenericInstruction(inst, regs));
+    }
+    const Instruction* reduction = IsReduction(impl_->instructions.back().op) ? &impl_->instructions.back() : nullptr;
+    std::vector<chainerx::Array> outputs;
+    for (int64_t reg : output_regs) {
+        chainerx::Array output = regs[reg];
+        const chainerx::Shape output_shape = reduction && reg == reduction->y ? GetReducedShape(reduction, shape) : shape;
+        if (output.shape() != output_shape) output = chainerx::Copy(output.BroadcastTo(output_shape));
+        outputs.push_back(output);
+    }
+    return outputs;
+}
+
+}  // namespace runtime
+}  // namespace chainer_compiler
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <chainerx/routines/creation.h>
 #include <chainerx/routines/linalg.h>
 #include <chainerx/routines/logic.h>
@@ -43,20 +45,60 @@ std::tuple<chainerx::Array, chainerx::Array> CoerceBinary(const chainerx::Array&
     return std::tie(ax, bx);
 }
 
+// Computes the shape of broadcasting `a` and `b`. Returns false if
+// they are not broadcastable.
+bool BroadcastShapes(const chainerx::Shape& a, const chainerx::Shape& b, chainerx::Shape* shape) {
+    *shape = a.size() >= b.size() ? a : b;
+    const int ndim = shape->size();
+    for (int i = 0; i < ndim; ++i) {
+        const int64_t da = i < a.size() ? a[a.size() - 1 - i] : 1;
+        const int64_t db = i < b.size() ? b[b.size() - 1 - i] : 1;
+        if (da != db && da != 1 && db != 1) return false;
+        (*shape)[ndim - 1 - i] = da == 1 ? db : da;
+    }
+    return true;
+}
+
+typedef void (chainerx::Device::*UnaryKernel)(const chainerx::Array&, const chainerx::Array&);
+typedef void (chainerx::Device::*BinaryKernel)(const chainerx::Array&, const chainerx::Array&, const chainerx::Array&);
+
+// Runs `kernel` without allocating the output when the arena or a
+// dying input is available for it.
+nonstd::optional<chainerx::Array> RunUnaryKernel(
+        XCVMState* st, const XCInstructionProto& inst, UnaryKernel kernel, const chainerx::Array& a) {
+    nonstd::optional<chainerx::Array> out = st->GetOutputBuffer(inst, {&a}, a.shape(), a.dtype(), a.device());
+    if (out.has_value()) (out->device().*kernel)(a, *out);
+    return out;
+}
+
+nonstd::optional<chainerx::Array> RunBinaryKernel(
+        XCVMState* st, const XCInstructionProto& inst, BinaryKernel kernel, const chainerx::Array& a, const chainerx::Array& b) {
+    chainerx::Shape shape;
+    if (a.dtype() != b.dtype() || &a.device() != &b.device() || !BroadcastShapes(a.shape(), b.shape(), &shape)) {
+        return nonstd::nullopt;
+    }
+    nonstd::optional<chainerx::Array> out = st->GetOutputBuffer(inst, {&a, &b}, shape, a.dtype(), a.device());
+    if (out.has_value()) (out->device().*kernel)(a.BroadcastTo(shape), b.BroadcastTo(shape), *out);
+    return out;
+}
+
 }  // namespace
 
 chainerx::Array AddOp::RunImpl(XCVMState* st, const chainerx::Array& a, const chainerx::Array& b) {
     auto t = CoerceBinary(a, b);
+    if (auto out = RunBinaryKernel(st, inst_, &chainerx::Device::Add, std::get<0>(t), std::get<1>(t))) return *out;
     return std::get<0>(t) + std::get<1>(t);
 }
 
 chainerx::Array SubOp::RunImpl(XCVMState* st, const chainerx::Array& a, const chainerx::Array& b) {
     auto t = CoerceBinary(a, b);
+    if (auto out = RunBinaryKernel(st, inst_, &chainerx::Device::Subtract, std::get<0>(t), std::get<1>(t))) return *out;
     return std::get<0>(t) - std::get<1>(t);
 }
 
 chainerx::Array MulOp::RunImpl(XCVMState* st, const chainerx::Array& a, const chainerx::Array& b) {
     auto t = CoerceBinary(a, b);
+    if (auto out = RunBinaryKernel(st, inst_, &chainerx::Device::Multiply, std::get<0>(t), std::get<1>(t))) return *out;
     return std::get<0>(t) * std::get<1>(t);
 }
 
@@ -67,6 +109,7 @@ chainerx::Array DivOp::RunImpl(XCVMState* st, const chainerx::Array& a0, const c
     if (&a.device() != &b.device() && b.GetTotalSize() == 1) {
         return a / chainerx::AsScalar(b);
     }
+    if (auto out = RunBinaryKernel(st, inst_, &chainerx::Device::Divide, a, b)) return *out;
     return a / b;
 }
 
@@ -80,14 +123,17 @@ chainerx::Array NegOp::RunImpl(XCVMState* st, const chainerx::Array& a) {
 }
 
 chainerx::Array ExpOp::RunImpl(XCVMState* st, const chainerx::Array& a) {
+    if (auto out = RunUnaryKernel(st, inst_, &chainerx::Device::Exp, a)) return *out;
     return chainerx::Exp(a);
 }
 
 chainerx::Array LogOp::RunImpl(XCVMState* st, const chainerx::Array& a) {
+    if (auto out = RunUnaryKernel(st, inst_, &chainerx::Device::Log, a)) return *out;
     return chainerx::Log(a);
 }
 
 chainerx::Array SqrtOp::RunImpl(XCVMState* st, const chainerx::Array& a) {
+    if (auto out = RunUnaryKernel(st, inst_, &chainerx::Device::Sqrt, a)) return *out;
     return chainerx::Sqrt(a);
 }
 
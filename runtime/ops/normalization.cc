@@ -141,7 +141,11 @@ std::tuple<chainerx::Array, XCVMOpaque*, chainerx::Array, chainerx::Array, chain
     // inference and the other is for training.
     const bool is_training = st->is_training() || this->running_mean >= 0;
     if (is_training) {
-        PreprocessBatchNormResult result = PreprocessBatchNorm(x, s, bias, mean, var, axes);
+        // The running mean and variance are updated in place, so
+        // constants shared by runs are copied.
+        chainerx::Array mean_buf = st->IsConstant(mean) ? mean.Copy() : mean;
+        chainerx::Array var_buf = st->IsConstant(var) ? var.Copy() : var;
+        PreprocessBatchNormResult result = PreprocessBatchNorm(x, s, bias, mean_buf, var_buf, axes);
         std::unique_ptr<chainerx::BatchNormForwardBackward> fb =
                 x.device().GetBatchNormForwardBackward(result.mean, result.var, epsilon, decay, result.sorted_axis);
         const Array& gamma_reshaped = result.gamma;
@@ -161,7 +165,7 @@ std::tuple<chainerx::Array, XCVMOpaque*, chainerx::Array, chainerx::Array, chain
             for (int i = 2; i < x.ndim(); ++i) axes.push_back(i);
             saved_var = chainerx::Var(x, axes);
         }
-        return std::tie(out, ctx, mean, var, saved_mean, saved_var);
+        return std::tie(out, ctx, mean_buf, var_buf, saved_mean, saved_var);
     } else {
         chainerx::Array out = chainerx::FixedBatchNorm(x, s, bias, mean, var, epsilon, axes);
         CHECK_GT(0, this->ctx);
@@ -1,4 +1,5 @@
 #include <map>
+#include <mutex>
 
 #include <chainerx/array.h>
 #include <chainerx/routines/creation.h>
@@ -37,8 +38,12 @@ void check_cuda(CUresult status, const char* msg, int lineno) {
 
 #define CHECK_CUDA(expr) check_cuda(expr, #expr, __LINE__)
 
+// Caches are shared by all threads which run XCVM programs.
+std::mutex g_cache_mu;
+
 char* Compile(const std::string& name, const std::string& code) {
     static std::map<const std::string, char*> cache;
+    std::lock_guard<std::mutex> lock{g_cache_mu};
     auto found = cache.find(code);
     if (found != cache.end()) return found->second;
 
@@ -68,8 +73,11 @@ char* Compile(const std::string& name, const std::string& code) {
 
 CUfunction CompileAndLoad(const std::string& name, const std::string& code) {
     static std::map<const std::string, CUfunction> cache;
-    auto found = cache.find(code);
-    if (found != cache.end()) return found->second;
+    {
+        std::lock_guard<std::mutex> lock{g_cache_mu};
+        auto found = cache.find(code);
+        if (found != cache.end()) return found->second;
+    }
 
     char* ptx = Compile(name, code);
 
@@ -78,8 +86,10 @@ CUfunction CompileAndLoad(const std::string& name, const std::string& code) {
     CHECK_CUDA(cuModuleLoadDataEx(&cu_module, ptx, 0, 0, 0));
     CHECK_CUDA(cuModuleGetFunction(&cu_kernel, cu_module, name.c_str()));
 
-    CHECK(cache.emplace(code, cu_kernel).second);
-    return cu_kernel;
+    std::lock_guard<std::mutex> lock{g_cache_mu};
+    // Another thread may have loaded the same kernel meanwhile.
+    auto inserted = cache.emplace(code, cu_kernel);
+    return inserted.first->second;
 }
 
 }  // namespace
@@ -0,0 +1,111 @@
+#include "runtime/thread_pool.h"
+
+#include <common/log.h>
+
+namespace chainer_compiler {
+namespace runtime {
+
+namespace {
+
+thread_local ThreadPool* g_current_pool = nullptr;
+thread_local int g_worker_id = -1;
+
+}  // namespace
+
+ThreadPool::ThreadPool(int num_threads) {
+    CHECK_LT(0, num_threads);
+    for (int i = 0; i < num_threads + 1; ++i) {
+        queues_.emplace_back(new TaskQueue());
+    }
+    for (int i = 0; i < num_threads; ++i) {
+        threads_.emplace_back([this, i]() { WorkerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::unique_lock<std::mutex> lock{mu_};
+        should_finish_ = true;
+    }
+    work_cond_.notify_all();
+    for (std::thread& th : threads_) th.join();
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    int id = g_current_pool == this ? g_worker_id : threads_.size();
+    {
+        std::unique_lock<std::mutex> lock{mu_};
+        ++num_pending_;
+    }
+    {
+        TaskQueue* queue = queues_[id].get();
+        std::unique_lock<std::mutex> lock{queue->mu};
+        queue->tasks.push_back(std::move(task));
+    }
+    work_cond_.notify_one();
+    done_cond_.notify_all();
+}
+
+void ThreadPool::RunUntil(const std::function<bool()>& done) {
+    const int id = g_current_pool == this ? g_worker_id : threads_.size();
+    while (true) {
+        std::function<void()> task;
+        if (TryPop(id, &task)) {
+            RunTask(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock{mu_};
+        if (done()) break;
+        done_cond_.wait(lock, [this, &done]() { return num_pending_ > 0 || done(); });
+    }
+}
+
+void ThreadPool::WorkerLoop(int id) {
+    g_current_pool = this;
+    g_worker_id = id;
+    while (true) {
+        std::function<void()> task;
+        if (TryPop(id, &task)) {
+            RunTask(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock{mu_};
+        work_cond_.wait(lock, [this]() { return num_pending_ > 0 || should_finish_; });
+        if (should_finish_) break;
+    }
+}
+
+bool ThreadPool::TryPop(int id, std::function<void()>* task) {
+    if (num_pending_ == 0) return false;
+    {
+        TaskQueue* queue = queues_[id].get();
+        std::unique_lock<std::mutex> lock{queue->mu};
+        if (!queue->tasks.empty()) {
+            *task = std::move(queue->tasks.back());
+            queue->tasks.pop_back();
+            --num_pending_;
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues_.size(); ++i) {
+        TaskQueue* queue = queues_[(id + i) % queues_.size()].get();
+        std::unique_lock<std::mutex> lock{queue->mu};
+        if (!queue->tasks.empty()) {
+            *task = std::move(queue->tasks.front());
+            queue->tasks.pop_front();
+            --num_pending_;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::RunTask(const std::function<void()>& task) {
+    task();
+    // Wake up threads in `RunUntil` so they re-evaluate `done`.
+    { std::unique_lock<std::mutex> lock{mu_}; }
+    done_cond_.notify_all();
+}
+
+}  // namespace runtime
+}  // namespace chainer_compiler
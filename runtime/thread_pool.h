@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace chainer_compiler {
+namespace runtime {
+
+// A thread pool with a task deque per worker. A worker takes tasks
+// from the back of its own deque and steals from the front of the
+// others' when it runs out of work.
+class ThreadPool {
+public:
+    explicit ThreadPool(int num_threads);
+    ~ThreadPool();
+
+    // Tasks submitted from a worker go to the worker's own deque.
+    // Others go to a deque shared by non-worker threads. Tasks must
+    // not throw.
+    void Submit(std::function<void()> task);
+
+    // Runs tasks on the calling thread, too, until `done` returns
+    // true. `done` is evaluated after each task finishes.
+    void RunUntil(const std::function<bool()>& done);
+
+    int num_threads() const {
+        return threads_.size();
+    }
+
+private:
+    struct TaskQueue {
+        std::mutex mu;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void WorkerLoop(int id);
+    bool TryPop(int id, std::function<void()>* task);
+    void RunTask(const std::function<void()>& task);
+
+    std::vector<std::thread> threads_;
+    // One queue per worker plus one for non-worker threads.
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+
+    std::mutex mu_;
+    std::condition_variable work_cond_;
+    std::condition_variable done_cond_;
+    std::atomic<int> num_pending_{0};
+    bool should_finish_ = false;
+};
+
+}  // namespace runtime
+}  // namespace chainer_compiler
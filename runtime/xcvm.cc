@@ -1,5 +1,9 @@
 #include "runtime/xcvm.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <numeric>
 
 #ifdef CHAINER_COMPILER_ENABLE_NVTX
@@ -7,13 +11,18 @@
 #endif  // CHAINER_COMPILER_ENABLE_NVTX
 
 #include <chainerx/array.h>
+#include <chainerx/backprop_mode.h>
+#include <chainerx/context.h>
 
 #include <common/log.h>
+#include <common/mmap_util.h>
 #include <common/strutil.h>
 #include <runtime/chrome_tracing.h>
 #include <runtime/meminfo.h>
 #include <runtime/xcvm.pb.h>
 #include <runtime/xcvm_op.h>
+#include <runtime/xcvm_parallel.h>
+#include <runtime/xcvm_profiler.h>
 #include <runtime/xcvm_state.h>
 
 #define RANGE(x) (x).begin(), (x).end()
@@ -48,6 +57,28 @@ void CheckType(XCVMState* st, const XCVMOp* op) {
     }
 }
 
+bool CanRunInReleaseMode(const XCVMOptions& options) {
+    if (!options.release_mode) return false;
+    if (options.trace_level || options.check_types || options.check_nans || options.check_infs || options.dump_memory_usage ||
+        options.chrome_tracing || options.profiler) {
+        return false;
+    }
+    return std::find(options.verbose_ops.begin(), options.verbose_ops.end(), true) == options.verbose_ops.end();
+}
+
+MappedFile LoadConstants(const XCProgramProto& program) {
+    if (program.has_constants_file()) {
+        CHECK(program.constants().empty()) << "Both constants and constants_file are set";
+        return MapFile(program.constants_file());
+    }
+    const std::string& constants = program.constants();
+    if (constants.empty()) return MappedFile{nullptr, 0};
+    std::shared_ptr<void> data(std::malloc(constants.size()), &std::free);
+    CHECK(data);
+    std::memcpy(data.get(), constants.data(), constants.size());
+    return MappedFile{data, constants.size()};
+}
+
 }  // namespace
 
 XCVMOptions::XCVMOptions() {
@@ -58,7 +89,8 @@ XCVMOptions::XCVMOptions() {
     verbose_ops.resize(num_ops);
 }
 
-XCVM::XCVM(const XCProgramProto& program) {
+XCVM::XCVM(const XCProgramProto& program)
+    : arena_size_(program.arena_size()), constants_(LoadConstants(program)), inference_only_(program.inference_only()) {
     num_variables_ = 0;
     for (const XCInstructionProto& inst : program.instructions()) {
         for (int output : inst.outputs()) {
@@ -82,8 +114,28 @@ InOuts XCVM::Run(const InOuts& program_inputs, const XCVMOptions& options) {
 }
 
 void XCVM::Run(XCVMState* state) {
-    state->SetProgram(&program_);
+    state->SetProgram(&program_, arena_size_, constants_.data, constants_.size);
     const XCVMOptions& options = state->options();
+    CHECK(!inference_only_ || !options.is_training) << "The program was compiled only for inference";
+    if (CanRunInReleaseMode(options)) {
+        // ChainerX autograd is not thread safe, so runs which build
+        // graphs for backprop are sequential.
+        if (options.num_threads > 1 && !options.is_training && !chainerx::IsBackpropRequired(chainerx::GetDefaultContext())) {
+            std::shared_ptr<XCVMParallelExecutor> executor;
+            {
+                std::lock_guard<std::mutex> lock{parallel_executor_mu_};
+                if (!parallel_executor_ || parallel_executor_->num_threads() != options.num_threads) {
+                    parallel_executor_.reset(new XCVMParallelExecutor(program_, options.num_threads));
+                }
+                executor = parallel_executor_;
+            }
+            executor->Run(state);
+            return;
+        }
+        RunReleaseMode(state);
+        return;
+    }
+
     int64_t peak_usage = 0;
 
     while (true) {
@@ -97,6 +149,8 @@ void XCVM::Run(XCVMState* state) {
 #ifdef CHAINER_COMPILER_ENABLE_NVTX
             nvtxRangePush(op->name().c_str());
 #endif
+            std::chrono::steady_clock::time_point start;
+            if (options.profiler) start = std::chrono::steady_clock::now();
             try {
                 op->Run(state);
             } catch (...) {
@@ -106,6 +160,7 @@ void XCVM::Run(XCVMState* state) {
 #ifdef CHAINER_COMPILER_ENABLE_NVTX
             nvtxRangePop();
 #endif
+            if (options.profiler) options.profiler->AddRecord(*op, pc, state, start);
         }
 
         state->set_pc(state->pc() + 1);
@@ -115,7 +170,7 @@ void XCVM::Run(XCVMState* state) {
         }
 
         if (options.dump_memory_usage && options.base_memory_usage >= 0) {
-            int64_t bytes = options.base_memory_usage - GetMemoryUsageInBytes();
+            int64_t bytes = GetMemoryUsageInBytes() - options.base_memory_usage;
             int64_t mbs = bytes / 1000 / 1000;
             peak_usage = std::max(mbs, peak_usage);
             std::cerr << " Memory usage: " << mbs << "MB" << std::endl;
@@ -125,8 +180,32 @@ void XCVM::Run(XCVMState* state) {
     if (options.dump_memory_usage) {
         state->ShowVariableStatus();
         std::cerr << "Peak memory usage: " << peak_usage << "MB" << std::endl;
+        NativeMemoryStats stats;
+        if (!g_meminfo_enabled && GetNativeMemoryStats(&stats)) {
+            std::cerr << "Native memory: current=" << stats.current_bytes / 1000 / 1000 << "MB peak=" << stats.peak_bytes / 1000 / 1000
+                      << "MB allocations=" << stats.num_allocations << std::endl;
+        }
     }
 }
 
+void XCVM::RunReleaseMode(XCVMState* state) {
+    // Operands of instructions were already decoded into the fields
+    // of `XCVMOp` subclasses in the constructor, so this loop does
+    // nothing but dispatching.
+    const int num_ops = program_.size();
+    const std::unique_ptr<XCVMOp>* ops = program_.data();
+    while (true) {
+        int pc = state->pc();
+        if (pc >= num_ops) break;
+        ops[pc]->RunFast(state);
+        state->set_pc(state->pc() + 1);
+    }
+}
+
+void ResolveConstantsFile(const std::string& program_filename, XCProgramProto* program) {
+    if (!program->has_constants_file() || HasPrefix(program->constants_file(), "/")) return;
+    program->set_constants_file(StrCat(Dirname(program_filename), '/', program->constants_file()));
+}
+
 }  // namespace runtime
 }  // namespace chainer_compiler
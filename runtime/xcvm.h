@@ -1,10 +1,13 @@
 #pragma once
 
 #include <cstdint>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include <common/mmap_util.h>
 #include "runtime/xcvm.pb.h"
 
 namespace chainer_compiler {
@@ -12,6 +15,8 @@ namespace runtime {
 
 class ChromeTracingEmitter;
 class XCVMOp;
+class XCVMParallelExecutor;
+class XCVMProfiler;
 class XCVMState;
 class XCVMVar;
 
@@ -37,11 +42,27 @@ public:
     bool check_infs{false};
 
     bool dump_memory_usage{false};
+    // The result of `GetMemoryUsageInBytes` before the run.
     int64_t base_memory_usage{0};
 
     ChromeTracingEmitter* chrome_tracing{nullptr};
+
+    XCVMProfiler* profiler{nullptr};
+
+    // Runs the program with a dispatch loop which skips traces and
+    // per-op checks. This is ignored when any of the debug options
+    // above is enabled.
+    bool release_mode{false};
+
+    // When this is larger than one, independent instructions run
+    // concurrently on this many threads. Only effective in the
+    // release mode without training and backprop.
+    int num_threads{1};
 };
 
+// An XCVM program is not modified after its construction. `Run` can
+// be called concurrently from multiple threads as long as each thread
+// uses its own XCVMState.
 class XCVM {
 public:
     explicit XCVM(const XCProgramProto& program);
@@ -55,9 +76,25 @@ public:
     }
 
 private:
+    void RunReleaseMode(XCVMState* state);
+
     std::vector<std::unique_ptr<XCVMOp>> program_;
     int num_variables_;
+    int64_t arena_size_;
+    // The data of BinaryConstant ops, either a copy of
+    // `XCProgramProto::constants` or a read-only mapping of
+    // `constants_file`. Shared by all runs, so it must not be written.
+    MappedFile constants_;
+    const bool inference_only_;
+    // Created on the first run with `num_threads` > 1.
+    std::shared_ptr<XCVMParallelExecutor> parallel_executor_;
+    std::mutex parallel_executor_mu_;
 };
 
+// Makes a relative `constants_file` of `program` relative to the
+// directory of `program_filename`, the file `program` was read from,
+// instead of the current directory.
+void ResolveConstantsFile(const std::string& program_filename, XCProgramProto* program);
+
 }  // namespace runtime
 }  // namespace chainer_compiler
@@ -0,0 +1,102 @@
+// Measures the per-instruction dispatch cost of XCVM.
+//
+// Usage: xcvm_benchmark [num_instructions] [iterations]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include <chainerx/array.h>
+#include <chainerx/context.h>
+#include <chainerx/routines/creation.h>
+
+#include <compiler/gen_xcvm_codegen.h>
+#include <runtime/xcvm.h>
+#include <runtime/xcvm.pb.h>
+#include <runtime/xcvm_session.h>
+#include <runtime/xcvm_var.h>
+
+namespace chainer_compiler {
+namespace runtime {
+namespace {
+
+// Builds a straight-line program which repeatedly adds a tiny array
+// and moves it around so the cost of each instruction is dominated by
+// the dispatch overhead.
+void BuildProgram(int num_instructions, XCProgramProto* program) {
+    xcvm::AddInOp(program, 1, "in");
+    xcvm::AddInOp(program, 2, "one");
+    int cur = 1;
+    int next = 3;
+    for (int i = 0; i < num_instructions / 3; ++i) {
+        int sum = next++;
+        xcvm::AddAddOp(program, sum, cur, 2);
+        if (cur != 1) xcvm::AddFreeOp(program, cur);
+        int moved = next++;
+        xcvm::AddIdentityOp(program, moved, sum);
+        xcvm::AddFreeOp(program, sum);
+        cur = moved;
+    }
+    xcvm::AddOutOp(program, "out", cur);
+    xcvm::AddFreeOp(program, cur);
+    xcvm::AddFreeOp(program, 1);
+    xcvm::AddFreeOp(program, 2);
+}
+
+double MeasureNanosecPerInstruction(XCVM* xcvm, const InOuts& inputs, const XCVMOptions& options, int num_instructions, int iterations) {
+    // Warm up.
+    xcvm->Run(inputs, options);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        xcvm->Run(inputs, options);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    return elapsed / iterations / num_instructions;
+}
+
+void RunBenchmark(int argc, char** argv) {
+    int num_instructions = argc > 1 ? std::atoi(argv[1]) : 3000;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 100;
+
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    XCProgramProto program;
+    BuildProgram(num_instructions, &program);
+    XCVM xcvm(program);
+
+    InOuts inputs;
+    chainerx::Array one = chainerx::Ones({1}, chainerx::Dtype::kFloat32);
+    inputs.emplace("in", std::shared_ptr<XCVMVar>(new XCVMVar(one)));
+    inputs.emplace("one", std::shared_ptr<XCVMVar>(new XCVMVar(one)));
+
+    XCVMOptions options;
+    double checked_ns = MeasureNanosecPerInstruction(&xcvm, inputs, options, program.instructions_size(), iterations);
+    options.release_mode = true;
+    double release_ns = MeasureNanosecPerInstruction(&xcvm, inputs, options, program.instructions_size(), iterations);
+
+    XCVMSession session(&xcvm, options);
+    session.Run(inputs);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        session.Run(inputs);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double session_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    session_ns /= iterations * program.instructions_size();
+
+    std::cout << "Instructions: " << program.instructions_size() << std::endl;
+    std::cout << "Default mode: " << checked_ns << " nsec/instruction" << std::endl;
+    std::cout << "Release mode: " << release_ns << " nsec/instruction" << std::endl;
+    std::cout << "Release mode with session: " << session_ns << " nsec/instruction" << std::endl;
+}
+
+}  // namespace
+}  // namespace runtime
+}  // namespace chainer_compiler
+
+int main(int argc, char** argv) {
+    chainer_compiler::runtime::RunBenchmark(argc, argv);
+}
@@ -186,6 +186,10 @@ XC_OPS = [
     ('Conv',
      [Array('x'), Array('w'), OptionalArray('b'),
       Ints('strides'), Ints('pads')], ['y']),
+    # Conv followed by an optional residual Add and an optional Relu.
+    ('FusedConv',
+     [Array('x'), Array('w'), OptionalArray('b'), OptionalArray('residual'),
+      Ints('strides'), Ints('pads'), Int('relu')], ['y']),
     ('ConvTranspose',
      [Array('x'), Array('w'), OptionalArray('b'),
       Ints('strides'), Ints('pads'), Ints('output_shape')], ['y']),
@@ -308,6 +312,8 @@ XC_OPS = [
      [Longs('value'), Int('dtype'), Ints('shape'), Int('host')], ['output']),
     ('FloatConstant',
      [Doubles('value'), Int('dtype'), Ints('shape'), Int('host')], ['output']),
+    ('BinaryConstant',
+     [Int('offset'), Int('dtype'), Ints('shape'), Int('host')], ['output']),
     ('ConstantFill',
      [OptionalArray('input'), Int('dtype'), Ints('extra_shape'),
       Ints('shape'), Float('value')],
@@ -332,6 +338,10 @@ XC_CUSTOM_FIELD_OPS = [
      [ArrayList('inputs'), Int('num_outputs'),
       String('dso_filename'), String('func_name'), Ints('output_shape')],
      [ArrayList('outputs')]),
+    ('ElementWiseCpu',
+     [ArrayList('inputs'), Longs('program'), Doubles('constants'),
+      Longs('output_regs'), Int('fusion_id')],
+     [ArrayList('outputs')]),
 ]
 
 XC_SEQ_OPS = [
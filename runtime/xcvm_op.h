@@ -17,6 +17,12 @@ public:
 
     virtual void Run(XCVMState* state) = 0;
 
+    // Runs the op without traces and per-op checks. Used by the
+    // release mode of XCVM.
+    virtual void RunFast(XCVMState* state) {
+        Run(state);
+    }
+
     const XCInstructionProto& instruction() const {
         return inst_;
     }
@@ -0,0 +1,259 @@
+#include "runtime/xcvm_parallel.h"
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+
+#include <chainerx/backprop_mode.h>
+#include <chainerx/context.h>
+#include <chainerx/device.h>
+
+#include <common/log.h>
+#include <runtime/thread_pool.h>
+#include <runtime/xcvm.pb.h>
+#include <runtime/xcvm_op.h>
+#include <runtime/xcvm_state.h>
+
+namespace chainer_compiler {
+namespace runtime {
+
+struct XCVMParallelExecutor::Region {
+    int begin;
+    int end;
+    // Instructions which must wait for each instruction, indexed by
+    // the offset from `begin`.
+    std::vector<std::vector<int>> users;
+    std::vector<int> num_deps;
+    std::vector<int> roots;
+};
+
+namespace {
+
+// Ops which cannot be reordered with other instructions.
+bool IsSequentialOp(XCInstructionProto::Op op) {
+    switch (op) {
+        // Control flow.
+        case XCInstructionProto::Jmp:
+        case XCInstructionProto::JmpTrue:
+        case XCInstructionProto::JmpFalse:
+        // Outputs and logs are ordered.
+        case XCInstructionProto::Out:
+        case XCInstructionProto::Print:
+        // Random numbers come from a global generator, so they are
+        // reproducible only in the program order.
+        case XCInstructionProto::Dropout:
+        // Make backprop IDs in the default context.
+        case XCInstructionProto::LSTM:
+        case XCInstructionProto::LSTMGrad:
+        // Sequences may be shared by multiple variables.
+        case XCInstructionProto::SequenceClear:
+        case XCInstructionProto::SequenceAppend:
+        case XCInstructionProto::SequencePop:
+        case XCInstructionProto::SequenceMove:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Arena regions planned by the compiler are reused in the program
+// order, so instructions which write into the arena are not reordered.
+bool IsSequential(const XCInstructionProto& inst) {
+    if (IsSequentialOp(inst.op())) return true;
+    for (int64_t offset : inst.output_offsets()) {
+        if (offset >= 0) return true;
+    }
+    return false;
+}
+
+bool IsJmpOp(XCInstructionProto::Op op) {
+    return op == XCInstructionProto::Jmp || op == XCInstructionProto::JmpTrue || op == XCInstructionProto::JmpFalse;
+}
+
+void GetOperands(const XCInstructionProto& inst, std::vector<int>* reads, std::vector<int>* writes) {
+    for (const XCValueProto& value : inst.inputs()) {
+        switch (value.type()) {
+            case XCValueProto::ARRAY:
+            case XCValueProto::OPTIONAL_ARRAY:
+                reads->push_back(value.array());
+                break;
+            case XCValueProto::SEQUENCE:
+                reads->push_back(value.sequence());
+                break;
+            case XCValueProto::OPAQUE:
+                reads->push_back(value.opaque());
+                break;
+            case XCValueProto::ARRAY_LIST:
+                reads->insert(reads->end(), value.array_list().begin(), value.array_list().end());
+                break;
+            default:
+                break;
+        }
+    }
+    writes->assign(inst.outputs().begin(), inst.outputs().end());
+    // An in-place op overwrites its input after all other readers.
+    const int inplace = inst.inplace_input();
+    if (inplace >= 0 && inplace < inst.inputs_size() && inst.inputs(inplace).type() == XCValueProto::ARRAY) {
+        writes->push_back(inst.inputs(inplace).array());
+    }
+    // `Free` releases its input so it must wait for all readers.
+    if (inst.op() == XCInstructionProto::Free) {
+        writes->insert(writes->end(), reads->begin(), reads->end());
+        reads->clear();
+    }
+}
+
+void AddEdge(int from, int to, std::vector<std::set<int>>* users) {
+    if (from != to) (*users)[from].insert(to);
+}
+
+}  // namespace
+
+XCVMParallelExecutor::XCVMParallelExecutor(const std::vector<std::unique_ptr<XCVMOp>>& program, int num_threads)
+    : program_(program), num_threads_(num_threads) {
+    CHECK_LT(1, num_threads);
+    const int num_ops = program_.size();
+
+    std::vector<bool> is_boundary(num_ops + 1);
+    for (int pc = 0; pc < num_ops; ++pc) {
+        const XCInstructionProto& inst = program_[pc]->instruction();
+        if (IsSequential(inst)) {
+            is_boundary[pc] = true;
+            is_boundary[pc + 1] = true;
+        }
+        if (IsJmpOp(inst.op())) {
+            int target = inst.inputs(inst.inputs_size() - 1).i();
+            CHECK_LE(0, target);
+            CHECK_LE(target, num_ops);
+            is_boundary[target] = true;
+        }
+    }
+    is_boundary[num_ops] = true;
+
+    region_at_pc_.resize(num_ops, -1);
+    for (int begin = 0; begin < num_ops;) {
+        if (IsSequential(program_[begin]->instruction())) {
+            ++begin;
+            continue;
+        }
+        int end = begin + 1;
+        while (!is_boundary[end]) ++end;
+        // A single instruction is simply run on the calling thread.
+        if (end - begin > 1) {
+            std::unique_ptr<Region> region(new Region());
+            region->begin = begin;
+            region->end = end;
+            region->users.resize(end - begin);
+            region->num_deps.resize(end - begin);
+
+            std::vector<std::set<int>> edges(end - begin);
+            std::map<int, int> last_writer;
+            std::map<int, std::vector<int>> readers;
+            for (int i = 0; i < end - begin; ++i) {
+                std::vector<int> reads, writes;
+                GetOperands(program_[begin + i]->instruction(), &reads, &writes);
+                for (int id : reads) {
+                    if (id < 0) continue;
+                    auto found = last_writer.find(id);
+                    if (found != last_writer.end()) AddEdge(found->second, i, &edges);
+                    readers[id].push_back(i);
+                }
+                for (int id : writes) {
+                    if (id < 0) continue;
+                    auto found = last_writer.find(id);
+                    if (found != last_writer.end()) AddEdge(found->second, i, &edges);
+                    for (int reader : readers[id]) AddEdge(reader, i, &edges);
+                    readers[id].clear();
+                    last_writer[id] = i;
+                }
+            }
+            for (int i = 0; i < end - begin; ++i) {
+                for (int user : edges[i]) {
+                    region->users[i].push_back(user);
+                    ++region->num_deps[user];
+                }
+            }
+            for (int i = 0; i < end - begin; ++i) {
+                if (region->num_deps[i] == 0) region->roots.push_back(i);
+            }
+
+            region_at_pc_[begin] = regions_.size();
+            regions_.push_back(std::move(region));
+        }
+        begin = end;
+    }
+
+    // The calling thread runs instructions, too.
+    pool_.reset(new ThreadPool(num_threads - 1));
+}
+
+XCVMParallelExecutor::~XCVMParallelExecutor() {
+}
+
+void XCVMParallelExecutor::Run(XCVMState* state) {
+    const int num_ops = program_.size();
+    while (true) {
+        int pc = state->pc();
+        if (pc >= num_ops) break;
+        int region_index = region_at_pc_[pc];
+        if (region_index >= 0) {
+            const Region& region = *regions_[region_index];
+            RunRegion(region, state);
+            state->set_pc(region.end);
+        } else {
+            program_[pc]->RunFast(state);
+            state->set_pc(state->pc() + 1);
+        }
+    }
+}
+
+void XCVMParallelExecutor::RunRegion(const Region& region, XCVMState* state) {
+    const int num_ops = region.end - region.begin;
+    std::unique_ptr<std::atomic<int>[]> num_deps(new std::atomic<int>[num_ops]);
+    for (int i = 0; i < num_ops; ++i) num_deps[i] = region.num_deps[i];
+    std::atomic<int> num_done{0};
+    std::atomic<bool> failed{false};
+    std::mutex error_mu;
+    std::exception_ptr error;
+
+    // The default device and the backprop mode are thread local in
+    // ChainerX. Workers inherit the device from the calling thread. The
+    // parallel executor is used only without backprop as ChainerX
+    // autograd is not thread safe.
+    chainerx::Context& context = chainerx::GetDefaultContext();
+    chainerx::Device& device = chainerx::GetDefaultDevice();
+
+    std::function<void(int)> run_op = [&](int i) {
+        if (!failed) {
+            chainerx::SetDefaultContext(&context);
+            chainerx::SetDefaultDevice(&device);
+            chainerx::NoBackpropModeScope no_backprop;
+            try {
+                program_[region.begin + i]->RunFast(state);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock{error_mu};
+                if (!failed) error = std::current_exception();
+                failed = true;
+            }
+        }
+        // Users are still released after a failure so `num_done`
+        // reaches `num_ops`.
+        for (int user : region.users[i]) {
+            if (--num_deps[user] == 0) pool_->Submit([&run_op, user]() { run_op(user); });
+        }
+        ++num_done;
+    };
+
+    for (int root : region.roots) {
+        pool_->Submit([&run_op, root]() { run_op(root); });
+    }
+    pool_->RunUntil([&num_done, num_ops]() { return num_done == num_ops; });
+
+    if (error) std::rethrow_exception(error);
+}
+
+}  // namespace runtime
+}  // namespace chainer_compiler
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+namespace chainer_compiler {
+namespace runtime {
+
+class ThreadPool;
+class XCVMOp;
+class XCVMState;
+
+// Runs independent instructions of an XCVM program concurrently.
+//
+// The program is split into straight-line regions which contain
+// neither control flow ops nor jump targets. Inside a region, an
+// instruction depends on the previous writers and readers of the
+// variables it touches (`Free` counts as a write), and is dispatched
+// to a thread pool once they have finished. Control flow ops and ops
+// with side effects outside their operands run sequentially between
+// regions.
+class XCVMParallelExecutor {
+public:
+    XCVMParallelExecutor(const std::vector<std::unique_ptr<XCVMOp>>& program, int num_threads);
+    ~XCVMParallelExecutor();
+
+    void Run(XCVMState* state);
+
+    int num_threads() const {
+        return num_threads_;
+    }
+
+private:
+    struct Region;
+
+    void RunRegion(const Region& region, XCVMState* state);
+
+    const std::vector<std::unique_ptr<XCVMOp>>& program_;
+    const int num_threads_;
+    std::vector<std::unique_ptr<Region>> regions_;
+    // The index of the region which starts at each pc, or -1.
+    std::vector<int> region_at_pc_;
+    std::unique_ptr<ThreadPool> pool_;
+};
+
+}  // namespace runtime
+}  // namespace chainer_compiler
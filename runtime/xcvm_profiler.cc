@@ -0,0 +1,286 @@
+#include "runtime/xcvm_profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <chainerx/array.h>
+#include <chainerx/device.h>
+
+#include <common/log.h>
+#include <runtime/xcvm.pb.h>
+#include <runtime/xcvm_op.h>
+#include <runtime/xcvm_state.h>
+#include <runtime/xcvm_var.h>
+
+namespace chainer_compiler {
+namespace runtime {
+
+namespace {
+
+const chainerx::Array* GetArrayOrNull(XCVMState* state, int index) {
+    XCVMVar* var = state->GetVarOrNull(index);
+    if (!var || var->kind() != XCVMVar::Kind::kArray) return nullptr;
+    return &var->GetArray();
+}
+
+int64_t ShapeSize(const chainerx::Shape& shape, int begin) {
+    int64_t size = 1;
+    for (int i = begin; i < shape.size(); ++i) size *= shape[i];
+    return size;
+}
+
+bool IsElementwiseOp(XCInstructionProto::Op op) {
+    switch (op) {
+        case XCInstructionProto::Add:
+        case XCInstructionProto::Sub:
+        case XCInstructionProto::Mul:
+        case XCInstructionProto::Div:
+        case XCInstructionProto::Pow:
+        case XCInstructionProto::Neg:
+        case XCInstructionProto::Reciprocal:
+        case XCInstructionProto::Exp:
+        case XCInstructionProto::Log:
+        case XCInstructionProto::Sqrt:
+        case XCInstructionProto::Abs:
+        case XCInstructionProto::Tanh:
+        case XCInstructionProto::Sigmoid:
+        case XCInstructionProto::Relu:
+        case XCInstructionProto::ReluGrad:
+        case XCInstructionProto::Selu:
+        case XCInstructionProto::LeakyRelu:
+        case XCInstructionProto::Elu:
+        case XCInstructionProto::Clip:
+        case XCInstructionProto::Max:
+        case XCInstructionProto::Floor:
+        case XCInstructionProto::Ceil:
+        case XCInstructionProto::Equal:
+        case XCInstructionProto::Greater:
+        case XCInstructionProto::GreaterEqual:
+        case XCInstructionProto::Not:
+        case XCInstructionProto::And:
+        case XCInstructionProto::Or:
+        case XCInstructionProto::Xor:
+        case XCInstructionProto::ElementWiseNvrtc:
+        case XCInstructionProto::ElementWiseCpu:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Counts a multiply-add as two operations. Returns zero for ops whose
+// costs are not modeled.
+int64_t CountFlops(
+        const XCInstructionProto& inst,
+        const std::vector<const chainerx::Array*>& inputs,
+        const std::vector<const chainerx::Array*>& outputs) {
+    auto in = [&inputs](int i) -> const chainerx::Array* { return i < inputs.size() ? inputs[i] : nullptr; };
+    const chainerx::Array* y = outputs.empty() ? nullptr : outputs[0];
+
+    switch (inst.op()) {
+        case XCInstructionProto::Conv:
+            // w: (Cout, Cin / group, k...)
+            if (!y || !in(1)) return 0;
+            return 2 * y->GetTotalSize() * ShapeSize(in(1)->shape(), 1);
+
+        case XCInstructionProto::ConvTranspose:
+        case XCInstructionProto::ConvTransposeWithDynamicShape:
+            // w: (Cin, Cout / group, k...)
+            if (!in(0) || !in(1)) return 0;
+            return 2 * in(0)->GetTotalSize() * ShapeSize(in(1)->shape(), 1);
+
+        case XCInstructionProto::ConvGradWeight:
+            // Inputs are (w, x, gy).
+            if (!in(0) || !in(2)) return 0;
+            return 2 * in(2)->GetTotalSize() * ShapeSize(in(0)->shape(), 1);
+
+        case XCInstructionProto::MatMul:
+            if (!y || !in(0) || in(0)->ndim() == 0) return 0;
+            return 2 * y->GetTotalSize() * in(0)->shape().back();
+
+        case XCInstructionProto::Gemm: {
+            if (!y || !in(0) || in(0)->ndim() != 2) return 0;
+            int64_t k = inst.inputs(5).i() ? in(0)->shape()[0] : in(0)->shape()[1];
+            return 2 * y->GetTotalSize() * k;
+        }
+
+        case XCInstructionProto::Linear:
+            // w: (N, K)
+            if (!y || !in(1) || in(1)->ndim() != 2) return 0;
+            return 2 * y->GetTotalSize() * in(1)->shape()[1];
+
+        case XCInstructionProto::LinearGradWeight:
+            // gw: (N, K)
+            if (!y || !in(0) || y->ndim() != 2 || y->shape()[1] == 0) return 0;
+            return 2 * y->GetTotalSize() * (in(0)->GetTotalSize() / y->shape()[1]);
+
+        case XCInstructionProto::RNN:
+        case XCInstructionProto::GRU:
+        case XCInstructionProto::LSTM: {
+            // x: (T, B, I), w: (D, G * H, I), r: (D, G * H, H)
+            const chainerx::Array* x = in(0);
+            const chainerx::Array* w = in(1);
+            const chainerx::Array* r = in(2);
+            if (!x || !w || !r || x->ndim() != 3 || w->ndim() != 3 || r->ndim() != 3) return 0;
+            int64_t steps = x->shape()[0] * x->shape()[1] * w->shape()[0];
+            return 2 * steps * w->shape()[1] * (x->shape()[2] + r->shape()[2]);
+        }
+
+        default:
+            break;
+    }
+
+    if (IsElementwiseOp(inst.op())) {
+        int64_t flops = 0;
+        for (const chainerx::Array* output : outputs) {
+            if (output) flops += output->GetTotalSize();
+        }
+        return flops;
+    }
+    return 0;
+}
+
+std::vector<XCVMProfiler::Stats> SortByTime(std::vector<XCVMProfiler::Stats> stats) {
+    std::stable_sort(stats.begin(), stats.end(), [](const XCVMProfiler::Stats& a, const XCVMProfiler::Stats& b) {
+        return a.nsec > b.nsec;
+    });
+    return stats;
+}
+
+void ShowStats(std::ostream& os, const std::vector<XCVMProfiler::Stats>& stats, int64_t total_nsec, size_t limit) {
+    os << std::left << std::setw(32) << "name" << std::right << std::setw(8) << "pc" << std::setw(10) << "count" << std::setw(14)
+       << "total(ms)" << std::setw(8) << "%" << std::setw(12) << "GFLOPS" << std::setw(12) << "GB/s" << std::endl;
+    for (size_t i = 0; i < std::min(limit, stats.size()); ++i) {
+        const XCVMProfiler::Stats& s = stats[i];
+        double sec = s.nsec * 1e-9;
+        os << std::left << std::setw(32) << s.name << std::right << std::setw(8) << s.pc << std::setw(10) << s.count << std::setw(14)
+           << std::fixed << std::setprecision(3) << s.nsec * 1e-6 << std::setw(8) << std::setprecision(1)
+           << (total_nsec ? 100.0 * s.nsec / total_nsec : 0.0) << std::setw(12) << std::setprecision(2)
+           << (sec > 0 ? s.flops / sec * 1e-9 : 0.0) << std::setw(12) << (sec > 0 ? s.bytes / sec * 1e-9 : 0.0) << std::endl;
+    }
+    os << std::defaultfloat;
+}
+
+}  // namespace
+
+void XCVMProfiler::AddRecord(const XCVMOp& op, int pc, XCVMState* state, std::chrono::steady_clock::time_point start) {
+    chainerx::GetDefaultDevice().Synchronize();
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    const XCInstructionProto& inst = op.instruction();
+    std::vector<const chainerx::Array*> inputs;
+    for (const XCValueProto& value : inst.inputs()) {
+        switch (value.type()) {
+            case XCValueProto::ARRAY:
+            case XCValueProto::OPTIONAL_ARRAY:
+                inputs.push_back(GetArrayOrNull(state, value.array()));
+                break;
+            case XCValueProto::ARRAY_LIST:
+                for (int id : value.array_list()) inputs.push_back(GetArrayOrNull(state, id));
+                break;
+            default:
+                inputs.push_back(nullptr);
+        }
+    }
+    std::vector<const chainerx::Array*> outputs;
+    for (int id : inst.outputs()) outputs.push_back(GetArrayOrNull(state, id));
+
+    int64_t bytes = 0;
+    for (const chainerx::Array* a : inputs) {
+        if (a) bytes += a->GetNBytes();
+    }
+    for (const chainerx::Array* a : outputs) {
+        if (a) bytes += a->GetNBytes();
+    }
+    int64_t flops = CountFlops(inst, inputs, outputs);
+
+    std::lock_guard<std::mutex> lock{mu_};
+    Stats& stats = inst_stats_[&op];
+    if (stats.count == 0) {
+        stats.name = op.name();
+        stats.pc = pc;
+    }
+    ++stats.count;
+    stats.nsec += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    stats.flops += flops;
+    stats.bytes += bytes;
+}
+
+std::vector<XCVMProfiler::Stats> XCVMProfiler::GetOpTypeStats() const {
+    std::map<std::string, Stats> op_stats;
+    for (const auto& p : inst_stats_) {
+        const std::string& op_name = XCInstructionProto_Op_Name(p.first->op());
+        Stats& stats = op_stats[op_name];
+        stats.name = op_name;
+        stats.count += p.second.count;
+        stats.nsec += p.second.nsec;
+        stats.flops += p.second.flops;
+        stats.bytes += p.second.bytes;
+    }
+    std::vector<Stats> stats;
+    for (const auto& p : op_stats) stats.push_back(p.second);
+    return stats;
+}
+
+std::vector<XCVMProfiler::Stats> XCVMProfiler::GetInstructionStats() const {
+    std::vector<Stats> stats;
+    for (const auto& p : inst_stats_) stats.push_back(p.second);
+    std::stable_sort(stats.begin(), stats.end(), [](const Stats& a, const Stats& b) { return a.pc < b.pc; });
+    return stats;
+}
+
+void XCVMProfiler::Report(std::ostream& os, int num_instructions) const {
+    std::lock_guard<std::mutex> lock{mu_};
+    std::vector<Stats> op_stats = GetOpTypeStats();
+    std::vector<Stats> inst_stats = GetInstructionStats();
+    int64_t total_nsec = 0;
+    for (const Stats& s : op_stats) total_nsec += s.nsec;
+
+    os << "=== Profile by op type (total " << total_nsec * 1e-6 << "ms) ===" << std::endl;
+    ShowStats(os, SortByTime(op_stats), total_nsec, op_stats.size());
+    os << "=== Top " << num_instructions << " instructions ===" << std::endl;
+    ShowStats(os, SortByTime(inst_stats), total_nsec, num_instructions);
+}
+
+void XCVMProfiler::EmitCSV(const std::string& output_filename) const {
+    std::lock_guard<std::mutex> lock{mu_};
+    std::ofstream ofs(output_filename);
+    CHECK(ofs) << "Failed to open output CSV: " << output_filename;
+    ofs << "kind,name,pc,count,nsec,flops,bytes\n";
+    auto emit = [&ofs](const char* kind, const Stats& s) {
+        ofs << kind << ',' << s.name << ',' << s.pc << ',' << s.count << ',' << s.nsec << ',' << s.flops << ',' << s.bytes << '\n';
+    };
+    for (const Stats& s : GetOpTypeStats()) emit("op", s);
+    for (const Stats& s : GetInstructionStats()) emit("instruction", s);
+}
+
+void XCVMProfiler::EmitJSON(const std::string& output_filename) const {
+    std::lock_guard<std::mutex> lock{mu_};
+    std::ofstream ofs(output_filename);
+    CHECK(ofs) << "Failed to open output JSON: " << output_filename;
+    auto emit = [&ofs](const Stats& s) {
+        ofs << "{\"name\":\"" << s.name << "\",\"pc\":" << s.pc << ",\"count\":" << s.count << ",\"nsec\":" << s.nsec
+            << ",\"flops\":" << s.flops << ",\"bytes\":" << s.bytes << "}";
+    };
+    ofs << "{\"ops\":[\n";
+    bool is_first = true;
+    for (const Stats& s : GetOpTypeStats()) {
+        if (!is_first) ofs << ",\n";
+        is_first = false;
+        emit(s);
+    }
+    ofs << "],\n\"instructions\":[\n";
+    is_first = true;
+    for (const Stats& s : GetInstructionStats()) {
+        if (!is_first) ofs << ",\n";
+        is_first = false;
+        emit(s);
+    }
+    ofs << "]}\n";
+}
+
+}  // namespace runtime
+}  // namespace chainer_compiler
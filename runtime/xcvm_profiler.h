@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace chainer_compiler {
+namespace runtime {
+
+class XCVMOp;
+class XCVMState;
+
+// Aggregates the time, FLOPs and bytes of executed instructions per
+// instruction and per op type across runs. The device is synchronized
+// after each instruction so asynchronous kernels are attributed to the
+// instruction which launched them.
+class XCVMProfiler {
+public:
+    struct Stats {
+        std::string name;
+        int pc{-1};
+        int64_t count{0};
+        int64_t nsec{0};
+        int64_t flops{0};
+        int64_t bytes{0};
+    };
+
+    // Records an execution of `op` at `pc` which started at `start`.
+    // Shapes of operands are taken from `state`, so this must be
+    // called right after `op` runs.
+    void AddRecord(const XCVMOp& op, int pc, XCVMState* state, std::chrono::steady_clock::time_point start);
+
+    // Shows a table of op types sorted by the total time, followed by
+    // the most expensive instructions.
+    void Report(std::ostream& os, int num_instructions = 20) const;
+
+    void EmitCSV(const std::string& output_filename) const;
+    void EmitJSON(const std::string& output_filename) const;
+
+private:
+    std::vector<Stats> GetOpTypeStats() const;
+    std::vector<Stats> GetInstructionStats() const;
+
+    mutable std::mutex mu_;
+    // Keyed by ops so instructions of different programs are distinct.
+    std::map<const XCVMOp*, Stats> inst_stats_;
+};
+
+}  // namespace runtime
+}  // namespace chainer_compiler
@@ -0,0 +1,20 @@
+#include "runtime/xcvm_session.h"
+
+namespace chainer_compiler {
+namespace runtime {
+
+XCVMSession::XCVMSession(XCVM* xcvm, const XCVMOptions& options)
+    : xcvm_(xcvm), state_(options, xcvm->num_variables(), empty_inputs_) {
+}
+
+XCVMSession::~XCVMSession() {
+}
+
+const InOuts& XCVMSession::Run(const InOuts& inputs) {
+    state_.Reset(inputs);
+    xcvm_->Run(&state_);
+    return state_.GetOutputs();
+}
+
+}  // namespace runtime
+}  // namespace chainer_compiler
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <runtime/xcvm.h>
+#include <runtime/xcvm_state.h>
+
+namespace chainer_compiler {
+namespace runtime {
+
+// Runs a program repeatedly with a single `XCVMState`, so variable
+// slots and output entries are allocated only once.
+class XCVMSession {
+public:
+    XCVMSession(XCVM* xcvm, const XCVMOptions& options);
+    ~XCVMSession();
+
+    // Runs the program. The returned outputs are valid until the next
+    // call of `Run`. Copy the `shared_ptr`s to keep them longer.
+    const InOuts& Run(const InOuts& inputs);
+
+private:
+    XCVM* xcvm_;
+    const InOuts empty_inputs_;
+    XCVMState state_;
+};
+
+}  // namespace runtime
+}  // namespace chainer_compiler
@@ -1,5 +1,9 @@
 #include "runtime/xcvm_state.h"
 
+#include <chainerx/backprop_mode.h>
+#include <chainerx/context.h>
+#include <chainerx/native/native_backend.h>
+#include <chainerx/routines/creation.h>
 #include <chainerx/routines/manipulation.h>
 #include <chainerx/routines/math.h>
 
@@ -13,16 +17,33 @@ namespace chainer_compiler {
 namespace runtime {
 
 XCVMState::XCVMState(const XCVMOptions& options, int num_variables, const InOuts& inputs)
-    : pc_(0), variables_(num_variables), inputs_(inputs), options_(options) {
+    : pc_(0), variables_(num_variables), inputs_(&inputs), options_(options) {
 }
 
 XCVMState::~XCVMState() {
 }
 
+void XCVMState::Reset(const InOuts& inputs) {
+    pc_ = 0;
+    for (nonstd::optional<XCVMVar>& var : variables_) {
+        var.reset();
+    }
+    inputs_ = &inputs;
+    // Keep output entries so `Output` can overwrite them in-place. An
+    // entry still referenced by the caller is detached instead.
+    for (auto& p : outputs_) {
+        if (p.second.use_count() == 1) {
+            *p.second = XCVMVar();
+        } else {
+            p.second.reset();
+        }
+    }
+}
+
 chainerx::Array XCVMState::GetArray(int index) {
     CHECK_LE(0, index) << index;
     CHECK_GT(variables_.size(), index) << index;
-    CHECK(variables_[index].get());
+    CHECK(variables_[index].has_value());
     return variables_[index]->GetArray();
 }
 
@@ -42,52 +63,114 @@ void XCVMState::SetArrayList(const std::vector<int>& index, const std::vector<ch
     for (size_t i = 0; i < index.size(); ++i) SetArray(index[i], vars[i]);
 }
 
+chainerx::Array XCVMState::GetConstant(int64_t offset, const chainerx::Shape& shape, chainerx::Dtype dtype) {
+    CHECK(constants_) << "No constants in the program";
+    CHECK_LE(offset + shape.GetTotalSize() * chainerx::GetItemSize(dtype), constants_size_) << "Constant out of range: " << offset;
+    // Shares the ownership of the whole constants.
+    std::shared_ptr<void> data(constants_, static_cast<char*>(constants_.get()) + offset);
+    return chainerx::FromData(
+            shape, dtype, data, nonstd::nullopt /* strides */, 0 /* offset */, chainerx::GetNativeBackend().GetDevice(0));
+}
+
+bool XCVMState::IsConstant(const chainerx::Array& array) const {
+    if (!constants_) return false;
+    const char* begin = static_cast<const char*>(constants_.get());
+    const char* data = static_cast<const char*>(array.raw_data());
+    return begin <= data && data < begin + constants_size_;
+}
+
+nonstd::optional<chainerx::Array> XCVMState::GetArenaOutput(const XCInstructionProto& inst, int index) {
+    if (index >= inst.output_offsets_size()) return nonstd::nullopt;
+    // Autograd may retain outputs in the arena for backward, which
+    // would be overwritten by later ops sharing the region.
+    if (is_training() || chainerx::IsBackpropRequired(chainerx::GetDefaultContext())) return nonstd::nullopt;
+    const int64_t offset = inst.output_offsets(index);
+    if (offset < 0) return nonstd::nullopt;
+    const XCTypeProto& type = inst.output_types(index);
+    const chainerx::Dtype dtype = static_cast<chainerx::Dtype>(type.dtype());
+    const chainerx::Shape shape(type.shape().begin(), type.shape().end());
+    CHECK_LE(offset + shape.GetTotalSize() * chainerx::GetItemSize(dtype), arena_size_) << inst.DebugString();
+
+    chainerx::Device& device = chainerx::GetDefaultDevice();
+    if (!arena_.has_value() || &arena_->device() != &device) {
+        arena_ = chainerx::Empty({arena_size_}, chainerx::Dtype::kUInt8, device);
+    }
+    return chainerx::FromData(shape, dtype, arena_->data(), nonstd::nullopt /* strides */, offset, device);
+}
+
+nonstd::optional<chainerx::Array> XCVMState::GetOutputBuffer(
+        const XCInstructionProto& inst,
+        std::initializer_list<const chainerx::Array*> inputs,
+        const chainerx::Shape& shape,
+        chainerx::Dtype dtype,
+        chainerx::Device& device) {
+    nonstd::optional<chainerx::Array> out = GetArenaOutput(inst, 0);
+    if (!out.has_value()) {
+        const int index = inst.inplace_input();
+        if (index < 0 || index >= inputs.size()) return nonstd::nullopt;
+        // ChainerX autograd may retain the input (e.g., for Mul) or
+        // the output of its producer (e.g., for Exp) for backward.
+        if (is_training() || chainerx::IsBackpropRequired(chainerx::GetDefaultContext())) return nonstd::nullopt;
+        const chainerx::Array& input = *inputs.begin()[index];
+        // Broadcasted views must not be overwritten.
+        if (!input.IsContiguous()) return nonstd::nullopt;
+        out = input;
+    }
+    if (out->dtype() != dtype || out->shape() != shape || &out->device() != &device) return nonstd::nullopt;
+    return out;
+}
+
 XCVMSequence* XCVMState::CreateSequence(int index) {
     CHECK_LE(0, index) << index;
     CHECK_GT(variables_.size(), index) << index;
-    variables_[index].reset(new XCVMVar(XCVMVar::Kind::kSequence));
+    variables_[index].emplace(XCVMVar::Kind::kSequence);
     return GetSequence(index);
 }
 
 XCVMSequence* XCVMState::GetSequence(int index) {
     CHECK_LE(0, index) << index;
     CHECK_GT(variables_.size(), index) << index;
-    CHECK(variables_[index].get());
+    CHECK(variables_[index].has_value());
     return variables_[index]->GetSequence();
 }
 
 const XCVMOpaque& XCVMState::GetOpaque(int index) {
     CHECK_LE(0, index) << index;
     CHECK_GT(variables_.size(), index) << index;
-    CHECK(variables_[index].get());
+    CHECK(variables_[index].has_value());
     return *variables_[index]->GetOpaque();
 }
 
 void XCVMState::SetOpaque(int index, XCVMOpaque* opaque) {
     CHECK_LE(0, index) << index;
     CHECK_GT(variables_.size(), index) << index;
-    CHECK(!variables_[index].get());
-    variables_[index].reset(new XCVMVar(opaque));
+    CHECK(!variables_[index].has_value());
+    variables_[index].emplace(opaque);
 }
 
 XCVMVar* XCVMState::GetVar(int index) {
     CHECK_LE(0, index) << index;
     CHECK_GT(variables_.size(), index) << index;
-    CHECK(variables_[index].get());
-    return variables_[index].get();
+    CHECK(variables_[index].has_value());
+    return &*variables_[index];
+}
+
+XCVMVar* XCVMState::GetVarOrNull(int index) {
+    if (index < 0 || index >= variables_.size() || !variables_[index].has_value()) return nullptr;
+    return &*variables_[index];
 }
 
 void XCVMState::SetVar(int index, const XCVMVar& var) {
     CHECK_LE(0, index) << index;
     CHECK_GT(variables_.size(), index) << index;
-    CHECK(!variables_[index].get());
-    variables_[index].reset(new XCVMVar(var));
+    CHECK(!variables_[index].has_value());
+    variables_[index].emplace(var);
 }
 
 std::string XCVMState::GetVarString(int index) {
     if (index < 0) return "null";
     CHECK_GT(variables_.size(), index) << index;
-    if (!variables_[index].get()) return "UNSET";
+    if (!variables_[index].has_value()) return "UNSET";
     if (trace_level() > 1 || options_.verbose_ops[(*program_)[pc_]->op()])
         return variables_[index]->DebugString();
     else
@@ -121,31 +204,38 @@ std::string XCVMState::GetVarListString(const std::vector<int>& indices) {
 void XCVMState::SetArray(int index, const chainerx::Array& value) {
     CHECK_LE(0, index) << index;
     CHECK_GT(variables_.size(), index) << index;
-    CHECK(!variables_[index].get());
-    variables_[index].reset(new XCVMVar(value));
+    CHECK(!variables_[index].has_value());
+    variables_[index].emplace(value);
 }
 
 void XCVMState::FreeVar(int index) {
     CHECK_LE(0, index) << index;
     CHECK_GT(variables_.size(), index) << index;
-    CHECK(variables_[index].get()) << index;
+    CHECK(variables_[index].has_value()) << index;
     variables_[index].reset();
 }
 
 void XCVMState::Input(const std::string& name, int index) {
     CHECK_LE(0, index) << index;
     CHECK_GT(variables_.size(), index) << index;
-    CHECK(!variables_[index].get()) << index;
-    auto found = inputs_.find(name);
-    CHECK(found != inputs_.end()) << "Input value not exist: " << name;
-    variables_[index].reset(new XCVMVar(*found->second.get()));
+    CHECK(!variables_[index].has_value()) << index;
+    auto found = inputs_->find(name);
+    CHECK(found != inputs_->end()) << "Input value not exist: " << name;
+    variables_[index].emplace(*found->second);
 }
 
 void XCVMState::Output(const std::string& name, int index) {
     CHECK_LE(0, index) << index;
     CHECK_GT(variables_.size(), index) << index;
-    CHECK(variables_[index].get()) << index;
-    CHECK(outputs_.emplace(name, std::shared_ptr<XCVMVar>(new XCVMVar(*variables_[index]))).second) << "Duplicated output name: " << name;
+    CHECK(variables_[index].has_value()) << index;
+    std::shared_ptr<XCVMVar>& output = outputs_[name];
+    if (output.get()) {
+        // Reuse the entry left by `Reset`.
+        CHECK(output->IsNull()) << "Duplicated output name: " << name;
+        *output = *variables_[index];
+    } else {
+        output.reset(new XCVMVar(*variables_[index]));
+    }
 }
 
 void XCVMState::ReportInvalidInOuts(const std::vector<int>& inputs, const std::vector<int>& outputs) {
@@ -209,8 +299,8 @@ void XCVMState::CheckInfs(const std::vector<int>& inputs, const std::vector<int>
 void XCVMState::ShowVariableStatus() const {
     int64_t total = 0;
     for (size_t i = 0; i < variables_.size(); ++i) {
-        const std::unique_ptr<XCVMVar>& var = variables_[i];
-        if (!var.get()) continue;
+        const nonstd::optional<XCVMVar>& var = variables_[i];
+        if (!var.has_value()) continue;
         int64_t size = var->GetTotalSize();
         total += size;
         std::cerr << "$" << i << ": " << size << std::endl;
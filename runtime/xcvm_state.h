@@ -1,5 +1,7 @@
 #pragma once
 
+#include <initializer_list>
+#include <memory>
 #include <stack>
 #include <string>
 #include <vector>
@@ -20,9 +22,14 @@ class XCVMVar;
 
 class XCVMState {
 public:
+    // `inputs` must outlive the state.
     XCVMState(const XCVMOptions& options, int num_variables, const InOuts& inputs);
     ~XCVMState();
 
+    // Prepares the state for another run with `inputs` without
+    // reallocating variable slots and output entries.
+    void Reset(const InOuts& inputs);
+
     int pc() const {
         return pc_;
     }
@@ -45,8 +52,18 @@ public:
     void SetOpaque(int index, XCVMOpaque* opaque);
 
     XCVMVar* GetVar(int index);
+    // Returns nullptr if `index` is out of range or not set.
+    XCVMVar* GetVarOrNull(int index);
     void SetVar(int index, const XCVMVar& var);
 
+    // Accessors without bounds checks for the release mode.
+    XCVMVar* GetVarUnchecked(int index) {
+        return &*variables_[index];
+    }
+    const chainerx::Array& GetArrayUnchecked(int index) {
+        return variables_[index]->GetArray();
+    }
+
     std::string GetVarString(int index);
     std::string GetVarListString(const std::vector<int>& indices);
 
@@ -79,19 +96,61 @@ public:
 
     void ShowVariableStatus() const;
 
-    void SetProgram(const std::vector<std::unique_ptr<XCVMOp>>* program) {
+    void SetProgram(
+            const std::vector<std::unique_ptr<XCVMOp>>* program,
+            int64_t arena_size,
+            const std::shared_ptr<void>& constants,
+            size_t constants_size) {
         program_ = program;
+        arena_size_ = arena_size;
+        constants_ = constants;
+        constants_size_ = constants_size;
     }
 
+    // Returns a host array of `shape` and `dtype` which shares the
+    // data of BinaryConstant at `offset`. The data is shared by all
+    // runs of the program and may be mapped read-only, so ops which
+    // write to their inputs must copy it first (see `IsConstant`).
+    chainerx::Array GetConstant(int64_t offset, const chainerx::Shape& shape, chainerx::Dtype dtype);
+
+    // Returns true if `array` shares the data returned by `GetConstant`.
+    bool IsConstant(const chainerx::Array& array) const;
+
+    // Returns an array of `shape` and `dtype` on `device` which the
+    // first output of `inst` can be written into without allocation:
+    // either a region of the arena planned by the compiler or the
+    // input of `inst` which dies at `inst`. `inputs` must be in the
+    // order of the inputs of `inst`. Returns nullopt if there is no
+    // such array.
+    nonstd::optional<chainerx::Array> GetOutputBuffer(
+            const XCInstructionProto& inst,
+            std::initializer_list<const chainerx::Array*> inputs,
+            const chainerx::Shape& shape,
+            chainerx::Dtype dtype,
+            chainerx::Device& device);
+
 private:
+    // Returns a view of the arena at the offset planned by the
+    // compiler for the `index`-th output of `inst`, or nullopt if the
+    // output is not planned. The arena is allocated on the first use
+    // and reused by later runs of this state. Never used in training
+    // as values in the arena are overwritten after their last uses.
+    nonstd::optional<chainerx::Array> GetArenaOutput(const XCInstructionProto& inst, int index);
+
     void ReportInvalidInOuts(const std::vector<int>& inputs, const std::vector<int>& outputs);
 
     int pc_;
-    std::vector<std::unique_ptr<XCVMVar>> variables_;
-    InOuts inputs_;
+    // Variables are stored inline so setting and freeing them do not
+    // allocate memory.
+    std::vector<nonstd::optional<XCVMVar>> variables_;
+    const InOuts* inputs_;
     InOuts outputs_;
     XCVMOptions options_;
     const std::vector<std::unique_ptr<XCVMOp>>* program_;
+    int64_t arena_size_{0};
+    nonstd::optional<chainerx::Array> arena_;
+    std::shared_ptr<void> constants_;
+    size_t constants_size_{0};
 };
 
 }  // namespace runtime
@@ -1,16 +1,27 @@
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include <chainerx/array.h>
+#include <chainerx/backprop_mode.h>
+#include <chainerx/backward.h>
 #include <chainerx/context.h>
 #include <chainerx/numeric.h>
 #include <chainerx/routines/creation.h>
+#include <chainerx/routines/math.h>
 #include <chainerx/testing/array.h>
 
 #include <compiler/gen_xcvm_codegen.h>
 #include <runtime/xcvm.h>
 #include <runtime/xcvm.pb.h>
+#include <runtime/xcvm_profiler.h>
+#include <runtime/xcvm_session.h>
 #include <runtime/xcvm_var.h>
 
 namespace chainer_compiler {
@@ -40,6 +51,398 @@ TEST(XCVMTest, Run) {
     EXPECT_TRUE(chainerx::AllClose(e, outputs["out"]->GetArray(), 0, 0));
 }
 
+TEST(XCVMTest, RunInReleaseMode) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    XCProgramProto program;
+    xcvm::AddInOp(&program, 0, "in1");
+    xcvm::AddInOp(&program, 1, "in2");
+    xcvm::AddAddOp(&program, 2, 0, 1);
+    xcvm::AddFreeOp(&program, 0);
+    xcvm::AddIdentityOp(&program, 3, 2);
+    xcvm::AddOutOp(&program, "out", 3);
+
+    XCVM xcvm(program);
+    InOuts inputs;
+    chainerx::Array in1 = chainerx::Eye(2, nonstd::nullopt, nonstd::nullopt, chainerx::Dtype::kFloat32);
+    inputs.emplace("in1", std::shared_ptr<XCVMVar>(new XCVMVar(in1)));
+    inputs.emplace("in2", std::shared_ptr<XCVMVar>(new XCVMVar(chainerx::OnesLike(in1))));
+    XCVMOptions options;
+    options.release_mode = true;
+    InOuts outputs = xcvm.Run(inputs, options);
+    ASSERT_EQ(1, outputs.count("out"));
+    chainerx::Array e = chainerx::testing::BuildArray({2, 2}).WithData<float>({2, 1, 1, 2});
+    EXPECT_TRUE(chainerx::AllClose(e, outputs["out"]->GetArray(), 0, 0));
+}
+
+TEST(XCVMTest, RunInParallel) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    XCProgramProto program;
+    xcvm::AddInOp(&program, 0, "in1");
+    xcvm::AddInOp(&program, 1, "in2");
+    // Two independent branches which read the same inputs.
+    xcvm::AddAddOp(&program, 2, 0, 1);
+    xcvm::AddMulOp(&program, 3, 0, 1);
+    xcvm::AddFreeOp(&program, 0);
+    xcvm::AddFreeOp(&program, 1);
+    xcvm::AddAddOp(&program, 4, 2, 3);
+    xcvm::AddFreeOp(&program, 2);
+    xcvm::AddFreeOp(&program, 3);
+    xcvm::AddOutOp(&program, "out", 4);
+
+    XCVM xcvm(program);
+    InOuts inputs;
+    chainerx::Array in1 = chainerx::Eye(2, nonstd::nullopt, nonstd::nullopt, chainerx::Dtype::kFloat32);
+    inputs.emplace("in1", std::shared_ptr<XCVMVar>(new XCVMVar(in1)));
+    inputs.emplace("in2", std::shared_ptr<XCVMVar>(new XCVMVar(chainerx::OnesLike(in1))));
+    XCVMOptions options;
+    options.release_mode = true;
+    options.num_threads = 4;
+    for (int i = 0; i < 10; ++i) {
+        InOuts outputs = xcvm.Run(inputs, options);
+        ASSERT_EQ(1, outputs.count("out"));
+        chainerx::Array e = chainerx::testing::BuildArray({2, 2}).WithData<float>({3, 1, 1, 3});
+        EXPECT_TRUE(chainerx::AllClose(e, outputs["out"]->GetArray(), 0, 0));
+    }
+}
+
+// in1 + ((in1 + in2) * in2 - in2), where Sub reuses the arena region
+// of the sum.
+XCProgramProto MakeArenaProgram() {
+    XCProgramProto program;
+    auto plan = [&program](int64_t offset) {
+        XCInstructionProto* inst = program.mutable_instructions(program.instructions_size() - 1);
+        XCTypeProto* type = inst->mutable_output_types(0);
+        type->set_dtype(static_cast<int>(chainerx::Dtype::kFloat32));
+        type->add_shape(2);
+        type->add_shape(2);
+        inst->add_output_offsets(offset);
+    };
+    xcvm::AddInOp(&program, 0, "in1");
+    xcvm::AddInOp(&program, 1, "in2");
+    xcvm::AddAddOp(&program, 2, 0, 1);
+    plan(0);
+    xcvm::AddMulOp(&program, 3, 2, 1);
+    plan(256);
+    xcvm::AddFreeOp(&program, 2);
+    // Reuses the region of the freed value.
+    xcvm::AddSubOp(&program, 4, 3, 1);
+    plan(0);
+    xcvm::AddFreeOp(&program, 3);
+    xcvm::AddAddOp(&program, 5, 4, 0);
+    xcvm::AddOutOp(&program, "out", 5);
+    program.set_arena_size(512);
+    return program;
+}
+
+TEST(XCVMTest, ArenaOutputs) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+    chainerx::NoBackpropModeScope no_backprop;
+
+    XCVM xcvm(MakeArenaProgram());
+    InOuts inputs;
+    chainerx::Array in1 = chainerx::Eye(2, nonstd::nullopt, nonstd::nullopt, chainerx::Dtype::kFloat32);
+    inputs.emplace("in1", std::shared_ptr<XCVMVar>(new XCVMVar(in1)));
+    inputs.emplace("in2", std::shared_ptr<XCVMVar>(new XCVMVar(chainerx::OnesLike(in1))));
+    chainerx::Array e = chainerx::testing::BuildArray({2, 2}).WithData<float>({2, 0, 0, 2});
+    for (bool release_mode : {false, true}) {
+        XCVMOptions options;
+        options.release_mode = release_mode;
+        InOuts outputs = xcvm.Run(inputs, options);
+        ASSERT_EQ(1, outputs.count("out"));
+        EXPECT_TRUE(chainerx::AllClose(e, outputs["out"]->GetArray(), 0, 0));
+    }
+}
+
+TEST(XCVMTest, ArenaOutputsWithBackprop) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    XCVM xcvm(MakeArenaProgram());
+    InOuts inputs;
+    chainerx::Array in1 = chainerx::Eye(2, nonstd::nullopt, nonstd::nullopt, chainerx::Dtype::kFloat32);
+    chainerx::Array in2 = chainerx::OnesLike(in1);
+    in2.RequireGrad();
+    inputs.emplace("in1", std::shared_ptr<XCVMVar>(new XCVMVar(in1)));
+    inputs.emplace("in2", std::shared_ptr<XCVMVar>(new XCVMVar(in2)));
+    InOuts outputs = xcvm.Run(inputs, XCVMOptions());
+    ASSERT_EQ(1, outputs.count("out"));
+    chainerx::Backward(outputs["out"]->GetArray());
+
+    // The gradient is in1 + 2 * in2 - 1, which needs the sum retained
+    // by Mul.
+    ASSERT_TRUE(in2.GetGrad().has_value());
+    chainerx::Array e = chainerx::testing::BuildArray({2, 2}).WithData<float>({2, 1, 1, 2});
+    EXPECT_TRUE(chainerx::AllClose(e, *in2.GetGrad(), 0, 0));
+}
+
+TEST(XCVMTest, InplaceInput) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    XCProgramProto program;
+    xcvm::AddInOp(&program, 0, "in1");
+    xcvm::AddInOp(&program, 1, "in2");
+    xcvm::AddAddOp(&program, 2, 0, 0);
+    xcvm::AddSubOp(&program, 3, 2, 1);
+    program.mutable_instructions(program.instructions_size() - 1)->set_inplace_input(0);
+    xcvm::AddFreeOp(&program, 2);
+    xcvm::AddReluOp(&program, 4, 3);
+    program.mutable_instructions(program.instructions_size() - 1)->set_inplace_input(0);
+    xcvm::AddFreeOp(&program, 3);
+    xcvm::AddOutOp(&program, "out", 4);
+
+    XCVM xcvm(program);
+    InOuts inputs;
+    chainerx::Array in1 = chainerx::Eye(2, nonstd::nullopt, nonstd::nullopt, chainerx::Dtype::kFloat32);
+    chainerx::Array in2 = chainerx::OnesLike(in1);
+    inputs.emplace("in1", std::shared_ptr<XCVMVar>(new XCVMVar(in1)));
+    inputs.emplace("in2", std::shared_ptr<XCVMVar>(new XCVMVar(in2)));
+    InOuts outputs = xcvm.Run(inputs, XCVMOptions());
+    ASSERT_EQ(1, outputs.count("out"));
+    chainerx::Array e = chainerx::testing::BuildArray({2, 2}).WithData<float>({1, 0, 0, 1});
+    EXPECT_TRUE(chainerx::AllClose(e, outputs["out"]->GetArray(), 0, 0));
+    // Inputs of the program are never overwritten.
+    EXPECT_TRUE(chainerx::AllClose(chainerx::OnesLike(in1), in2, 0, 0));
+}
+
+TEST(XCVMTest, BinaryConstant) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    const std::vector<float> data = {1, 2, 3, 4};
+    std::string constants(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(float));
+    XCProgramProto program;
+    xcvm::AddBinaryConstantOp(&program, 0, 0, static_cast<int>(chainerx::Dtype::kFloat32), {2, 1}, false);
+    xcvm::AddBinaryConstantOp(&program, 1, 8, static_cast<int>(chainerx::Dtype::kFloat32), {2}, true);
+    xcvm::AddAddOp(&program, 2, 0, 1);
+    xcvm::AddOutOp(&program, "out", 2);
+
+    const std::string filename = "/tmp/xcvm_test_binary_constant.constants";
+    {
+        std::ofstream ofs(filename, std::ios::binary);
+        ofs << constants;
+    }
+    chainerx::Array e = chainerx::testing::BuildArray({2, 2}).WithData<float>({4, 5, 5, 6});
+    for (bool use_file : {false, true}) {
+        XCProgramProto prog = program;
+        if (use_file) {
+            prog.set_constants_file(filename);
+        } else {
+            prog.set_constants(constants);
+        }
+        XCVM xcvm(prog);
+        InOuts outputs = xcvm.Run({}, XCVMOptions());
+        ASSERT_EQ(1, outputs.count("out"));
+        EXPECT_TRUE(chainerx::AllClose(e, outputs["out"]->GetArray(), 0, 0));
+    }
+    std::remove(filename.c_str());
+}
+
+TEST(XCVMTest, ResolveConstantsFile) {
+    XCProgramProto program;
+    ResolveConstantsFile("dir/model.xcvm", &program);
+    EXPECT_FALSE(program.has_constants_file());
+
+    program.set_constants_file("model.xcvm.constants");
+    ResolveConstantsFile("dir/model.xcvm", &program);
+    EXPECT_EQ("dir/model.xcvm.constants", program.constants_file());
+
+    program.set_constants_file("/abs/model.xcvm.constants");
+    ResolveConstantsFile("dir/model.xcvm", &program);
+    EXPECT_EQ("/abs/model.xcvm.constants", program.constants_file());
+
+    program.set_constants_file("model.xcvm.constants");
+    ResolveConstantsFile("model.xcvm", &program);
+    EXPECT_EQ("./model.xcvm.constants", program.constants_file());
+}
+
+TEST(XCVMTest, Session) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    XCProgramProto program;
+    xcvm::AddInOp(&program, 0, "in1");
+    xcvm::AddInOp(&program, 1, "in2");
+    xcvm::AddAddOp(&program, 2, 0, 1);
+    xcvm::AddFreeOp(&program, 0);
+    xcvm::AddFreeOp(&program, 1);
+    xcvm::AddOutOp(&program, "out", 2);
+    xcvm::AddFreeOp(&program, 2);
+
+    XCVM xcvm(program);
+    XCVMSession session(&xcvm, XCVMOptions());
+    chainerx::Array in1 = chainerx::Eye(2, nonstd::nullopt, nonstd::nullopt, chainerx::Dtype::kFloat32);
+
+    InOuts inputs;
+    inputs.emplace("in1", std::shared_ptr<XCVMVar>(new XCVMVar(in1)));
+    inputs.emplace("in2", std::shared_ptr<XCVMVar>(new XCVMVar(chainerx::OnesLike(in1))));
+    std::shared_ptr<XCVMVar> first = session.Run(inputs).at("out");
+    chainerx::Array e = chainerx::testing::BuildArray({2, 2}).WithData<float>({2, 1, 1, 2});
+    EXPECT_TRUE(chainerx::AllClose(e, first->GetArray(), 0, 0));
+
+    inputs["in2"].reset(new XCVMVar(in1));
+    const InOuts& outputs = session.Run(inputs);
+    ASSERT_EQ(1, outputs.size());
+    e = chainerx::testing::BuildArray({2, 2}).WithData<float>({2, 0, 0, 2});
+    EXPECT_TRUE(chainerx::AllClose(e, outputs.at("out")->GetArray(), 0, 0));
+    // The output of the first run is kept by the caller.
+    e = chainerx::testing::BuildArray({2, 2}).WithData<float>({2, 1, 1, 2});
+    EXPECT_TRUE(chainerx::AllClose(e, first->GetArray(), 0, 0));
+}
+
+TEST(XCVMTest, ConcurrentRun) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    XCProgramProto program;
+    xcvm::AddInOp(&program, 0, "in1");
+    xcvm::AddInOp(&program, 1, "in2");
+    xcvm::AddAddOp(&program, 2, 0, 1);
+    xcvm::AddMulOp(&program, 3, 0, 1);
+    xcvm::AddFreeOp(&program, 0);
+    xcvm::AddFreeOp(&program, 1);
+    xcvm::AddAddOp(&program, 4, 2, 3);
+    xcvm::AddFreeOp(&program, 2);
+    xcvm::AddFreeOp(&program, 3);
+    xcvm::AddOutOp(&program, "out", 4);
+    xcvm::AddFreeOp(&program, 4);
+
+    XCVM xcvm(program);
+    const int kNumThreads = 8;
+    const int kNumIterations = 100;
+    chainerx::Array eye = chainerx::Eye(2, nonstd::nullopt, nonstd::nullopt, chainerx::Dtype::kFloat32);
+    std::vector<InOuts> inputs(kNumThreads);
+    std::vector<chainerx::Array> expected;
+    for (int i = 0; i < kNumThreads; ++i) {
+        chainerx::Array in1 = eye * chainerx::Scalar(static_cast<float>(i));
+        inputs[i].emplace("in1", std::shared_ptr<XCVMVar>(new XCVMVar(in1)));
+        inputs[i].emplace("in2", std::shared_ptr<XCVMVar>(new XCVMVar(chainerx::OnesLike(in1))));
+        expected.push_back(in1 * chainerx::Scalar(2.0f) + chainerx::OnesLike(in1));
+    }
+
+    // Each thread has its own state and keeps all of its outputs.
+    std::vector<std::vector<std::shared_ptr<XCVMVar>>> outputs(kNumThreads);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kNumThreads; ++i) {
+        threads.emplace_back([&xcvm, &inputs, &outputs, i, kNumIterations]() {
+            XCVMOptions options;
+            options.release_mode = i % 2 == 0;
+            options.num_threads = i % 4 == 0 ? 2 : 1;
+            XCVMSession session(&xcvm, options);
+            for (int j = 0; j < kNumIterations; ++j) {
+                outputs[i].push_back(session.Run(inputs[i]).at("out"));
+            }
+        });
+    }
+    for (std::thread& th : threads) th.join();
+
+    for (int i = 0; i < kNumThreads; ++i) {
+        ASSERT_EQ(kNumIterations, outputs[i].size());
+        for (const std::shared_ptr<XCVMVar>& output : outputs[i]) {
+            EXPECT_TRUE(chainerx::AllClose(expected[i], output->GetArray(), 0, 0));
+        }
+    }
+}
+
+TEST(XCVMTest, ElementWiseCpu) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    // Registers: 0 and 1 are inputs, 2 is a constant and the rest are
+    // temporary values. Outputs are (in1 * in2 + 0.5) and its tanh.
+    const std::vector<int64_t> code = {
+            XCInstructionProto::Mul, 3, 0, 1, XCInstructionProto::Add, 4, 3, 2, XCInstructionProto::Tanh, 5, 4, -1};
+    XCProgramProto program;
+    xcvm::AddInOp(&program, 0, "in1");
+    xcvm::AddInOp(&program, 1, "in2");
+    xcvm::AddElementWiseCpuOp(&program, {2, 3}, {0, 1}, code, {0.5}, {4, 5}, 1);
+    xcvm::AddOutOp(&program, "out1", 2);
+    xcvm::AddOutOp(&program, "out2", 3);
+
+    XCVM xcvm(program);
+    // More elements than a chunk, and a broadcasted input.
+    InOuts inputs;
+    inputs.emplace("in1", std::shared_ptr<XCVMVar>(new XCVMVar(chainerx::Ones({3, 300}, chainerx::Dtype::kFloat32))));
+    inputs.emplace("in2", std::shared_ptr<XCVMVar>(new XCVMVar(chainerx::Full({300}, 2.0f, chainerx::Dtype::kFloat32))));
+    InOuts outputs = xcvm.Run(inputs, XCVMOptions());
+    ASSERT_EQ(1, outputs.count("out1"));
+    ASSERT_EQ(1, outputs.count("out2"));
+    chainerx::Array e = chainerx::Full({3, 300}, 2.5f, chainerx::Dtype::kFloat32);
+    EXPECT_TRUE(chainerx::AllClose(e, outputs["out1"]->GetArray(), 0, 0));
+    EXPECT_TRUE(chainerx::AllClose(chainerx::Tanh(e), outputs["out2"]->GetArray(), 1e-6, 1e-6));
+}
+
+TEST(XCVMTest, ElementWiseCpuReduction) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    // Computes ReduceMean(in1 + in2, axes=[-1], keepdims=1) where in2
+    // is a bias.
+    const std::vector<int64_t> code = {XCInstructionProto::Add, 2, 0, 1, XCInstructionProto::ReduceMean, 3, 2, 1};
+    XCProgramProto program;
+    xcvm::AddInOp(&program, 0, "in1");
+    xcvm::AddInOp(&program, 1, "in2");
+    xcvm::AddElementWiseCpuOp(&program, {2}, {0, 1}, code, {}, {3}, 1);
+    xcvm::AddOutOp(&program, "out", 2);
+
+    XCVM xcvm(program);
+    InOuts inputs;
+    inputs.emplace("in1", std::shared_ptr<XCVMVar>(new XCVMVar(chainerx::Ones({2, 300}, chainerx::Dtype::kFloat32))));
+    inputs.emplace("in2", std::shared_ptr<XCVMVar>(new XCVMVar(chainerx::Full({300}, 2.0f, chainerx::Dtype::kFloat32))));
+    InOuts outputs = xcvm.Run(inputs, XCVMOptions());
+    ASSERT_EQ(1, outputs.count("out"));
+    chainerx::Array e = chainerx::Full({2, 1}, 3.0f, chainerx::Dtype::kFloat32);
+    EXPECT_TRUE(chainerx::AllClose(e, outputs["out"]->GetArray(), 1e-6, 1e-6));
+}
+
+TEST(XCVMTest, Profiler) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    XCProgramProto program;
+    xcvm::AddInOp(&program, 0, "a");
+    xcvm::AddInOp(&program, 1, "b");
+    xcvm::AddMatMulOp(&program, 2, 0, 1);
+    xcvm::AddReluOp(&program, 3, 2);
+    xcvm::AddOutOp(&program, "out", 3);
+
+    XCVM xcvm(program);
+    InOuts inputs;
+    inputs.emplace("a", std::shared_ptr<XCVMVar>(new XCVMVar(chainerx::Ones({2, 3}, chainerx::Dtype::kFloat32))));
+    inputs.emplace("b", std::shared_ptr<XCVMVar>(new XCVMVar(chainerx::Ones({3, 4}, chainerx::Dtype::kFloat32))));
+    XCVMProfiler profiler;
+    XCVMOptions options;
+    options.profiler = &profiler;
+    xcvm.Run(inputs, options);
+    xcvm.Run(inputs, options);
+
+    std::ostringstream oss;
+    profiler.Report(oss);
+    EXPECT_NE(std::string::npos, oss.str().find("MatMul")) << oss.str();
+    EXPECT_NE(std::string::npos, oss.str().find("Relu")) << oss.str();
+
+    const std::string csv_filename = "/tmp/xcvm_profiler_test.csv";
+    profiler.EmitCSV(csv_filename);
+    std::ifstream ifs(csv_filename);
+    std::remove(csv_filename.c_str());
+    std::string line;
+    bool found_matmul = false;
+    while (std::getline(ifs, line)) {
+        // 2 * (2 * 4) * 3 FLOPs and (6 + 12 + 8) * 4 bytes per run.
+        if (line.find("op,MatMul,") == 0) {
+            EXPECT_EQ("op,MatMul,-1,2,", line.substr(0, 15));
+            EXPECT_NE(std::string::npos, line.find(",96,208")) << line;
+            found_matmul = true;
+        }
+    }
+    EXPECT_TRUE(found_matmul);
+}
+
 }  // namespace
 }  // namespace runtime
 }  // namespace chainer_compiler
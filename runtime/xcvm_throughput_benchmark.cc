@@ -0,0 +1,102 @@
+// Measures how the throughput of one shared XCVM scales with the
+// number of threads which run requests concurrently.
+//
+// Usage: xcvm_throughput_benchmark [max_threads] [requests_per_thread] [size]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <chainerx/array.h>
+#include <chainerx/context.h>
+#include <chainerx/routines/creation.h>
+
+#include <compiler/gen_xcvm_codegen.h>
+#include <runtime/xcvm.h>
+#include <runtime/xcvm.pb.h>
+#include <runtime/xcvm_session.h>
+#include <runtime/xcvm_var.h>
+
+namespace chainer_compiler {
+namespace runtime {
+namespace {
+
+// Builds a small MLP-like program: repeated MatMul and Relu.
+void BuildProgram(XCProgramProto* program) {
+    xcvm::AddInOp(program, 1, "in");
+    xcvm::AddInOp(program, 2, "w");
+    int cur = 1;
+    int next = 3;
+    for (int i = 0; i < 8; ++i) {
+        int h = next++;
+        xcvm::AddMatMulOp(program, h, cur, 2);
+        if (cur != 1) xcvm::AddFreeOp(program, cur);
+        int y = next++;
+        xcvm::AddReluOp(program, y, h);
+        xcvm::AddFreeOp(program, h);
+        cur = y;
+    }
+    xcvm::AddOutOp(program, "out", cur);
+    xcvm::AddFreeOp(program, cur);
+    xcvm::AddFreeOp(program, 1);
+    xcvm::AddFreeOp(program, 2);
+}
+
+double MeasureRequestsPerSec(XCVM* xcvm, const InOuts& inputs, int num_threads, int requests_per_thread) {
+    XCVMOptions options;
+    options.release_mode = true;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back([xcvm, &inputs, &options, requests_per_thread]() {
+            XCVMSession session(xcvm, options);
+            for (int j = 0; j < requests_per_thread; ++j) {
+                session.Run(inputs);
+            }
+        });
+    }
+    for (std::thread& th : threads) th.join();
+    auto end = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    return num_threads * requests_per_thread / (elapsed * 1e-9);
+}
+
+void RunBenchmark(int argc, char** argv) {
+    int max_threads = argc > 1 ? std::atoi(argv[1]) : std::thread::hardware_concurrency();
+    int requests_per_thread = argc > 2 ? std::atoi(argv[2]) : 100;
+    int size = argc > 3 ? std::atoi(argv[3]) : 128;
+
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    XCProgramProto program;
+    BuildProgram(&program);
+    XCVM xcvm(program);
+
+    InOuts inputs;
+    chainerx::Array x = chainerx::Ones({size, size}, chainerx::Dtype::kFloat32);
+    chainerx::Array w = chainerx::Eye(size, nonstd::nullopt, nonstd::nullopt, chainerx::Dtype::kFloat32);
+    inputs.emplace("in", std::shared_ptr<XCVMVar>(new XCVMVar(x)));
+    inputs.emplace("w", std::shared_ptr<XCVMVar>(new XCVMVar(w)));
+
+    // Warm up.
+    MeasureRequestsPerSec(&xcvm, inputs, 1, 1);
+
+    double base_rps = 0;
+    for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+        double rps = MeasureRequestsPerSec(&xcvm, inputs, num_threads, requests_per_thread);
+        if (num_threads == 1) base_rps = rps;
+        std::cout << "Threads: " << num_threads << " " << rps << " requests/sec (x" << rps / base_rps << ")" << std::endl;
+    }
+}
+
+}  // namespace
+}  // namespace runtime
+}  // namespace chainer_compiler
+
+int main(int argc, char** argv) {
+    chainer_compiler::runtime::RunBenchmark(argc, argv);
+}
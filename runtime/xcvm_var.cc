@@ -13,14 +13,95 @@ XCVMVar::XCVMVar(Kind kind) : kind_(kind) {
     CHECK_NE(kind_, Kind::kArray);
     CHECK_NE(kind_, Kind::kOpaque);
     if (kind_ == Kind::kSequence) {
-        sequence_.reset(new XCVMSequence());
+        new (&sequence_) std::shared_ptr<XCVMSequence>(new XCVMSequence());
     }
 }
 
-XCVMVar::XCVMVar(chainerx::Array array) : kind_(Kind::kArray), array_(array) {
+XCVMVar::XCVMVar(chainerx::Array array) : kind_(Kind::kArray) {
+    new (&array_) chainerx::Array(std::move(array));
 }
 
-XCVMVar::XCVMVar(XCVMOpaque* opaque) : kind_(Kind::kOpaque), opaque_(opaque) {
+XCVMVar::XCVMVar(XCVMOpaque* opaque) : kind_(Kind::kOpaque) {
+    new (&opaque_) std::shared_ptr<XCVMOpaque>(opaque);
+}
+
+XCVMVar::XCVMVar(const XCVMVar& var) : kind_(Kind::kNull) {
+    CopyFrom(var);
+}
+
+XCVMVar::XCVMVar(XCVMVar&& var) noexcept : kind_(Kind::kNull) {
+    MoveFrom(std::move(var));
+}
+
+XCVMVar::~XCVMVar() {
+    Clear();
+}
+
+XCVMVar& XCVMVar::operator=(const XCVMVar& var) {
+    // `var` may be owned by `this` (e.g., an element of a sequence).
+    XCVMVar tmp(var);
+    Clear();
+    MoveFrom(std::move(tmp));
+    return *this;
+}
+
+XCVMVar& XCVMVar::operator=(XCVMVar&& var) noexcept {
+    XCVMVar tmp(std::move(var));
+    Clear();
+    MoveFrom(std::move(tmp));
+    return *this;
+}
+
+void XCVMVar::CopyFrom(const XCVMVar& var) {
+    switch (var.kind_) {
+        case Kind::kArray:
+            new (&array_) chainerx::Array(var.array_);
+            break;
+        case Kind::kSequence:
+            new (&sequence_) std::shared_ptr<XCVMSequence>(var.sequence_);
+            break;
+        case Kind::kOpaque:
+            new (&opaque_) std::shared_ptr<XCVMOpaque>(var.opaque_);
+            break;
+        case Kind::kNull:
+            break;
+    }
+    kind_ = var.kind_;
+}
+
+void XCVMVar::MoveFrom(XCVMVar&& var) {
+    switch (var.kind_) {
+        case Kind::kArray:
+            new (&array_) chainerx::Array(std::move(var.array_));
+            break;
+        case Kind::kSequence:
+            new (&sequence_) std::shared_ptr<XCVMSequence>(std::move(var.sequence_));
+            break;
+        case Kind::kOpaque:
+            new (&opaque_) std::shared_ptr<XCVMOpaque>(std::move(var.opaque_));
+            break;
+        case Kind::kNull:
+            break;
+    }
+    kind_ = var.kind_;
+    var.Clear();
+}
+
+void XCVMVar::Clear() {
+    switch (kind_) {
+        case Kind::kArray:
+            array_.~Array();
+            break;
+        case Kind::kSequence:
+            sequence_.~shared_ptr<XCVMSequence>();
+            break;
+        case Kind::kOpaque:
+            opaque_.~shared_ptr<XCVMOpaque>();
+            break;
+        case Kind::kNull:
+            break;
+    }
+    kind_ = Kind::kNull;
 }
 
 const chainerx::Array& XCVMVar::GetArray() const {
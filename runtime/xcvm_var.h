@@ -40,7 +40,12 @@ public:
     explicit XCVMVar(chainerx::Array array);
     // Takes the ownership of `opaque`.
     explicit XCVMVar(XCVMOpaque* opaque);
-    explicit XCVMVar(const XCVMVar&) = default;
+    explicit XCVMVar(const XCVMVar& var);
+    XCVMVar(XCVMVar&& var) noexcept;
+    ~XCVMVar();
+
+    XCVMVar& operator=(const XCVMVar& var);
+    XCVMVar& operator=(XCVMVar&& var) noexcept;
 
     const chainerx::Array& GetArray() const;
     XCVMSequence* GetSequence() const;
@@ -61,10 +66,19 @@ public:
     std::string DebugString() const;
 
 private:
+    // These expect `this` holds no value.
+    void CopyFrom(const XCVMVar& var);
+    void MoveFrom(XCVMVar&& var);
+    // Destructs the held value and makes `this` a null value.
+    void Clear();
+
     Kind kind_;
-    chainerx::Array array_;
-    std::shared_ptr<XCVMSequence> sequence_;
-    std::shared_ptr<XCVMOpaque> opaque_;
+    // Only the member which corresponds to `kind_` is alive.
+    union {
+        chainerx::Array array_;
+        std::shared_ptr<XCVMSequence> sequence_;
+        std::shared_ptr<XCVMOpaque> opaque_;
+    };
 };
 
 std::vector<chainerx::Array> NonOptional(const XCVMSequence& seq);
@@ -0,0 +1,223 @@
+#include "tools/batching_server.h"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+
+#include <chainerx/array.h>
+#include <chainerx/backprop_mode.h>
+#include <chainerx/context.h>
+#include <chainerx/device.h>
+#include <chainerx/routines/manipulation.h>
+
+#include <common/log.h>
+#include <runtime/chainerx_util.h>
+#include <runtime/xcvm_var.h>
+
+namespace chainer_compiler {
+namespace runtime {
+
+namespace {
+
+// Returns true if arrays of `a` and `b` can be concatenated.
+bool AreBatchable(const InOuts& a, const InOuts& b) {
+    if (a.size() != b.size()) return false;
+    for (auto ia = a.begin(), ib = b.begin(); ia != a.end(); ++ia, ++ib) {
+        if (ia->first != ib->first) return false;
+        const chainerx::Array& x = ia->second->GetArray();
+        const chainerx::Array& y = ib->second->GetArray();
+        if (x.dtype() != y.dtype() || x.ndim() != y.ndim()) return false;
+        if (!std::equal(x.shape().begin() + 1, x.shape().end(), y.shape().begin() + 1)) return false;
+    }
+    return true;
+}
+
+double Percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t index = std::min(values.size() - 1, static_cast<size_t>(values.size() * p));
+    return values[index];
+}
+
+double Mean(const std::vector<double>& values) {
+    if (values.empty()) return 0;
+    double sum = 0;
+    for (double v : values) sum += v;
+    return sum / values.size();
+}
+
+}  // namespace
+
+BatchingServer::BatchingServer(const RunFn& run_fn, int max_batch_size, int64_t batch_timeout_usec)
+    : run_fn_(run_fn), max_batch_size_(max_batch_size), batch_timeout_(batch_timeout_usec) {
+    CHECK_LT(0, max_batch_size);
+    // The default device and the backprop mode are thread local in
+    // ChainerX. The batching thread inherits them from this thread.
+    chainerx::Context* context = &chainerx::GetDefaultContext();
+    chainerx::Device* device = &chainerx::GetDefaultDevice();
+    const bool is_backprop_required = chainerx::IsBackpropRequired(*context);
+    thread_ = std::thread([this, context, device, is_backprop_required]() {
+        chainerx::SetDefaultContext(context);
+        chainerx::SetDefaultDevice(device);
+        std::unique_ptr<chainerx::NoBackpropModeScope> no_backprop;
+        if (!is_backprop_required) no_backprop.reset(new chainerx::NoBackpropModeScope());
+        Loop();
+    });
+}
+
+BatchingServer::~BatchingServer() {
+    {
+        std::unique_lock<std::mutex> lock{mu_};
+        should_finish_ = true;
+    }
+    cond_.notify_all();
+    thread_.join();
+}
+
+InOuts BatchingServer::Run(const InOuts& inputs) {
+    if (inputs.empty()) throw std::invalid_argument("No inputs");
+    std::unique_ptr<Request> request(new Request());
+    request->inputs = inputs;
+    request->num_rows = -1;
+    for (const auto& p : inputs) {
+        if (p.second->kind() != XCVMVar::Kind::kArray) throw std::invalid_argument("Only arrays can be batched: " + p.first);
+        const chainerx::Array& a = p.second->GetArray();
+        if (a.ndim() == 0) throw std::invalid_argument("Inputs must have the batch dimension: " + p.first);
+        if (request->num_rows < 0) request->num_rows = a.shape()[0];
+        if (request->num_rows != a.shape()[0]) throw std::invalid_argument("Inconsistent batch size: " + p.first);
+    }
+    request->arrival = Clock::now();
+    std::future<InOuts> future = request->outputs.get_future();
+    const Clock::time_point arrival = request->arrival;
+
+    {
+        std::unique_lock<std::mutex> lock{mu_};
+        queue_.push_back(std::move(request));
+    }
+    cond_.notify_all();
+
+    InOuts outputs = future.get();
+    double latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - arrival).count();
+    std::unique_lock<std::mutex> lock{stats_mu_};
+    latencies_usec_.push_back(latency);
+    return outputs;
+}
+
+void BatchingServer::Loop() {
+    while (true) {
+        std::vector<std::unique_ptr<Request>> batch;
+        {
+            std::unique_lock<std::mutex> lock{mu_};
+            cond_.wait(lock, [this]() { return should_finish_ || !queue_.empty(); });
+            if (queue_.empty()) break;
+
+            // Wait for more requests until the deadline of the oldest one.
+            const Clock::time_point deadline = queue_.front()->arrival + batch_timeout_;
+            while (!should_finish_) {
+                int64_t num_rows = 0;
+                for (const std::unique_ptr<Request>& request : queue_) num_rows += request->num_rows;
+                if (num_rows >= max_batch_size_) break;
+                if (cond_.wait_until(lock, deadline) == std::cv_status::timeout) break;
+            }
+            TakeBatch(&batch);
+        }
+        RunBatch(batch);
+    }
+}
+
+void BatchingServer::TakeBatch(std::vector<std::unique_ptr<Request>>* batch) {
+    // Take the oldest request even if it alone exceeds the limit.
+    int64_t num_rows = queue_.front()->num_rows;
+    batch->push_back(std::move(queue_.front()));
+    queue_.pop_front();
+    // Later requests which cannot be merged stay in the queue in order.
+    for (auto iter = queue_.begin(); iter != queue_.end();) {
+        Request* request = iter->get();
+        if (num_rows + request->num_rows > max_batch_size_) break;
+        if (!AreBatchable(batch->front()->inputs, request->inputs)) {
+            ++iter;
+            continue;
+        }
+        num_rows += request->num_rows;
+        batch->push_back(std::move(*iter));
+        iter = queue_.erase(iter);
+    }
+}
+
+void BatchingServer::RunBatch(const std::vector<std::unique_ptr<Request>>& batch) {
+    const Clock::time_point start = Clock::now();
+    int64_t num_rows = 0;
+    {
+        std::unique_lock<std::mutex> lock{stats_mu_};
+        for (const std::unique_ptr<Request>& request : batch) {
+            queueing_delays_usec_.push_back(std::chrono::duration_cast<std::chrono::microseconds>(start - request->arrival).count());
+            num_rows += request->num_rows;
+        }
+        ++batch_size_histogram_[num_rows];
+    }
+
+    try {
+        if (batch.size() == 1) {
+            batch[0]->outputs.set_value(run_fn_(batch[0]->inputs));
+            return;
+        }
+
+        InOuts inputs;
+        for (const auto& p : batch[0]->inputs) {
+            std::vector<chainerx::Array> arrays;
+            for (const std::unique_ptr<Request>& request : batch) {
+                arrays.push_back(request->inputs.at(p.first)->GetArray());
+            }
+            inputs.emplace(p.first, std::make_shared<XCVMVar>(chainerx::Concatenate(arrays, 0)));
+        }
+
+        InOuts outputs = run_fn_(inputs);
+
+        std::vector<int64_t> lengths;
+        for (const std::unique_ptr<Request>& request : batch) lengths.push_back(request->num_rows);
+        std::vector<InOuts> scattered(batch.size());
+        for (const auto& p : outputs) {
+            if (p.second->kind() != XCVMVar::Kind::kArray) throw std::runtime_error("Only array outputs can be scattered: " + p.first);
+            const chainerx::Array& a = p.second->GetArray();
+            if (a.ndim() == 0 || a.shape()[0] != num_rows) throw std::runtime_error("Unexpected batch size of output: " + p.first);
+            std::vector<chainerx::Array> splitted = SplitByLengths(a, 0, lengths);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                scattered[i].emplace(p.first, std::make_shared<XCVMVar>(splitted[i]));
+            }
+        }
+        for (size_t i = 0; i < batch.size(); ++i) {
+            batch[i]->outputs.set_value(scattered[i]);
+        }
+    } catch (...) {
+        std::exception_ptr error = std::current_exception();
+        for (const std::unique_ptr<Request>& request : batch) {
+            try {
+                request->outputs.set_exception(error);
+            } catch (const std::future_error&) {
+                // The outputs were already set.
+            }
+        }
+    }
+}
+
+void BatchingServer::ReportStats(std::ostream& os) {
+    std::unique_lock<std::mutex> lock{stats_mu_};
+    num_reported_requests_ += latencies_usec_.size();
+    os << "Requests: " << latencies_usec_.size() << " (total " << num_reported_requests_ << ")" << std::endl;
+    os << "Queueing delay: mean=" << Mean(queueing_delays_usec_) << "usec p50=" << Percentile(queueing_delays_usec_, 0.5)
+       << "usec p99=" << Percentile(queueing_delays_usec_, 0.99) << "usec" << std::endl;
+    os << "Latency: p50=" << Percentile(latencies_usec_, 0.5) << "usec p99=" << Percentile(latencies_usec_, 0.99) << "usec"
+       << std::endl;
+    os << "Batch sizes:" << std::endl;
+    for (const auto& p : batch_size_histogram_) {
+        os << " " << p.first << ": " << p.second << std::endl;
+    }
+
+    queueing_delays_usec_.clear();
+    latencies_usec_.clear();
+    batch_size_histogram_.clear();
+}
+
+}  // namespace runtime
+}  // namespace chainer_compiler
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <runtime/xcvm.h>
+
+namespace chainer_compiler {
+namespace runtime {
+
+// Coalesces concurrent requests into batches along axis 0.
+//
+// A batch is closed when it has `max_batch_size` rows or when its
+// oldest request has waited for `batch_timeout_usec`. All inputs of a
+// request must be arrays with the same leading dimension, and the
+// outputs of `run_fn` must have the total number of rows of the batch
+// in their leading dimension. Requests whose inputs differ in dtypes
+// or non-leading dimensions go to different batches.
+class BatchingServer {
+public:
+    typedef std::function<InOuts(const InOuts&)> RunFn;
+
+    BatchingServer(const RunFn& run_fn, int max_batch_size, int64_t batch_timeout_usec);
+    ~BatchingServer();
+
+    // Blocks until the outputs for `inputs` are computed. This can be
+    // called from multiple threads. Throws std::invalid_argument for
+    // inputs which cannot be batched and rethrows exceptions from
+    // `run_fn`.
+    InOuts Run(const InOuts& inputs);
+
+    // Shows the number of requests, queueing delays, the histogram of
+    // batch sizes and p50/p99 latencies since the last report.
+    void ReportStats(std::ostream& os);
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Request {
+        InOuts inputs;
+        int64_t num_rows;
+        Clock::time_point arrival;
+        std::promise<InOuts> outputs;
+    };
+
+    void Loop();
+    void TakeBatch(std::vector<std::unique_ptr<Request>>* batch);
+    void RunBatch(const std::vector<std::unique_ptr<Request>>& batch);
+
+    const RunFn run_fn_;
+    const int max_batch_size_;
+    const std::chrono::microseconds batch_timeout_;
+
+    std::mutex mu_;
+    std::condition_variable cond_;
+    std::deque<std::unique_ptr<Request>> queue_;
+    bool should_finish_ = false;
+
+    std::mutex stats_mu_;
+    // Cleared in each report.
+    std::vector<double> queueing_delays_usec_;
+    std::vector<double> latencies_usec_;
+    std::map<int64_t, int64_t> batch_size_histogram_;
+    int64_t num_reported_requests_ = 0;
+
+    std::thread thread_;
+};
+
+}  // namespace runtime
+}  // namespace chainer_compiler
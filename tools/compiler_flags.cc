@@ -1,20 +1,58 @@
 #include "tools/compiler_flags.h"
 
+#include <stdlib.h>
+
+#include <string>
+
 #include <compiler/flags.h>
 
 namespace chainer_compiler {
 namespace runtime {
 
+namespace {
+
+// A per-user directory following the XDG base directory spec. Empty
+// when neither XDG_CACHE_HOME nor HOME is set.
+std::string DefaultTVMCacheDir() {
+    const char* cache_home = getenv("XDG_CACHE_HOME");
+    if (cache_home && *cache_home) return std::string(cache_home) + "/chainer_compiler/tvm";
+    const char* home = getenv("HOME");
+    if (home && *home) return std::string(home) + "/.cache/chainer_compiler/tvm";
+    return "";
+}
+
+}  // namespace
+
 void AddCompilerFlags(cmdline::parser* args) {
     args->add("compiler_log", '\0', "Show logs from compiler");
     args->add("permissive", '\0', "Relax checks to accept more kinds of ONNX");
     args->add("skip_inference", '\0', "Skip dtype/shape inference");
     args->add<int>("recompute_relu", '\0', "Recompute Relu when the results are used by backprop after this number of steps", false, 0);
+    args->add<int>(
+            "memory_budget_mb",
+            '\0',
+            "Recompute cheap forward values in backprop to fit in this memory budget (0 for no budget)",
+            false,
+            0);
     args->add("replace_constant", '\0', "Replace Constant ops");
     args->add("fuse_operations", '\0', "Fuse consecutive operations");
     args->add("use_nvrtc", '\0', "Use NVRTC");
     args->add("use_tvm", '\0', "Use TVM");
-    args->add("reuse_tvm_code", '\0', "Reuse TVM code (unsafe)");
+    args->add<std::string>(
+            "tvm_cache_dir",
+            '\0',
+            "A directory which keeps TVM kernels shared by processes (empty to disable)",
+            false,
+            DefaultTVMCacheDir());
+    args->add<int>(
+            "constant_propagation_max_bytes",
+            '\0',
+            "Do not create constants larger than this by constant propagation (-1 for no limit)",
+            false,
+            1024 * 1024);
+    args->add("schedule_for_memory", '\0', "Search computation orders with lower peak memory (slower compilation)");
+    args->add("plan_memory", '\0', "Place statically sized temporaries in a preallocated arena (inference only)");
+    args->add("inference_only", '\0', "Compile for inference only, e.g., fold BatchNormalization (training runs are rejected)");
     args->add<std::string>("dump_autotvm_task_dir", '\0', "Output AutoTVM tasks in this directory", false);
     args->add<std::string>("autotvm_log", '\0', "A tuning log of AutoTVM which contains best scheduling parameters", false);
     args->add("dump_after_inference", '\0', "Dump the ONNX graph after dtype/shape inference");
@@ -23,6 +61,8 @@ void AddCompilerFlags(cmdline::parser* args) {
     args->add("dump_after_fusion", '\0', "Dump the ONNX graph after operator fusion");
     args->add("dump_after_scheduling", '\0', "Dump the ONNX graph after scheduling");
     args->add("dump_subgraphs", '\0', "Dump the subgraph tree of the ONNX graph");
+    args->add("dump_constant_propagation", '\0', "Report the number of instructions eliminated by constant propagation");
+    args->add("dump_cse", '\0', "Report the number of nodes removed by common subexpression elimination");
 }
 
 void ApplyCompilerFlags(const cmdline::parser& args) {
@@ -33,16 +73,23 @@ void ApplyCompilerFlags(const cmdline::parser& args) {
     g_fuse_operations = args.exist("fuse_operations");
     g_use_nvrtc = args.exist("use_nvrtc");
     g_use_tvm = args.exist("use_tvm");
-    g_reuse_tvm_code = args.exist("reuse_tvm_code");
+    g_tvm_cache_dir = args.get<std::string>("tvm_cache_dir");
+    g_schedule_for_memory = args.exist("schedule_for_memory");
+    g_plan_memory = args.exist("plan_memory");
+    g_inference_only = args.exist("inference_only");
     g_dump_autotvm_task_dir = args.get<std::string>("dump_autotvm_task_dir");
     g_autotvm_log = args.get<std::string>("autotvm_log");
     g_recompute_relu = args.get<int>("recompute_relu");
+    g_memory_budget_mb = args.get<int>("memory_budget_mb");
+    g_constant_propagation_max_bytes = args.get<int>("constant_propagation_max_bytes");
     g_dump_after_inference = args.exist("dump_after_inference");
     g_dump_after_simplification = args.exist("dump_after_simplification");
     g_dump_after_gradient = args.exist("dump_after_gradient");
     g_dump_after_fusion = args.exist("dump_after_fusion");
     g_dump_after_scheduling = args.exist("dump_after_scheduling");
     g_dump_subgraphs = args.exist("dump_subgraphs");
+    g_dump_constant_propagation = args.exist("dump_constant_propagation");
+    g_dump_cse = args.exist("dump_cse");
 }
 
 }  // namespace runtime
@@ -0,0 +1,117 @@
+// Measures the time of constant propagation for long chains of
+// shape computations, compared with evaluating nodes one by one.
+//
+// Usage: constant_propagation_benchmark [--lengths 100,1000]
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <chainerx/context.h>
+
+#include <common/log.h>
+#include <common/strutil.h>
+#include <compiler/constant_propagation.h>
+#include <compiler/evaluator.h>
+#include <compiler/graph.h>
+#include <compiler/graph_builder.h>
+#include <compiler/node.h>
+#include <compiler/tensor.h>
+#include <compiler/value.h>
+#include <tools/cmdline.h>
+
+namespace chainer_compiler {
+namespace runtime {
+namespace {
+
+// Builds a graph whose shape for Reshape is computed by `length`
+// additions of constants.
+std::unique_ptr<Graph> MakeGraph(int length) {
+    std::unique_ptr<Graph> graph(new Graph("benchmark"));
+    const Type type(Dtype::kFloat32, {2, 3});
+    Value* input = graph->AddInputValue("input", type);
+    Value* output = graph->AddOutputValue("output", type);
+    GraphBuilder gb(graph.get(), "Benchmark", output);
+    const Type shape_type(Dtype::kInt64, {2});
+    Value* shape = gb.Const(shape_type, {2 - length, 3});
+    for (int i = 0; i < length; ++i) {
+        shape = gb.Op(Node::kAdd, {shape, gb.Const(shape_type, {1, 0})});
+    }
+    gb.Op(Node::kReshape, {input, shape}, output);
+    return graph;
+}
+
+// What constant propagation did before: each node is evaluated by its
+// own XCVM and the graph is scanned until nothing changes.
+void PropagateConstantsOneByOne(Graph* graph) {
+    bool replaced = true;
+    while (replaced) {
+        replaced = false;
+        for (Node* node : graph->GetLiveNodes()) {
+            if (node->op_type() != Node::kAdd) continue;
+            std::vector<Node*> nodes;
+            for (Value* input : node->inputs()) {
+                if (input->producer()->op_type() == Node::kConstant) nodes.push_back(input->producer());
+            }
+            if (nodes.size() != node->inputs().size()) continue;
+            nodes.push_back(node);
+            std::vector<std::unique_ptr<EvaluatedValue>> values;
+            Eval(nodes, node->outputs(), &values);
+            GraphBuilder gb(graph, "Const", node->output(0));
+            gb.Op(Node::kConstant, {}, node->output(0))->producer()->set_tensor_value(values[0]->ReleaseTensor());
+            graph->DetachNode(node);
+            nodes.pop_back();
+            for (Node* input : nodes) {
+                if (input->output(0)->users().empty()) graph->DetachNode(input);
+            }
+            replaced = true;
+        }
+    }
+}
+
+// Returns the median of elapsed times of `fn` in milliseconds.
+double MeasureMsec(const std::function<void(Graph*)>& fn, int length, int iterations) {
+    std::vector<double> elapsed;
+    for (int i = 0; i < iterations; ++i) {
+        std::unique_ptr<Graph> graph(MakeGraph(length));
+        auto start = std::chrono::steady_clock::now();
+        fn(graph.get());
+        auto end = std::chrono::steady_clock::now();
+        elapsed.push_back(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() * 0.001);
+        graph->DeleteDetached();
+        CHECK_EQ(2, graph->nodes().size());
+    }
+    std::sort(elapsed.begin(), elapsed.end());
+    return elapsed[elapsed.size() / 2];
+}
+
+void RunBenchmark(int argc, char** argv) {
+    cmdline::parser args;
+    args.add<int>("iterations", 'I', "The number of iterations", false, 3);
+    args.add<std::string>("lengths", '\0', "Comma separated lengths of chains", false, "100,300,1000");
+    args.parse_check(argc, argv);
+    const int iterations = args.get<int>("iterations");
+
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    for (const std::string& length_str : SplitString(args.get<std::string>("lengths"), ",")) {
+        const int length = std::stoi(length_str);
+        const double batched_msec = MeasureMsec(PropagateConstants, length, iterations);
+        const double one_by_one_msec = MeasureMsec(PropagateConstantsOneByOne, length, iterations);
+        std::cout << "Length " << length << ": batched " << batched_msec << " msec, one by one " << one_by_one_msec
+                  << " msec, speedup " << one_by_one_msec / batched_msec << "x" << std::endl;
+    }
+}
+
+}  // namespace
+}  // namespace runtime
+}  // namespace chainer_compiler
+
+int main(int argc, char** argv) {
+    chainer_compiler::runtime::RunBenchmark(argc, argv);
+}
@@ -1,14 +1,26 @@
 #include <dirent.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
 #include <chrono>
+#include <condition_variable>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <limits>
 #include <map>
+#include <mutex>
 #include <queue>
 #include <set>
+#include <sstream>
 #include <string>
+#include <thread>
 
 #include <compiler/onnx.h>
 
@@ -25,6 +37,7 @@
 #include <common/protoutil.h>
 #include <common/strutil.h>
 #include <compiler/custom_onnx_ops.h>
+#include <compiler/dtype.h>
 #include <compiler/flags.h>
 #include <compiler/gradient.h>
 #include <compiler/graph.h>
@@ -34,12 +47,15 @@
 #include <compiler/util.h>
 #include <compiler/value.h>
 #include <compiler/xcvm/emitter.h>
+#include <compiler/xcvm/program_cache.h>
 #include <runtime/chainerx_util.h>
 #include <runtime/chrome_tracing.h>
 #include <runtime/meminfo.h>
 #include <runtime/xcvm.h>
 #include <runtime/xcvm.pb.h>
+#include <runtime/xcvm_profiler.h>
 #include <runtime/xcvm_var.h>
+#include <tools/batching_server.h>
 #include <tools/cmdline.h>
 #include <tools/compiler_flags.h>
 #include <tools/util.h>
@@ -67,9 +83,14 @@ std::vector<std::string> ListDir(const std::string& dirname) {
 
 chainerx::Array MakeArrayFromONNX(const onnx::TensorProto& xtensor) {
     Tensor tensor(xtensor);
-    int64_t size = tensor.ElementSize() * tensor.NumElements();
-    std::shared_ptr<void> data(new char[size], std::default_delete<char[]>());
-    std::memcpy(data.get(), tensor.GetRawData(), size);
+    // Mapped data may be shared with other tensors, and inputs may be
+    // written, e.g., by BatchNormalization in training.
+    std::shared_ptr<void> data = tensor.GetSharedData();
+    if (tensor.is_mapped()) {
+        const int64_t size = tensor.ElementSize() * tensor.NumElements();
+        data.reset(new char[size], std::default_delete<char[]>());
+        std::memcpy(data.get(), tensor.GetRawData(), size);
+    }
     chainerx::Shape shape(tensor.dims());
     chainerx::Dtype dtype;
     switch (tensor.dtype()) {
@@ -89,7 +110,12 @@ chainerx::Array MakeArrayFromONNX(const onnx::TensorProto& xtensor) {
             CHECK(false) << "Unknown data type: " << static_cast<int>(tensor.dtype());
     }
     chainerx::Array array(chainerx::FromData(
-            shape, dtype, data, nonstd::nullopt /* strides */, 0 /* offset */, chainerx::GetNativeBackend().GetDevice(0)));
+            shape,
+            dtype,
+            data,
+            nonstd::nullopt /* strides */,
+            0 /* offset */,
+            chainerx::GetNativeBackend().GetDevice(0)));
     return array;
 }
 
@@ -220,8 +246,8 @@ XCVMVar* StageVar(XCVMVar* var) {
 
 class ModelRunner {
 public:
-    ModelRunner(const cmdline::parser& args, int64_t initial_free_bytes, Model* model)
-        : model_(model), args_(args), initial_free_bytes_(initial_free_bytes) {
+    ModelRunner(const cmdline::parser& args, int64_t initial_used_bytes, Model* model)
+        : model_(model), args_(args), initial_used_bytes_(initial_used_bytes) {
         if (args.exist("backprop_two_phase")) {
             Model backprop_model(*model, model->graph().name() + "_backprop");
             RunDefaultPassesBeforeGradient(model->mutable_graph());
@@ -238,8 +264,10 @@ public:
             }
         } else {
             LOG() << "Constructing model..." << std::endl;
-            RunDefaultPasses(model->mutable_graph(), args_.exist("backprop"));
-            CompileModel(model, &xcvm_);
+            if (!LoadCachedProgram(*model, &xcvm_)) {
+                RunDefaultPasses(model->mutable_graph(), args_.exist("backprop"));
+                CompileModel(model, &xcvm_);
+            }
         }
 
         for (const std::string& op_name : SplitString(args_.get<std::string>("verbose_ops"), ",")) {
@@ -249,20 +277,56 @@ public:
         }
         xcvm_opts_.trace_level = trace_level();
         xcvm_opts_.is_training = args_.exist("backprop") || args_.exist("backprop_two_phase");
-        xcvm_opts_.check_types = true;
+        // Shapes of batched inputs in the serving mode differ from
+        // the ones in the model.
+        xcvm_opts_.check_types = !args_.exist("serve");
         xcvm_opts_.check_nans = args_.exist("check_nans");
         xcvm_opts_.check_infs = args_.exist("check_infs");
         xcvm_opts_.dump_memory_usage = args_.exist("trace");
-        xcvm_opts_.base_memory_usage = initial_free_bytes_;
+        xcvm_opts_.release_mode = args_.exist("release_mode");
+        xcvm_opts_.num_threads = args_.get<int>("num_threads");
+        xcvm_opts_.base_memory_usage = initial_used_bytes_;
         if (!args_.get<std::string>("chrome_tracing").empty()) {
-            xcvm_opts_.chrome_tracing = new ChromeTracingEmitter();
+            const int buffer_size = args_.get<int>("chrome_tracing_buffer_size");
+            if (buffer_size <= 0) QFAIL() << "--chrome_tracing_buffer_size must be positive";
+            xcvm_opts_.chrome_tracing = new ChromeTracingEmitter(buffer_size);
+        }
+        if (args_.exist("profile") || !args_.get<std::string>("profile_csv").empty() ||
+            !args_.get<std::string>("profile_json").empty()) {
+            profiler_.reset(new XCVMProfiler());
+            xcvm_opts_.profiler = profiler_.get();
         }
 
-        params_ = LoadParams(model->graph());
-        param_bytes_ = initial_free_bytes - GetMemoryUsageInBytes();
+        params_ = LoadParams(model->graph(), !xcvm_opts_.is_training);
+        param_bytes_ = GetMemoryUsageInBytes() - initial_used_bytes;
+    }
+
+    // Loads the program of `model` from --program_cache_dir. On a
+    // miss, the program compiled next by `CompileModel` is stored.
+    // The cache is not read when outputs of the compilation are
+    // requested.
+    bool LoadCachedProgram(const Model& model, std::unique_ptr<XCVM>* xcvm) {
+        const std::string cache_dir = args_.get<std::string>("program_cache_dir");
+        if (cache_dir.empty()) return false;
+        program_cache_.reset(new xcvm::ProgramCache(cache_dir));
+        program_cache_key_ =
+                program_cache_->GetKey(model.graph(), StrCat("backprop=", args_.exist("backprop"), " trace=", trace_level() > 0));
+        if (args_.exist("dump_onnx") || args_.exist("dump_xcvm") || !args_.get<std::string>("out_onnx").empty() ||
+            !args_.get<std::string>("out_xcvm").empty()) {
+            LOG() << "Program cache is not read as --dump_onnx, --dump_xcvm, --out_onnx or --out_xcvm is set" << std::endl;
+            return false;
+        }
+        XCProgramProto xcvm_prog;
+        if (!program_cache_->Load(program_cache_key_, &xcvm_prog)) {
+            LOG() << "Program cache miss: " << program_cache_key_ << std::endl;
+            return false;
+        }
+        LOG() << "Program cache hit: " << program_cache_key_ << std::endl;
+        xcvm->reset(new XCVM(xcvm_prog));
+        return true;
     }
 
-    void CompileModel(Model* model, std::unique_ptr<XCVM>* xcvm, const char* name = nullptr, bool gen_backprop = false) {
+    void CompileModel(Model* model, std::unique_ptr<XCVM>* xcvm, const char* name = nullptr) {
         if (args_.exist("dump_onnx")) {
             onnx::ModelProto xmodel;
             model->ToONNX(&xmodel);
@@ -286,6 +350,9 @@ public:
         LOG() << "Generate code..." << std::endl;
         XCProgramProto xcvm_prog;
         xcvm::Emit(*model, &xcvm_prog, trace_level() > 0);
+        if (program_cache_) {
+            program_cache_->Save(program_cache_key_, xcvm_prog);
+        }
 
         if (args_.exist("dump_xcvm")) {
             int pc = 0;
@@ -296,6 +363,17 @@ public:
         }
         const std::string out_xcvm = args_.get<std::string>("out_xcvm");
         if (!out_xcvm.empty()) {
+            // Constants are stored in a separate file so they can be
+            // mapped to memory without parsing.
+            if (!xcvm_prog.constants().empty()) {
+                const std::string out_constants = out_xcvm + ".constants";
+                std::ofstream ofs(out_constants, std::ios::binary);
+                CHECK(ofs) << "Failed to open output constants: " << out_constants;
+                CHECK(ofs.write(xcvm_prog.constants().data(), xcvm_prog.constants().size()));
+                xcvm_prog.clear_constants();
+                // Relative to the directory of `out_xcvm`.
+                xcvm_prog.set_constants_file(Basename(out_constants));
+            }
             std::ofstream ofs(out_xcvm);
             CHECK(ofs) << "Failed to open output XCVM: " << out_xcvm;
             CHECK(xcvm_prog.SerializeToOstream(&ofs));
@@ -308,12 +386,19 @@ public:
         if (xcvm_opts_.chrome_tracing) {
             xcvm_opts_.chrome_tracing->Emit(args_.get<std::string>("chrome_tracing"));
         }
+        if (profiler_) {
+            profiler_->Report(std::cerr);
+            const std::string& profile_csv = args_.get<std::string>("profile_csv");
+            if (!profile_csv.empty()) profiler_->EmitCSV(profile_csv);
+            const std::string& profile_json = args_.get<std::string>("profile_json");
+            if (!profile_json.empty()) profiler_->EmitJSON(profile_json);
+        }
     }
 
     InOuts Run(const InOuts& inputs) {
         if (trace_level()) std::cerr << "Running XCVM..." << std::endl;
         InOuts outputs = xcvm_->Run(inputs, xcvm_opts_);
-        MaybeShowGPUMemory();
+        MaybeShowMemory();
         if (xcvm_bp_.get()) {
             if (trace_level()) std::cerr << "Running XCVM for backward..." << std::endl;
             InOuts bp_inputs;
@@ -334,7 +419,7 @@ public:
                 CHECK(bp_inputs.emplace(input_name, value).second) << name;
             }
             InOuts bp_outputs = xcvm_bp_->Run(bp_inputs, xcvm_opts_);
-            MaybeShowGPUMemory();
+            MaybeShowMemory();
             for (auto& p : bp_outputs) {
                 outputs.emplace(p);
             }
@@ -354,13 +439,19 @@ private:
         return args_.exist("verbose") ? 2 : args_.exist("trace") ? 1 : 0;
     }
 
-    void MaybeShowGPUMemory() const {
-        if (initial_free_bytes_ >= 0) {
-            int64_t free_bytes = GetMemoryUsageInBytes();
-            size_t used_bytes = initial_free_bytes_ - free_bytes;
+    void MaybeShowMemory() const {
+        // Host memory is shown only when tracing is requested.
+        if (initial_used_bytes_ >= 0 && (g_meminfo_enabled || xcvm_opts_.dump_memory_usage)) {
+            size_t used_bytes = GetMemoryUsageInBytes() - initial_used_bytes_;
             size_t param_mbs = param_bytes_ / 1000 / 1000;
             size_t used_mbs = used_bytes / 1000 / 1000;
-            LOG() << "GPU memory: param=" << param_mbs << "MB used=" << used_mbs << "MB" << std::endl;
+            std::ostringstream oss;
+            oss << (g_meminfo_enabled ? "GPU" : "Native") << " memory: param=" << param_mbs << "MB used=" << used_mbs << "MB";
+            NativeMemoryStats stats;
+            if (!g_meminfo_enabled && GetNativeMemoryStats(&stats)) {
+                oss << " peak=" << stats.peak_bytes / 1000 / 1000 << "MB allocations=" << stats.num_allocations;
+            }
+            LOG() << oss.str() << std::endl;
         }
     }
 
@@ -368,25 +459,302 @@ private:
     const cmdline::parser& args_;
     std::unique_ptr<XCVM> xcvm_;
     XCVMOptions xcvm_opts_;
+    std::unique_ptr<XCVMProfiler> profiler_;
     InOuts params_;
-    const int64_t initial_free_bytes_;
+    const int64_t initial_used_bytes_;
     int64_t param_bytes_;
 
     std::unique_ptr<XCVM> xcvm_bp_;
     std::vector<std::string> backprop_ins_;
+
+    std::unique_ptr<xcvm::ProgramCache> program_cache_;
+    std::string program_cache_key_;
+};
+
+onnx::TensorProto MakeONNXFromArray(const std::string& name, const chainerx::Array& array) {
+    chainerx::Array a = array.ToNative();
+    if (!a.IsContiguous()) a = chainerx::Copy(a);
+    onnx::TensorProto xtensor;
+    xtensor.set_name(name);
+    xtensor.set_data_type(Dtype(static_cast<Dtype::DataType>(a.dtype())).ToONNX());
+    for (int64_t d : a.shape()) xtensor.add_dims(d);
+    xtensor.set_raw_data(static_cast<const char*>(a.raw_data()) + a.offset(), a.GetNBytes());
+    return xtensor;
+}
+
+bool ReadFull(int fd, void* buf, size_t size) {
+    char* p = static_cast<char*>(buf);
+    while (size) {
+        ssize_t r = read(fd, p, size);
+        if (r <= 0) return false;
+        p += r;
+        size -= r;
+    }
+    return true;
+}
+
+bool WriteFull(int fd, const void* buf, size_t size) {
+    const char* p = static_cast<const char*>(buf);
+    while (size) {
+        ssize_t r = write(fd, p, size);
+        if (r <= 0) return false;
+        p += r;
+        size -= r;
+    }
+    return true;
+}
+
+// A message is a uint32 number of tensors followed by pairs of a
+// uint64 byte size and a serialized onnx::TensorProto, all in the host
+// byte order. Returns false for messages with more than `max_tensors`
+// tensors or more than `max_bytes` bytes of tensors.
+bool ReadTensors(int fd, uint32_t max_tensors, uint64_t max_bytes, std::vector<onnx::TensorProto>* xtensors) {
+    uint32_t num_tensors;
+    if (!ReadFull(fd, &num_tensors, sizeof(num_tensors))) return false;
+    if (num_tensors > max_tensors) {
+        std::cerr << "Too many tensors in a request: " << num_tensors << std::endl;
+        return false;
+    }
+    std::string buf;
+    uint64_t total_size = 0;
+    for (uint32_t i = 0; i < num_tensors; ++i) {
+        uint64_t size;
+        if (!ReadFull(fd, &size, sizeof(size))) return false;
+        if (size > max_bytes - total_size) {
+            std::cerr << "Too large request: more than " << max_bytes << " bytes" << std::endl;
+            return false;
+        }
+        total_size += size;
+        buf.resize(size);
+        if (!ReadFull(fd, &buf[0], size)) return false;
+        xtensors->emplace_back();
+        if (!xtensors->back().ParseFromString(buf)) return false;
+    }
+    return true;
+}
+
+bool WriteTensors(int fd, const std::vector<onnx::TensorProto>& xtensors) {
+    uint32_t num_tensors = xtensors.size();
+    if (!WriteFull(fd, &num_tensors, sizeof(num_tensors))) return false;
+    for (const onnx::TensorProto& xtensor : xtensors) {
+        std::string buf;
+        CHECK(xtensor.SerializeToString(&buf));
+        uint64_t size = buf.size();
+        if (!WriteFull(fd, &size, sizeof(size))) return false;
+        if (!WriteFull(fd, buf.data(), size)) return false;
+    }
+    return true;
+}
+
+// Returns an empty string if `xtensor` from a client can be converted
+// by `MakeArrayFromONNX` and has the batch dimension.
+std::string ValidateRequestTensor(const onnx::TensorProto& xtensor) {
+    if (xtensor.has_segment() || xtensor.data_location() == onnx::TensorProto::EXTERNAL) {
+        return "segmented or external tensors are not supported";
+    }
+    // The number of elements in the typed field for the dtype.
+    int num_typed_elements;
+    switch (xtensor.data_type()) {
+        case onnx::TensorProto::BOOL:
+        case onnx::TensorProto::INT8:
+        case onnx::TensorProto::INT16:
+        case onnx::TensorProto::INT32:
+        case onnx::TensorProto::UINT8:
+            num_typed_elements = xtensor.int32_data_size();
+            break;
+        case onnx::TensorProto::INT64:
+            num_typed_elements = xtensor.int64_data_size();
+            break;
+        case onnx::TensorProto::FLOAT:
+            num_typed_elements = xtensor.float_data_size();
+            break;
+        case onnx::TensorProto::DOUBLE:
+            num_typed_elements = xtensor.double_data_size();
+            break;
+        default:
+            return StrCat("unsupported data type ", xtensor.data_type());
+    }
+    if (xtensor.dims_size() == 0) return "no batch dimension";
+
+    const uint64_t element_size = Dtype(xtensor.data_type()).SizeOf();
+    uint64_t num_elements = 1;
+    for (int64_t d : xtensor.dims()) {
+        if (d < 0) return StrCat("negative dimension ", d);
+        if (d && num_elements > std::numeric_limits<uint64_t>::max() / element_size / d) return "too many elements";
+        num_elements *= d;
+    }
+
+    const int num_other_elements = xtensor.float_data_size() + xtensor.int32_data_size() + xtensor.string_data_size() +
+                                   xtensor.int64_data_size() + xtensor.double_data_size() + xtensor.uint64_data_size();
+    if (xtensor.has_raw_data()) {
+        if (num_other_elements) return "both raw and typed data";
+        if (xtensor.raw_data().size() != num_elements * element_size) return "inconsistent size of raw data";
+    } else {
+        if (num_other_elements != num_typed_elements) return "data in a wrong field";
+        if (static_cast<uint64_t>(num_typed_elements) != num_elements) return "inconsistent number of elements";
+    }
+    return "";
+}
+
+// Converts tensors in a request to inputs of the model. Returns an
+// error message for invalid requests.
+std::string MakeRequestInputs(const std::vector<onnx::TensorProto>& xtensors, const std::vector<std::string>& input_names, InOuts* inputs) {
+    if (xtensors.empty()) return "no inputs";
+    int64_t batch_size = -1;
+    for (size_t i = 0; i < xtensors.size(); ++i) {
+        const onnx::TensorProto& xtensor = xtensors[i];
+        std::string name = xtensor.name();
+        if (name.empty()) {
+            if (i >= input_names.size()) return StrCat("no input at index ", i);
+            name = input_names[i];
+        } else if (std::find(input_names.begin(), input_names.end(), name) == input_names.end()) {
+            return StrCat("unknown input: ", name);
+        }
+        const std::string error = ValidateRequestTensor(xtensor);
+        if (!error.empty()) return StrCat("invalid input ", name, ": ", error);
+        if (batch_size < 0) batch_size = xtensor.dims(0);
+        if (batch_size != xtensor.dims(0)) return StrCat("inconsistent batch size of ", name);
+
+        std::shared_ptr<XCVMVar> var(new XCVMVar(MakeArrayFromONNX(xtensor)));
+        if (!inputs->emplace(name, var).second) return StrCat("duplicated input: ", name);
+    }
+    return "";
+}
+
+// A counting semaphore which limits the number of connections.
+class ConnectionLimiter {
+public:
+    explicit ConnectionLimiter(int max_connections) : num_available_(max_connections) {
+    }
+
+    void Acquire() {
+        std::unique_lock<std::mutex> lock{mu_};
+        cond_.wait(lock, [this]() { return num_available_ > 0; });
+        --num_available_;
+    }
+
+    void Release() {
+        {
+            std::unique_lock<std::mutex> lock{mu_};
+            ++num_available_;
+        }
+        cond_.notify_one();
+    }
+
+private:
+    std::mutex mu_;
+    std::condition_variable cond_;
+    int num_available_;
 };
 
+// Serves requests from clients connected to a UNIX domain socket.
+// Each request carries the non-initializer inputs of the model, which
+// are named or given in the order of the graph inputs, with a leading
+// batch dimension. The response carries all outputs of the model.
+// Concurrent requests are batched by BatchingServer. Invalid requests
+// and failures of the model close their connections.
+void Serve(const cmdline::parser& args, ModelRunner* model_runner, const std::vector<std::string>& input_names) {
+    const std::string socket_path = args.get<std::string>("serve");
+    const int report_interval = args.get<int>("serve_report_interval");
+    const int max_connections = args.get<int>("serve_max_connections");
+    const int max_request_mb = args.get<int>("serve_max_request_mb");
+    if (report_interval <= 0) QFAIL() << "--serve_report_interval must be positive";
+    if (max_connections <= 0) QFAIL() << "--serve_max_connections must be positive";
+    if (max_request_mb <= 0) QFAIL() << "--serve_max_request_mb must be positive";
+    const int max_batch_size = args.get<int>("max_batch_size");
+    const int batch_timeout_usec = args.get<int>("batch_timeout_usec");
+    if (max_batch_size <= 0) QFAIL() << "--max_batch_size must be positive";
+    if (batch_timeout_usec < 0) QFAIL() << "--batch_timeout_usec must not be negative";
+    const uint64_t max_request_bytes = static_cast<uint64_t>(max_request_mb) * 1000 * 1000;
+
+    BatchingServer server(
+            [model_runner](const InOuts& batch) {
+                InOuts inputs(model_runner->params());
+                for (const auto& p : batch) {
+                    XCVMVar* v = StageVar(p.second.get());
+                    CHECK(inputs.emplace(p.first, std::shared_ptr<XCVMVar>(v)).second) << "Duplicated input parameter: " << p.first;
+                }
+                return model_runner->Run(inputs);
+            },
+            max_batch_size,
+            batch_timeout_usec);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    CHECK_LE(0, listen_fd) << "socket: " << strerror(errno);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    CHECK_GT(sizeof(addr.sun_path), socket_path.size()) << "Too long socket path: " << socket_path;
+    strcpy(addr.sun_path, socket_path.c_str());
+    // Remove a stale socket left by a previous server, but never other
+    // kinds of files.
+    struct stat st;
+    if (lstat(socket_path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) QFAIL() << socket_path << " exists and is not a socket";
+        CHECK_EQ(0, unlink(socket_path.c_str())) << "unlink: " << strerror(errno);
+    }
+    CHECK_EQ(0, bind(listen_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr))) << "bind: " << strerror(errno);
+    CHECK_EQ(0, listen(listen_fd, SOMAXCONN)) << "listen: " << strerror(errno);
+    LOG() << "Serving at " << socket_path << std::endl;
+
+    std::atomic<int64_t> num_requests{0};
+    ConnectionLimiter limiter(max_connections);
+    auto handle_connection = [&](int fd) {
+        while (true) {
+            std::vector<onnx::TensorProto> xtensors;
+            if (!ReadTensors(fd, input_names.size(), max_request_bytes, &xtensors)) break;
+            try {
+                InOuts inputs;
+                const std::string error = MakeRequestInputs(xtensors, input_names, &inputs);
+                if (!error.empty()) {
+                    std::cerr << "Invalid request: " << error << std::endl;
+                    break;
+                }
+
+                InOuts outputs = server.Run(inputs);
+
+                std::vector<onnx::TensorProto> response;
+                for (const auto& p : outputs) response.push_back(MakeONNXFromArray(p.first, p.second->GetArray()));
+                if (!WriteTensors(fd, response)) break;
+            } catch (const std::exception& e) {
+                std::cerr << "Failed to run a request: " << e.what() << std::endl;
+                break;
+            }
+
+            if (++num_requests % report_interval == 0) server.ReportStats(std::cerr);
+        }
+        close(fd);
+        limiter.Release();
+    };
+
+    while (true) {
+        limiter.Acquire();
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            WARN_ONCE("accept: " << strerror(errno));
+            limiter.Release();
+            continue;
+        }
+        std::thread(handle_connection, fd).detach();
+    }
+}
+
 void RunMain(const std::vector<std::string>& argv) {
     g_modify_pool_with_imbalanced_pads = true;
 
     cmdline::parser args;
     args.add<std::string>("chrome_tracing", '\0', "Output chrome tracing profile", false);
+    args.add<int>("chrome_tracing_buffer_size", '\0', "Max chrome tracing events kept per thread", false, 1 << 16);
+    args.add("profile", '\0', "Show the time, FLOPs and bytes of each op type and instruction");
+    args.add<std::string>("profile_csv", '\0', "Output the aggregated profile in CSV", false);
+    args.add<std::string>("profile_json", '\0', "Output the aggregated profile in JSON", false);
     args.add<std::string>("backend", '\0', "The name of the backend", false, "xcvm");
     args.add<std::string>("test", '\0', "ONNX's backend test directory", false);
     args.add<std::string>("onnx", '\0', "ONNX model", false);
     args.add<std::string>("device", 'd', "ChainerX device to be used", false);
     args.add<std::string>("out_onnx", '\0', "Output ONNX model after optimization", false);
     args.add<std::string>("out_xcvm", '\0', "Output XCVM program", false);
+    args.add<std::string>("program_cache_dir", '\0', "Reuse compiled programs in this directory", false);
     args.add<int>("iterations", 'I', "The number of iteartions", false, 1);
     args.add<double>("rtol", '\0', "rtol of AllClose", false, 1e-4);
     args.add("check_nans", '\0', "Check for NaNs after each operation");
@@ -401,6 +769,14 @@ void RunMain(const std::vector<std::string>& argv) {
     args.add("verbose", 'v', "Verbose mode");
     args.add<std::string>("verbose_ops", '\0', "Show verbose outputs for specific ops", false);
     args.add("quiet", 'q', "Quiet mode");
+    args.add("release_mode", '\0', "Run XCVM without traces and per-op checks");
+    args.add<int>("num_threads", '\0', "The number of threads to run independent ops in the release mode", false, 1);
+    args.add<std::string>("serve", '\0', "Serve requests batched along axis 0 at this UNIX domain socket", false);
+    args.add<int>("max_batch_size", '\0', "The maximum number of rows in a batch in the serving mode", false, 8);
+    args.add<int>("batch_timeout_usec", '\0', "The maximum time a request waits for a batch in the serving mode", false, 1000);
+    args.add<int>("serve_report_interval", '\0', "Report serving statistics every this number of requests", false, 1000);
+    args.add<int>("serve_max_connections", '\0', "The maximum number of concurrent connections in the serving mode", false, 64);
+    args.add<int>("serve_max_request_mb", '\0', "The maximum total size of tensors in a request in the serving mode", false, 1000);
     AddCompilerFlags(&args);
     args.parse_check(argv);
     ApplyCompilerFlags(args);
@@ -429,7 +805,7 @@ void RunMain(const std::vector<std::string>& argv) {
             g_meminfo_enabled = true;
         }
     }
-    int64_t initial_free_bytes = GetMemoryUsageInBytes();
+    int64_t initial_used_bytes = GetMemoryUsageInBytes();
 
     if (onnx_path.empty()) {
         onnx_path = test_path + "/model.onnx";
@@ -437,7 +813,7 @@ void RunMain(const std::vector<std::string>& argv) {
 
     LOG() << "Loading model..." << std::endl;
     RegisterCustomOnnxOperatorSetSchema();
-    onnx::ModelProto xmodel(LoadLargeProto<onnx::ModelProto>(onnx_path));
+    onnx::ModelProto xmodel(LoadONNXModel(onnx_path));
     Model model(xmodel);
     if (!g_skip_inference) model.mutable_graph()->InferShapes();
 
@@ -478,10 +854,15 @@ void RunMain(const std::vector<std::string>& argv) {
         test_cases.swap(new_test_cases);
     }
 
-    ModelRunner model_runner(args, initial_free_bytes, &model);
+    ModelRunner model_runner(args, initial_used_bytes, &model);
 
     if (args.exist("compile_only")) return;
 
+    if (!args.get<std::string>("serve").empty()) {
+        Serve(args, &model_runner, input_names);
+        return;
+    }
+
     double elapsed_total = 0;
     int test_cnt = 0;
     for (const std::unique_ptr<TestCase>& test_case : test_cases) {
@@ -0,0 +1,103 @@
+// Measures the time to get a runnable XCVM from an ONNX model, with
+// and without the program cache.
+//
+// Usage: startup_benchmark [compiler flags] <model.onnx>
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <compiler/onnx.h>
+
+#include <chainerx/context.h>
+
+#include <common/log.h>
+#include <compiler/custom_onnx_ops.h>
+#include <compiler/flags.h>
+#include <compiler/graph.h>
+#include <compiler/model.h>
+#include <compiler/passes.h>
+#include <compiler/util.h>
+#include <compiler/xcvm/emitter.h>
+#include <compiler/xcvm/program_cache.h>
+#include <runtime/xcvm.h>
+#include <runtime/xcvm.pb.h>
+#include <tools/cmdline.h>
+#include <tools/compiler_flags.h>
+
+namespace chainer_compiler {
+namespace runtime {
+namespace {
+
+// Returns the median of elapsed times of `fn` in milliseconds.
+double MeasureMsec(const std::function<void()>& fn, int iterations) {
+    std::vector<double> elapsed;
+    for (int i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        elapsed.push_back(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() * 0.001);
+    }
+    std::sort(elapsed.begin(), elapsed.end());
+    return elapsed[elapsed.size() / 2];
+}
+
+void RunBenchmark(int argc, char** argv) {
+    cmdline::parser args;
+    args.add<int>("iterations", 'I', "The number of iterations", false, 5);
+    args.add<std::string>("backend", '\0', "The name of the backend", false, "xcvm");
+    AddCompilerFlags(&args);
+    args.parse_check(argc, argv);
+    ApplyCompilerFlags(args);
+    g_backend_name = args.get<std::string>("backend");
+    if (args.rest().size() != 1) {
+        std::cerr << args.usage() << std::endl;
+        QFAIL() << "Usage: " << argv[0] << " <model.onnx>";
+    }
+    const std::string onnx_path = args.rest()[0];
+    const int iterations = args.get<int>("iterations");
+
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+    RegisterCustomOnnxOperatorSetSchema();
+    const onnx::ModelProto xmodel(LoadONNXModel(onnx_path));
+
+    char cache_dir[] = "/tmp/startup_benchmark_XXXXXX";
+    CHECK(mkdtemp(cache_dir));
+    xcvm::ProgramCache cache(cache_dir);
+
+    // Both include the construction of the model as run_onnx needs
+    // it to compute the cache key and load parameters.
+    auto compile = [&xmodel, &cache](bool use_cache) {
+        Model model(xmodel);
+        if (!g_skip_inference) model.mutable_graph()->InferShapes();
+        const std::string key = cache.GetKey(model.graph(), "");
+        XCProgramProto program;
+        if (!use_cache || !cache.Load(key, &program)) {
+            RunDefaultPasses(model.mutable_graph());
+            xcvm::Emit(model, &program);
+            cache.Save(key, program);
+        }
+        XCVM xcvm(program);
+    };
+
+    const double compile_msec = MeasureMsec([&compile]() { compile(false); }, iterations);
+    const double cached_msec = MeasureMsec([&compile]() { compile(true); }, iterations);
+    std::cout << "Compile: " << compile_msec << " msec" << std::endl;
+    std::cout << "Cached: " << cached_msec << " msec" << std::endl;
+    std::cout << "Speedup: " << compile_msec / cached_msec << "x" << std::endl;
+}
+
+}  // namespace
+}  // namespace runtime
+}  // namespace chainer_compiler
+
+int main(int argc, char** argv) {
+    chainer_compiler::runtime::RunBenchmark(argc, argv);
+}
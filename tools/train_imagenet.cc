@@ -1,6 +1,7 @@
 #include "tools/train_imagenet.h"
 
 #include <chrono>
+#include <memory>
 #include <set>
 
 #include <compiler/onnx.h>
@@ -12,7 +13,6 @@
 #include <chainerx/routines/manipulation.h>
 
 #include <common/log.h>
-#include <common/protoutil.h>
 #include <common/strutil.h>
 #include <compiler/custom_onnx_ops.h>
 #include <compiler/flags.h>
@@ -23,11 +23,13 @@
 #include <compiler/util.h>
 #include <compiler/value.h>
 #include <compiler/xcvm/emitter.h>
+#include <compiler/xcvm/program_cache.h>
 #include <feeder/imagenet_iterator.h>
 #include <runtime/chainerx_util.h>
 #include <runtime/chrome_tracing.h>
 #include <runtime/meminfo.h>
 #include <runtime/xcvm.h>
+#include <runtime/xcvm_profiler.h>
 #include <runtime/xcvm_var.h>
 #include <tools/cmdline.h>
 #include <tools/compiler_flags.h>
@@ -59,11 +61,16 @@ void RunMain(const std::vector<std::string>& argv) {
     args.add<std::string>("device", 'd', "ChainerX device to be used", false);
     args.add<std::string>("chrome_tracing", '\0', "Output chrome tracing profile", false);
     args.add<int>("chrome_tracing_frequency", '\0', "Output chrome tracing every this itearation", false, 100);
+    args.add<int>("chrome_tracing_buffer_size", '\0', "Max chrome tracing events kept per thread", false, 1 << 16);
+    args.add("profile", '\0', "Show the time, FLOPs and bytes of each op type and instruction");
+    args.add<std::string>("profile_csv", '\0', "Output the aggregated profile in CSV", false);
+    args.add<std::string>("profile_json", '\0', "Output the aggregated profile in JSON", false);
     args.add<int>("iterations", 'I', "Number of iterations to train", false, 100);
     args.add("check_nans", '\0', "Check for NaNs after each operation");
     args.add("check_infs", '\0', "Check for infinities after each operation");
     args.add("dump_onnx", '\0', "Dump ONNX model after optimization");
     args.add("dump_xcvm", '\0', "Dump XCVM program");
+    args.add<std::string>("program_cache_dir", '\0', "Reuse compiled programs in this directory", false);
     args.add("trace", 't', "Tracing mode");
     args.add("verbose", 'v', "Verbose mode");
     args.add("quiet", 'q', "Quiet mode");
@@ -93,17 +100,32 @@ void RunMain(const std::vector<std::string>& argv) {
             g_meminfo_enabled = true;
         }
     }
-    int64_t initial_free_bytes = GetMemoryUsageInBytes();
+    int64_t initial_used_bytes = GetMemoryUsageInBytes();
 
     LOG() << "Constructing model..." << std::endl;
     RegisterCustomOnnxOperatorSetSchema();
-    onnx::ModelProto xmodel(LoadLargeProto<onnx::ModelProto>(args.rest()[0]));
+    onnx::ModelProto xmodel(LoadONNXModel(args.rest()[0]));
     Model model(xmodel);
     if (!g_skip_inference) model.mutable_graph()->InferShapes();
     const bool expects_onehot = ExpectsOnehot(model);
     CHECK_EQ(1, model.graph().output_values().size());
     const std::string loss_value_name = model.graph().output_values()[0]->name();
-    RunDefaultPasses(&model, true /* gen_backprop */);
+
+    int trace_level = args.exist("verbose") ? 2 : args.exist("trace") ? 1 : 0;
+
+    XCProgramProto xcvm_prog;
+    std::unique_ptr<xcvm::ProgramCache> program_cache;
+    std::string program_cache_key;
+    bool is_cached = false;
+    if (!args.get<std::string>("program_cache_dir").empty()) {
+        program_cache.reset(new xcvm::ProgramCache(args.get<std::string>("program_cache_dir")));
+        program_cache_key = program_cache->GetKey(model.graph(), StrCat("train_imagenet trace=", trace_level > 0));
+        is_cached = program_cache->Load(program_cache_key, &xcvm_prog);
+        LOG() << "Program cache " << (is_cached ? "hit: " : "miss: ") << program_cache_key << std::endl;
+    }
+    if (!is_cached) {
+        RunDefaultPasses(&model, true /* gen_backprop */);
+    }
 
     std::vector<Value*> infeed_values;
     for (Value* value : model.graph().input_values()) {
@@ -118,19 +140,21 @@ void RunMain(const std::vector<std::string>& argv) {
 
     chainerx::Array batch_size_array = MakeScalarArray(static_cast<float>(batch_size)).ToDevice(chainerx::GetDefaultDevice());
 
-    int trace_level = args.exist("verbose") ? 2 : args.exist("trace") ? 1 : 0;
+    if (!is_cached) {
+        if (args.exist("dump_onnx")) {
+            onnx::ModelProto xmodel;
+            model.ToONNX(&xmodel);
+            StripONNXModel(&xmodel);
+            std::cerr << xmodel.DebugString();
+        }
 
-    if (args.exist("dump_onnx")) {
-        onnx::ModelProto xmodel;
-        model.ToONNX(&xmodel);
-        StripONNXModel(&xmodel);
-        std::cerr << xmodel.DebugString();
+        LOG() << "Generate code..." << std::endl;
+        xcvm::Emit(model, &xcvm_prog, trace_level > 0);
+        if (program_cache) {
+            program_cache->Save(program_cache_key, xcvm_prog);
+        }
     }
 
-    LOG() << "Generate code..." << std::endl;
-    XCProgramProto xcvm_prog;
-    xcvm::Emit(model, &xcvm_prog, trace_level > 0);
-
     if (args.exist("dump_xcvm")) {
         int pc = 0;
         for (XCInstructionProto inst : xcvm_prog.instructions()) {
@@ -146,9 +170,14 @@ void RunMain(const std::vector<std::string>& argv) {
     xcvm_opts.check_nans = args.exist("check_nans");
     xcvm_opts.check_infs = args.exist("check_infs");
     xcvm_opts.dump_memory_usage = args.exist("trace");
-    xcvm_opts.base_memory_usage = initial_free_bytes;
+    xcvm_opts.base_memory_usage = initial_used_bytes;
+    std::unique_ptr<XCVMProfiler> profiler;
+    if (args.exist("profile") || !args.get<std::string>("profile_csv").empty() || !args.get<std::string>("profile_json").empty()) {
+        profiler.reset(new XCVMProfiler());
+        xcvm_opts.profiler = profiler.get();
+    }
 
-    int64_t param_bytes = initial_free_bytes - GetMemoryUsageInBytes();
+    int64_t param_bytes = GetMemoryUsageInBytes() - initial_used_bytes;
 
     int height = 0, width = 0;
     for (Value* value : infeed_values) {
@@ -165,10 +194,11 @@ void RunMain(const std::vector<std::string>& argv) {
     std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
     LOG() << "Start training!" << std::endl;
     int iter_count = 0;
+    if (args.get<int>("chrome_tracing_buffer_size") <= 0) QFAIL() << "--chrome_tracing_buffer_size must be positive";
     int max_iterations = args.get<int>("iterations");
     for (; !max_iterations || iter_count < max_iterations; ++iter_count) {
         if (!args.get<std::string>("chrome_tracing").empty() && iter_count % args.get<int>("chrome_tracing_frequency") == 1) {
-            xcvm_opts.chrome_tracing = new ChromeTracingEmitter();
+            xcvm_opts.chrome_tracing = new ChromeTracingEmitter(args.get<int>("chrome_tracing_buffer_size"));
         }
 
         InOuts inputs;
@@ -229,9 +259,8 @@ void RunMain(const std::vector<std::string>& argv) {
         double elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() * 0.001;
         start = end;
         std::cout << train_iter.GetStatus() << " loss=" << loss << " elapsed=" << elapsed << "ms";
-        if (initial_free_bytes >= 0) {
-            int64_t free_bytes = GetMemoryUsageInBytes();
-            size_t used_bytes = initial_free_bytes - free_bytes;
+        if (initial_used_bytes >= 0) {
+            size_t used_bytes = GetMemoryUsageInBytes() - initial_used_bytes;
             size_t param_mbs = param_bytes / 1000 / 1000;
             size_t used_mbs = used_bytes / 1000 / 1000;
             std::cout << " param=" << param_mbs << "MB used=" << used_mbs << "MB";
@@ -246,6 +275,14 @@ void RunMain(const std::vector<std::string>& argv) {
     }
 
     train_iter.Terminate();
+
+    if (profiler) {
+        profiler->Report(std::cerr);
+        const std::string& profile_csv = args.get<std::string>("profile_csv");
+        if (!profile_csv.empty()) profiler->EmitCSV(profile_csv);
+        const std::string& profile_json = args.get<std::string>("profile_json");
+        if (!profile_json.empty()) profiler->EmitJSON(profile_json);
+    }
 }
 
 }  // namespace
@@ -1,6 +1,11 @@
 #include "tools/util.h"
 
 #include <algorithm>
+#include <cstring>
+#include <memory>
+
+#include <chainerx/native/native_backend.h>
+#include <chainerx/routines/creation.h>
 
 #include <compiler/graph.h>
 #include <compiler/model.h>
@@ -33,14 +38,19 @@ chainerx::Dtype ChainerXTypeFromONNX(int xtype) {
     }
 }
 
-InOuts LoadParams(const Graph& graph) {
+InOuts LoadParams(const Graph& graph, bool share_data) {
     InOuts params;
     for (const Value* input : graph.input_values()) {
         if (input->users().empty()) continue;
         if (const Tensor* initializer = input->initializer()) {
             chainerx::Dtype dtype = ChainerXTypeFromONNX(initializer->dtype().ToONNX());
             chainerx::Shape shape(initializer->dims());
-            const void* data = initializer->GetRawData();
+            std::shared_ptr<void> data = initializer->GetSharedData();
+            if (!share_data) {
+                const int64_t size = initializer->ElementSize() * initializer->NumElements();
+                data.reset(new char[size], std::default_delete<char[]>());
+                std::memcpy(data.get(), initializer->GetRawData(), size);
+            }
             chainerx::Array tensor;
             // If the input is used only by Reshape as a shape, place
             // it on host memory.
@@ -49,9 +59,10 @@ InOuts LoadParams(const Graph& graph) {
             if (std::find_if(input->users().begin(), input->users().end(), [input](const Node* node) {
                     return node->op_type() != Node::kReshape || node->input(1) != input;
                 }) == input->users().end()) {
-                tensor = MakeHostArray(dtype, shape, data);
+                tensor = chainerx::FromData(
+                        shape, dtype, data, nonstd::nullopt /* strides */, 0 /* offset */, chainerx::GetNativeBackend().GetDevice(0));
             } else {
-                tensor = MakeArray(dtype, shape, data);
+                tensor = chainerx::FromContiguousHostData(shape, dtype, data);
             }
             CHECK(params.emplace(initializer->name(), std::shared_ptr<XCVMVar>(new XCVMVar(tensor))).second)
                     << "Duplicate input tensor: " << initializer->name();
@@ -14,7 +14,11 @@ namespace runtime {
 
 chainerx::Dtype ChainerXTypeFromONNX(int xtype);
 
-InOuts LoadParams(const Graph& graph);
+// Creates arrays for the initializers of `graph`. With `share_data`,
+// arrays on the native device share the data with the initializers,
+// which may be mapped from read-only external data, so they must not
+// be written, e.g., by training.
+InOuts LoadParams(const Graph& graph, bool share_data = false);
 
 }  // namespace runtime
 }  // namespace chainer_compiler